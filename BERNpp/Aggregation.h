@@ -0,0 +1,129 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Aggregation_h__
+#define Aggregation_h__
+
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+namespace BERN {
+
+    ///@brief The fuzzy operators to aggregate the species possibilities of a community
+    enum class AggregationKind {
+        ///The algebraic gamma operator A^gamma * (1-B)^(1-gamma), with A = prod(p) and B = prod(1-p), the BERN standard
+        gamma,
+        ///The minimum of the species possibilities
+        minimum,
+        ///The product of the species possibilities
+        product,
+        ///The arithmetic mean of the species possibilities (compensatory, a single species with 0 does not exclude the community)
+        mean
+    };
+
+    ///@brief Selects the aggregation operator of Community::possibility for a query
+    struct Aggregation {
+        AggregationKind kind;
+        ///@brief The gamma of the algebraic gamma operator, ignored by the other kinds
+        double gamma;
+        explicit Aggregation(AggregationKind kind_=AggregationKind::gamma, double gamma_=0.2)
+            : kind(kind_), gamma(kind_ == AggregationKind::gamma ? gamma_ : 0.0) {}
+        ///@brief The algebraic gamma operator with gamma in [0..1]
+        static Aggregation gamma_operator(double gamma) {return Aggregation(AggregationKind::gamma, gamma);}
+        static Aggregation minimum() {return Aggregation(AggregationKind::minimum);}
+        static Aggregation product() {return Aggregation(AggregationKind::product);}
+        static Aggregation mean() {return Aggregation(AggregationKind::mean);}
+        ///@brief true, if a single species with possibility 0 makes the community possibility 0
+        ///
+        ///Only for these operators the possibility is 0 outside of the community envelope
+        bool zero_absorbing() const {return kind != AggregationKind::mean && !(kind == AggregationKind::gamma && gamma <= 0);}
+        bool operator<(const Aggregation& other) const {
+            return kind < other.kind || (kind == other.kind && gamma < other.gamma);
+        }
+        bool operator==(const Aggregation& other) const {return kind == other.kind && gamma == other.gamma;}
+        std::string str() const {
+            switch (kind) {
+                case AggregationKind::gamma: return "gamma(" + std::to_string(gamma) + ")";
+                case AggregationKind::minimum: return "minimum";
+                case AggregationKind::product: return "product";
+                default: return "mean";
+            }
+        }
+    };
+
+#ifndef SWIG
+    ///@brief Accumulators for the species possibilities, one per Aggregation kind
+    ///
+    ///Each policy has add(p) for every species possibility and result() for the community possibility.
+    ///If absorbing is true, the result is 0 as soon as any p is 0, so evaluation may stop there.
+    namespace aggregation {
+        ///The algebraic gamma operator for 0 < gamma
+        struct Gamma {
+            static constexpr bool absorbing = true;
+            double gamma, A = 1, B = 1;
+            explicit Gamma(double gamma_) : gamma(gamma_) {}
+            void add(double p) {A *= p; B *= 1 - p;}
+            double result() const {return pow(A, gamma) * pow(1 - B, 1 - gamma);}
+        };
+        ///The algebraic sum 1 - prod(1-p), the gamma operator for gamma = 0
+        struct AlgebraicSum {
+            static constexpr bool absorbing = false;
+            double B = 1;
+            void add(double p) {B *= 1 - p;}
+            double result() const {return 1 - B;}
+        };
+        struct Minimum {
+            static constexpr bool absorbing = true;
+            double value = 1;
+            void add(double p) {value = std::min(value, p);}
+            double result() const {return value;}
+        };
+        struct Product {
+            static constexpr bool absorbing = true;
+            double value = 1;
+            void add(double p) {value *= p;}
+            double result() const {return value;}
+        };
+        struct Mean {
+            static constexpr bool absorbing = false;
+            double sum = 0;
+            size_t count = 0;
+            void add(double p) {sum += p; ++count;}
+            double result() const {return count ? sum / count : 0.0;}
+        };
+
+        ///@brief Calls kernel with the policy object of aggregation
+        template<typename Kernel>
+        inline auto dispatch(const Aggregation& aggregation, Kernel&& kernel) -> decltype(kernel(Mean())) {
+            switch (aggregation.kind) {
+                case AggregationKind::gamma:
+                    if (aggregation.gamma > 0)
+                        return kernel(Gamma(aggregation.gamma));
+                    else
+                        return kernel(AlgebraicSum());
+                case AggregationKind::minimum: return kernel(Minimum());
+                case AggregationKind::product: return kernel(Product());
+                default: return kernel(Mean());
+            }
+        }
+    }
+#endif
+}
+
+#endif // Aggregation_h__
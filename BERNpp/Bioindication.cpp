@@ -0,0 +1,95 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Bioindication.h"
+#include "Optimizer.h"
+#include <algorithm>
+#include <sstream>
+#include <omp.h>
+
+using namespace BERN;
+
+namespace {
+    //Bisection between a site with the possibility >= threshold (inner) and a bound in dimension dim (outer)
+    //The same approach as in the former Community::disharmonicAlphaPosition
+    double alpha_bound(const Community& releve, SiteVector site, size_t dim, double outer, double threshold) {
+        double inner = site[dim];
+        site[dim] = outer;
+        if (releve.possibility(site) >= threshold) {
+            return outer;
+        }
+        const double tolerance = releve.type().accuracy()[dim] * 1e6;
+        for (int i=0; i < 100 && std::abs(outer - inner) > tolerance; ++i) {
+            site[dim] = 0.5 * (inner + outer);
+            if (releve.possibility(site) >= threshold)
+                inner = site[dim];
+            else
+                outer = site[dim];
+        }
+        return inner;
+    }
+}
+
+Indication BERN::indicate(const Community::SpeciesVector &releve, double alpha) {
+    if (releve.empty()) {
+        throw std::runtime_error("A relevé without species can not be used for bioindication");
+    }
+    //The relevé is evaluated as an ad hoc community, a species listed twice is counted once
+    Community comm(-1, "relevé", releve[0]->type());
+    for (auto spec: releve) {
+        if (std::find(comm.species().begin(), comm.species().end(), spec) == comm.species().end())
+            comm.add_species(spec);
+    }
+    Indication res;
+    res.species_count = comm.size();
+    res.estimate = comm.optimum();
+    res.feasible = releve[0]->pess;
+    for (auto spec: comm.species()) {
+        res.feasible = res.feasible & spec->pess;
+    }
+    if (res.estimate.value > 0) {
+        const double threshold = alpha * res.estimate.value;
+        res.uncertainty = {res.estimate.site, res.estimate.site};
+        for (size_t dim = 0; dim < comm.type().size(); ++dim) {
+            res.uncertainty.min[dim] = alpha_bound(comm, res.estimate.site, dim, res.feasible.min[dim], threshold);
+            res.uncertainty.max[dim] = alpha_bound(comm, res.estimate.site, dim, res.feasible.max[dim], threshold);
+        }
+    }
+    return res;
+}
+
+std::vector<Indication> BERN::indicate(const std::vector<Community::SpeciesVector> &releves, double alpha) {
+    BERN_PHASE(evaluate_ns);
+    std::vector<Indication> res(releves.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int i=0; i < (int)releves.size(); ++i) {
+        try {
+            res[i] = indicate(releves[i], alpha);
+        } catch (const std::runtime_error& e) {
+            res[i].estimate.value = NaN;
+        }
+    }
+    return res;
+}
+
+std::string Indication::str() const {
+    std::stringstream s;
+    s << "Indication from " << species_count << " species: " << estimate.str();
+    s << "uncertainty min: " << uncertainty.min << "\n";
+    s << "uncertainty max: " << uncertainty.max << "\n";
+    return s.str();
+}
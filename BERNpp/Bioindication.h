@@ -0,0 +1,58 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Bioindication_h__
+#define Bioindication_h__
+
+#include "SiteVector.h"
+#include "Species.h"
+#include "Community.h"
+#include <vector>
+#include <string>
+
+namespace BERN {
+    ///@brief The site conditions indicated by a list of observed species (relevé)
+    ///
+    ///The relevé is treated like a community: The joint possibility of the observed species
+    ///is calculated with the algebraic gamma operator and maximized with the optimizer of the communities.
+    struct Indication {
+        ///@brief The site with the highest joint possibility of the observed species and its value
+        Possibility estimate;
+        ///@brief The hypercube where all observed species can exist (joint possibility > 0)
+        SiteRange feasible;
+        ///@brief The range in each dimension around the estimate, where the joint possibility is >= alpha * estimate.value
+        ///
+        ///Each dimension is searched separately, while the other dimensions are kept at the estimate
+        SiteRange uncertainty;
+        ///@brief Number of different species used for the indication
+        size_t species_count = 0;
+        std::string str() const;
+    };
+
+    /// Estimates the site conditions from a relevé
+    /// \param releve The observed species, a species listed more than once counts once
+    /// \param alpha Relative possibility level [0..1] defining the uncertainty box
+    /// \return The estimated site conditions
+    Indication indicate(const Community::SpeciesVector& releve, double alpha=0.5);
+
+    /// Estimates the site conditions for many relevés. Uses OpenMP parallelisation, if available.
+    /// Relevés without species result in an estimate with NaN value
+    std::vector<Indication> indicate(const std::vector<Community::SpeciesVector>& releves, double alpha=0.5);
+
+}
+#endif // Bioindication_h__
@@ -0,0 +1,315 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Calibration.h"
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <set>
+
+using namespace BERN;
+
+namespace {
+    //The niche value of the parameter, writable for a copy of a species
+    template<typename S>
+    auto niche_value(S& spec, const CalibrationParameter& p) -> decltype((spec.pess.min[0])) {
+        switch (p.point) {
+            case NichePoint::pess_min: return spec.pess.min[p.dim];
+            case NichePoint::opt_min: return spec.opt.min[p.dim];
+            case NichePoint::opt_max: return spec.opt.max[p.dim];
+            default: return spec.pess.max[p.dim];
+        }
+    }
+    //The species of a niche parameter, throws std::out_of_range for unknown species or dimensions
+    const Species& calibrated(const Database& db, const CalibrationParameter& p) {
+        const Species* spec = db.find_species(p.species);
+        if (!spec)
+            throw std::out_of_range("Calibrated species " + std::to_string(p.species) + " does not exist");
+        if (p.dim >= spec->type().size())
+            throw std::out_of_range("Calibrated dimension " + std::to_string(p.dim) + " of species " +
+                                    std::to_string(p.species) + " does not exist");
+        return *spec;
+    }
+    //Exact comparison, every change of the calibration needs to reach the database
+    bool same_niche(const Species& a, const Species& b) {
+        auto same = [](const SiteVector& x, const SiteVector& y) {
+            return std::equal(x.begin(), x.end(), y.begin(), y.end());
+        };
+        return same(a.pess.min, b.pess.min) && same(a.opt.min, b.opt.min) &&
+               same(a.opt.max, b.opt.max) && same(a.pess.max, b.pess.max);
+    }
+    bool ordered(const Species& spec, size_t d) {
+        return spec.pess.min[d] <= spec.opt.min[d] && spec.opt.min[d] <= spec.opt.max[d] && spec.opt.max[d] <= spec.pess.max[d];
+    }
+}
+
+std::string CalibrationParameter::str() const {
+    if (species < 0)
+        return "gamma";
+    const char* points[] = {"pess_min", "opt_min", "opt_max", "pess_max"};
+    // The parameter does not know the schema of its species, the default schema names the dimension if possible
+    const std::string name = dim < site_type.size() ? site_type[dim].Name : std::to_string(dim);
+    return std::to_string(species) + "." + name + "." + points[int(point)];
+}
+
+std::string CalibrationScore::str() const {
+    std::stringstream s;
+    s << "log likelihood = " << log_likelihood << ", accuracy = " << accuracy << " (" << observations << " observations)";
+    return s.str();
+}
+
+std::string CalibrationResult::str() const {
+    std::stringstream s;
+    s << score.str() << " after " << evaluations << " evaluations" << (converged ? "" : " (not converged)");
+    return s.str();
+}
+
+Calibration::Calibration(Database &db, const std::vector<Observation> &observations, double epsilon)
+    : _db(db), _observations(observations), _epsilon(epsilon)
+{
+    for (int id: db.community_ids()) {
+        const Community* comm = db.find_community(id);
+        if (comm->size()) {
+            _columns[id] = _communities.size();
+            _communities.push_back(comm);
+        }
+    }
+    for (const auto& obs: _observations) {
+        //Checked here, update() runs in parallel
+        if (obs.site.size() != db.type().size())
+            throw SchemaError(obs.site.size(), db.type().size());
+        auto it = _columns.find(obs.community);
+        if (it == _columns.end())
+            throw std::invalid_argument("Observed community " + std::to_string(obs.community) + " does not exist or has no species");
+        _observed.push_back(it->second);
+    }
+    update_all();
+}
+
+void Calibration::update(const std::vector<size_t> &columns) {
+    const size_t nc = _communities.size();
+#pragma omp parallel for
+    for (int o = 0; o < (int)_observations.size(); ++o) {
+        for (size_t c: columns) {
+            _possibilities[o * nc + c] = _communities[c]->possibility(_observations[o].site, _aggregation);
+        }
+    }
+}
+
+void Calibration::update_all() {
+    _possibilities.resize(_observations.size() * _communities.size());
+    std::vector<size_t> columns(_communities.size());
+    std::iota(columns.begin(), columns.end(), 0);
+    update(columns);
+}
+
+CalibrationScore Calibration::score() const {
+    const size_t nc = _communities.size();
+    const size_t no = _observations.size();
+    // The terms of each observation are summed up in order, hence the score does not depend on the threads
+    std::vector<double> log_terms(no);
+    std::vector<char> hit(no);
+#pragma omp parallel for
+    for (int o = 0; o < (int)no; ++o) {
+        const double* row = &_possibilities[o * nc];
+        double sum = 0, max = 0;
+        for (size_t c = 0; c < nc; ++c) {
+            sum += row[c] + _epsilon;
+            max = std::max(max, row[c]);
+        }
+        const double observed = row[_observed[o]];
+        log_terms[o] = std::log((observed + _epsilon) / sum);
+        hit[o] = observed > 0 && observed >= max;
+    }
+    CalibrationScore res;
+    res.log_likelihood = std::accumulate(log_terms.begin(), log_terms.end(), 0.0);
+    res.accuracy = no ? double(std::count(hit.begin(), hit.end(), 1)) / no : NaN;
+    res.observations = no;
+    return res;
+}
+
+void Calibration::set_gamma(double gamma) {
+    if (gamma == _aggregation.gamma)
+        return;
+    _aggregation = Aggregation::gamma_operator(gamma);
+    update_all();
+}
+
+void Calibration::set_niche(int spec_id, const SiteVector &pessMin, const SiteVector &optMin, const SiteVector &optMax,
+                            const SiteVector &pessMax) {
+    _db.update_niche(spec_id, pessMin, optMin, optMax, pessMax);
+    std::vector<size_t> columns;
+    for (int comm_id: _db.communities_of(spec_id)) {
+        auto it = _columns.find(comm_id);
+        if (it != _columns.end())
+            columns.push_back(it->second);
+    }
+    update(columns);
+}
+
+double Calibration::get(const CalibrationParameter &parameter) const {
+    if (parameter.species < 0)
+        return _aggregation.gamma;
+    return niche_value(calibrated(_db, parameter), parameter);
+}
+
+bool Calibration::set(const std::vector<CalibrationParameter> &parameters, const std::vector<double> &values) {
+    if (parameters.size() != values.size())
+        throw std::invalid_argument("Calibration::set: " + std::to_string(parameters.size()) + " parameters, but " +
+                                    std::to_string(values.size()) + " values");
+    //All parameters are checked before the first change
+    for (const auto& p: parameters)
+        if (p.species >= 0)
+            calibrated(_db, p);
+    double gamma = _aggregation.gamma;
+    //The changed niches, collected per species to recalculate each community only once
+    std::map<int, Species> niches;
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        const CalibrationParameter& p = parameters[i];
+        const double value = std::min(p.upper, std::max(p.lower, values[i]));
+        if (p.species < 0) {
+            gamma = value;
+        } else {
+            auto it = niches.find(p.species);
+            if (it == niches.end())
+                it = niches.emplace(p.species, calibrated(_db, p)).first;
+            niche_value(it->second, p) = value;
+        }
+    }
+    bool valid = true;
+    std::set<size_t> columns;
+    for (auto& it: niches) {
+        const Species& spec = it.second;
+        if (same_niche(spec, *_db.find_species(it.first)))
+            continue;
+        _db.update_niche(it.first, spec.pess.min, spec.opt.min, spec.opt.max, spec.pess.max);
+        for (int comm_id: _db.communities_of(it.first)) {
+            auto col = _columns.find(comm_id);
+            if (col != _columns.end())
+                columns.insert(col->second);
+        }
+    }
+    //Only the calibrated dimensions are checked, the database may contain unordered niches elsewhere
+    for (const auto& p: parameters) {
+        if (p.species >= 0)
+            valid &= ordered(calibrated(_db, p), p.dim);
+    }
+    if (gamma != _aggregation.gamma) {
+        _aggregation = Aggregation::gamma_operator(gamma);
+        update_all();
+    } else {
+        update({columns.begin(), columns.end()});
+    }
+    return valid;
+}
+
+CalibrationResult Calibration::calibrate(const std::vector<CalibrationParameter> &parameters, size_t max_evaluations,
+                                         double tolerance) {
+    const size_t n = parameters.size();
+    CalibrationResult res;
+    //The objective to minimize, the negative log likelihood. Unordered niches are infeasible
+    auto objective = [&](const std::vector<double>& x) {
+        ++res.evaluations;
+        if (!set(parameters, x))
+            return std::numeric_limits<double>::infinity();
+        return -score().log_likelihood;
+    };
+    auto clamp = [&](std::vector<double>& x) {
+        for (size_t i = 0; i < n; ++i)
+            x[i] = std::min(parameters[i].upper, std::max(parameters[i].lower, x[i]));
+    };
+
+    //Initial simplex: the current values and a step of 10% of the range in each parameter
+    std::vector<std::vector<double>> simplex(n + 1, std::vector<double>(n));
+    for (size_t i = 0; i < n; ++i)
+        simplex[0][i] = get(parameters[i]);
+    clamp(simplex[0]);
+    for (size_t j = 1; j <= n; ++j) {
+        simplex[j] = simplex[0];
+        const CalibrationParameter& p = parameters[j - 1];
+        double step = 0.1 * (p.upper - p.lower);
+        //Step away from the upper bound
+        simplex[j][j - 1] += simplex[0][j - 1] + step <= p.upper ? step : -step;
+    }
+    std::vector<double> f(n + 1);
+    for (size_t j = 0; j <= n; ++j)
+        f[j] = objective(simplex[j]);
+
+    std::vector<size_t> order(n + 1);
+    auto centroid = [&](std::vector<double>& c) {
+        c.assign(n, 0.0);
+        for (size_t j = 0; j < n; ++j)
+            for (size_t i = 0; i < n; ++i)
+                c[i] += simplex[order[j]][i] / n;
+    };
+    //x = c + t * (c - worst)
+    auto along = [&](const std::vector<double>& c, double t) {
+        std::vector<double> x(n);
+        for (size_t i = 0; i < n; ++i)
+            x[i] = c[i] + t * (c[i] - simplex[order[n]][i]);
+        clamp(x);
+        return x;
+    };
+
+    std::vector<double> c;
+    while (n && res.evaluations < max_evaluations) {
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&f](size_t a, size_t b) {return f[a] < f[b];});
+        const size_t best = order[0], worst = order[n];
+        if (std::isfinite(f[worst]) && f[worst] - f[best] < tolerance) {
+            res.converged = true;
+            break;
+        }
+        centroid(c);
+        std::vector<double> reflected = along(c, 1.0);
+        double fr = objective(reflected);
+        if (fr < f[best]) {
+            std::vector<double> expanded = along(c, 2.0);
+            double fe = objective(expanded);
+            if (fe < fr) {
+                simplex[worst] = expanded; f[worst] = fe;
+            } else {
+                simplex[worst] = reflected; f[worst] = fr;
+            }
+        } else if (fr < f[order[n - 1]]) {
+            simplex[worst] = reflected; f[worst] = fr;
+        } else {
+            //Contraction, outside if the reflection is better than the worst
+            std::vector<double> contracted = along(c, fr < f[worst] ? 0.5 : -0.5);
+            double fc = objective(contracted);
+            if (fc < std::min(fr, f[worst])) {
+                simplex[worst] = contracted; f[worst] = fc;
+            } else {
+                //Shrink towards the best vertex
+                for (size_t j = 1; j <= n; ++j) {
+                    size_t k = order[j];
+                    for (size_t i = 0; i < n; ++i)
+                        simplex[k][i] = simplex[best][i] + 0.5 * (simplex[k][i] - simplex[best][i]);
+                    f[k] = objective(simplex[k]);
+                }
+            }
+        }
+    }
+    const size_t best = std::min_element(f.begin(), f.end()) - f.begin();
+    res.values = simplex[best];
+    set(parameters, res.values);
+    res.score = score();
+    return res;
+}
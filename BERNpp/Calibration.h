@@ -0,0 +1,149 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Calibration_h__
+#define Calibration_h__
+
+#include "SiteVector.h"
+#include "Community.h"
+#include "DataAccess.h"
+#include <vector>
+#include <map>
+#include <string>
+
+namespace BERN {
+
+    ///@brief A relevé with known site conditions and the community it has been assigned to
+    struct Observation {
+        SiteVector site;
+        int community;
+        Observation(const SiteVector& site_, int community_) : site(site_), community(community_) {}
+        Observation() : community(-1) {}
+    };
+
+    ///@brief The four points of a species niche in one dimension
+    enum class NichePoint {pess_min, opt_min, opt_max, pess_max};
+
+    ///@brief A scalar parameter of the calibration, either the gamma of the aggregation or a niche point of a species
+    struct CalibrationParameter {
+        ///@brief The species id, -1 for gamma
+        int species;
+        size_t dim;
+        NichePoint point;
+        ///@brief Bounds of the parameter
+        double lower, upper;
+        CalibrationParameter(int species_, size_t dim_, NichePoint point_, double lower_, double upper_)
+            : species(species_), dim(dim_), point(point_), lower(lower_), upper(upper_) {}
+        ///@brief The gamma of the algebraic gamma operator
+        static CalibrationParameter gamma(double lower=0.01, double upper=1.0) {
+            return {-1, 0, NichePoint::pess_min, lower, upper};
+        }
+        ///@brief A niche point of a species in dimension dim
+        static CalibrationParameter niche(int species, size_t dim, NichePoint point, double lower, double upper) {
+            return {species, dim, point, lower, upper};
+        }
+        std::string str() const;
+    };
+
+    ///@brief Goodness of fit of the community assignments
+    struct CalibrationScore {
+        ///@brief Sum of log(P(observed community | site)) with P = (p_c + epsilon) / sum(p + epsilon) over all communities
+        double log_likelihood = 0;
+        ///@brief Fraction of the observations where the observed community has the highest possibility (> 0)
+        double accuracy = 0;
+        size_t observations = 0;
+        std::string str() const;
+    };
+
+    ///@brief The outcome of Calibration::calibrate
+    struct CalibrationResult {
+        CalibrationScore score;
+        ///@brief The best parameter values, in the order of the parameters. These values are applied to the database
+        std::vector<double> values;
+        size_t evaluations = 0;
+        bool converged = false;
+        std::string str() const;
+    };
+
+    ///@brief Evaluates and optimizes the fit of niche parameters and gamma to observed relevés
+    ///
+    ///The possibilities of all communities at all observed sites are cached. Changing a niche updates the
+    ///species in the database and recalculates only the communities containing the species, changing gamma
+    ///recalculates everything. The recalculation runs in parallel over the observations (OpenMP).
+    ///
+    ///The calibration changes the niches of the database. Do not use the database from other threads meanwhile.
+    class Calibration {
+    public:
+        ///@param db The database with the species and communities to calibrate
+        ///@param observations The relevés, each community id must exist in the database. Sites of another
+        ///                    schema than the database throw a SchemaError
+        ///@param epsilon Added to every possibility for the likelihood, to avoid log(0)
+        Calibration(Database& db, const std::vector<Observation>& observations, double epsilon=1e-6);
+
+        ///@brief The score of the current parameters, bit identical for any number of threads
+        CalibrationScore score() const;
+        double gamma() const {return _aggregation.gamma;}
+        ///@brief Sets the gamma of the aggregation and recalculates all possibilities
+        void set_gamma(double gamma);
+        ///@brief Changes the niche of a species and recalculates the possibilities of the communities containing it
+        void set_niche(int spec_id, const SiteVector& pessMin, const SiteVector& optMin, const SiteVector& optMax, const SiteVector& pessMax);
+
+        ///@brief Returns the current value of a parameter, throws std::out_of_range for unknown species
+        double get(const CalibrationParameter& parameter) const;
+        ///@brief Sets parameter values (clamped to their bounds) with one recalculation per changed species
+        ///
+        ///Throws std::out_of_range for unknown species or dimensions, before any value is changed
+        ///@returns false, if a changed niche is not ordered (pessMin <= optMin <= optMax <= pessMax)
+        bool set(const std::vector<CalibrationParameter>& parameters, const std::vector<double>& values);
+
+        ///@brief Maximizes the log likelihood by the derivative free Nelder-Mead method
+        ///
+        ///The search starts at the current values with an initial simplex of 10% of the parameter ranges.
+        ///Values with unordered niches are rejected. The best values found are applied at the end
+        ///@param parameters The parameters to calibrate
+        ///@param max_evaluations Maximum number of score evaluations
+        ///@param tolerance Stops, if the log likelihood of the simplex vertices differs less
+        CalibrationResult calibrate(const std::vector<CalibrationParameter>& parameters,
+                                    size_t max_evaluations=500, double tolerance=1e-6);
+
+        size_t observations() const {return _observations.size();}
+        size_t communities() const {return _communities.size();}
+        ///@brief Possibility of the community column at the observation row
+        double possibility(size_t observation, size_t community) const {
+            return _possibilities[observation * _communities.size() + community];
+        }
+
+    private:
+        Database& _db;
+        std::vector<Observation> _observations;
+        double _epsilon;
+        Aggregation _aggregation;
+        ///@brief The non-empty communities of the database (the columns of the cache)
+        std::vector<const Community*> _communities;
+        std::map<int, size_t> _columns;
+        ///@brief Column of the observed community for each observation
+        std::vector<size_t> _observed;
+        ///@brief Cache of the possibilities, observation major
+        std::vector<double> _possibilities;
+        void update(const std::vector<size_t>& columns);
+        void update_all();
+    };
+
+}
+
+#endif // Calibration_h__
@@ -16,147 +16,245 @@
 // For the usage of this model a database of species and plant communities is needed.
 // The database is usually in the same repository as this code, but covered by another, less free licence
 #include "Community.h"
+#include "Optimizer.h"
 #include <cmath>
 #include <stdexcept>
+#include <algorithm>
+#include <map>
 #include <omp.h>
 
 using namespace std;
 using namespace BERN;
 
-// Integer power function, cheaper then pow
-int ipow(int base, int exponent) {
-    if (!exponent) { return 1;}
-    int res = base;
-    for (int i=1; i<exponent; ++i) {
-        res *= base;
-    }
-    return res;
+namespace {
+    //Hard coded, standard gamma for BERN (expert knowledge)
+    const double standard_gamma = 0.2;
+}
+
+void BERN::check_schema(const vector<const Community *> &comms, const vector<SiteVector> &sites) {
+    if (comms.empty())
+        return;
+    const size_t dims = comms[0]->type().size();
+    for (auto comm: comms)
+        if (comm->type().size() != dims)
+            throw SchemaError(comm->type().size(), dims);
+    for (auto& site: sites)
+        if (site.size() != dims)
+            throw SchemaError(site.size(), dims);
 }
 
 SiteVector Community::center() const {
     SiteRange inner_circle = this->envelope();
-    for (auto spec: this->species) {
+    for (auto spec: this->speciesStorage) {
         inner_circle = inner_circle & spec->opt;
     }
     return inner_circle.center();
 }
 
-//Calculates the optimum (both position and value)
-//Since the possibility function's derivate is not a continuous function, usual n-dimension numeric solutions for optimum problems are not suitable
-//The optimum is calculated by trying in the n direction at specified step width. If no position with a higher possibility value is found,
-//the step width is divided by 10, until the step width is smaller then SiteVector::CalcAccuracy
+//Calculates the optimum (both position and value), starting at the center of the optimum intersection
+//See BERN::maximize for the algorithm
 BERN::Possibility BERN::Community::calculateOptimum() const
 {
-    //Site near actual to test for higher possibility
-    SiteVector  test;
-    double
-            curVal=0,
-            bestVal,
-            testVal=0;
-    SiteVector curSite=this->center();
-    //Each step in any dimension is a multiple of the calculation accuracy of that dimension (stored in SiteVector::CalcAccuracy)
-    double stepWidthFactor = 1e10;
-    //As long as the factor of the step width factor is greater than 1
-    while (stepWidthFactor >= 1) {
-        //Calculate the possibility at the actual site (no normalization, of course, since we are calculating the optimum by now)
-        curVal = possibility(curSite);
-        if (curVal > 1 - 1e-12) {
-            break;
-        }
-        //An "in between" storage for the preliminary best neighbor
-        SiteVector best = curSite;
-        bestVal = curVal;
-        //hasDir becomes true if a direction towards a higher possibility value is found. If it becomes false the step width is adjusted
-        bool hasDir = false;
-        //Calculate the step width vector for all site parameters
-        SiteVector stepWidthVector = SiteVector::calc_accuracy() * stepWidthFactor;
-        //Test in each dimension, 3 directions per dimension: left, no move, right
-        //Possible combinations (including the actual position) is direction^dimensions
-        size_t dims = SiteVector::dims();
-        int combinations = ipow(3, int(dims));
-        for (int i = 0; i < combinations; i++) {
-            //If i is not pointing on the actual site conditions
-            if (i != (combinations - 1) / 2) {
-                //Populate the direction vector
-                for (int d = 0; d < dims; d++)
-                    //The function f(i)=floor(...) - 1 gets for each dimension d the direction part [-1,0,1] of i
-                    test[d] = curSite[d] + ((int) (floor(i / ipow(3, d))) % 3 - 1) * stepWidthVector[d];
-                //Calculate the possiblity at the test site
-                testVal = this->possibility(test);
-                //Is the test site the best neighbor until now?
-                if (testVal > bestVal) {
-                    //test is the best...
-                    best = test;
-                    bestVal = testVal;
-                    //We've found a Direction for further search of the optimum
-                    hasDir = true;
-                }
-            }
-        }
-        //A "better" direction found
-        if (hasDir)
-            //Take the best estimate as the new actual site condition
-            curSite = best;
-        else
-            //Minimize the step width
-            stepWidthFactor /= 10;
-    } //While (stepWidthFactor>=1)
-
-    //The optimum is found in the given accuracy, we can update the given references with the actual site and value
-    return {curSite, curVal};
+    return maximize([this](const SiteVector& site) {return this->possibility(site);}, this->center(), &optimizerStats);
 }
 
 //Calculates the possibility measure of the species by the algebraic gamma operator
 //under site conditions "SiteCondition". For better comparison of different communities the possibility is normalized by the optimal value
 double BERN::Community::possibility(const SiteVector &SiteCondition) const
 {
-	//If one of the values of the SiteCondition vector is outside the niche intersection of species, return 0
-    if (!envelope().contains(SiteCondition)) {
-        return 0;
-    }
-
-	//Else calculate the possibility with the algebraic gamma operator
-	double 
-		A = 1,
-		B = 1,
-		//Hard coded, standard gamma for BERN (expert knowledge)
-		gamma = 0.2;
-	//Algebraic gamma operator
-	for (const auto & spec: species)
+    return evaluate(SiteCondition, aggregation::Gamma(standard_gamma));
+}
+
+double BERN::Community::possibility(const SiteVector &SiteCondition, const Aggregation &aggregation) const {
+    //Select the kernel once, outside of the loop over the species
+    return aggregation::dispatch(aggregation, [&](auto policy) {return this->evaluate(SiteCondition, policy);});
+}
+
+template<typename Policy>
+double BERN::Community::evaluate(const SiteVector &SiteCondition, Policy policy) const
+{
+    if (speciesStorage.empty()) {
+        throw BERN::NoSpeciesError(*this);
+    }
+    if (SiteCondition.size() != siteType->size()) {
+        throw BERN::SchemaError(SiteCondition.size(), siteType->size());
+    }
+    BERN_COUNT(community_evaluations);
+    if (Policy::absorbing) {
+        //If one of the values of the SiteCondition vector is outside the niche intersection of species, return 0
+        //Use the cached envelope directly to avoid a copy per call
+        if (!envelopeStorage.contains(SiteCondition)) {
+            BERN_COUNT(envelope_rejects);
+            return 0;
+        }
+    }
+
+	//Else aggregate the species possibilities, the most selective species first
+	for (const auto & spec: evaluationOrder)
 	{
 		double poss = spec->possibility(SiteCondition);
-		A *= poss;
-		B *= 1-poss;
+		//A single species without possibility makes the result 0
+		if (Policy::absorbing && poss <= 0) {
+			return 0;
+		}
+		policy.add(poss);
 	}
-	A = pow(A, gamma);
-	B = pow((1-B),(1-gamma));
-	
-    return (A * B);
+    return policy.result();
+}
+
+PossibilityBounds BERN::Community::possibility_bounds(const SiteRange &box, const Aggregation &aggregation) const {
+    if (speciesStorage.empty()) {
+        throw BERN::NoSpeciesError(*this);
+    }
+    return aggregation::dispatch(aggregation, [&](auto policy) {
+        auto lower = policy, upper = policy;
+        for (const auto& spec: this->evaluation_order()) {
+            PossibilityBounds b = spec->possibility_bounds(box);
+            lower.add(b.lower);
+            upper.add(b.upper);
+        }
+        return PossibilityBounds(lower.result(), upper.result());
+    });
+}
+
+//The gradient of the gamma operator f = A^gamma * (1-B)^(1-gamma) with A = prod(p_i) and B = prod(1-p_i)
+//is df/dp_i = f * (gamma / p_i + (1 - gamma) * prod_{j!=i}(1-p_j) / (1-B)).
+//Each p_i depends only on the limiting dimension of species i, see Species::possibility
+PossibilityGradient BERN::Community::possibility_with_gradient(const SiteVector &SiteCondition) const {
+    PossibilityGradient res;
+    res.gradient = SiteVector(std::vector<double>(type().size(), 0.0), type());
+    res.value = possibility(SiteCondition);
+    if (!(res.value > 0)) {
+        return res;
+    }
+    const double gamma = standard_gamma;
+    const size_t n = speciesStorage.size();
+    std::vector<double> poss(n), slope(n);
+    std::vector<size_t> dim(n);
+    for (size_t i = 0; i < n; ++i) {
+        poss[i] = speciesStorage[i]->possibility(SiteCondition, dim[i], slope[i]);
+    }
+    //suffix[i] = prod_{j>=i}(1-p_j), to get prod_{j!=i}(1-p_j) without division by 1-p_i = 0
+    std::vector<double> suffix(n + 1, 1.0);
+    for (size_t i = n; i > 0; --i) {
+        suffix[i - 1] = suffix[i] * (1 - poss[i - 1]);
+    }
+    const double one_minus_B = 1 - suffix[0];
+    double prefix = 1;
+    for (size_t i = 0; i < n; ++i) {
+        const double B_without_i = prefix * suffix[i + 1];
+        const double df_dp = res.value * (gamma / poss[i] + (1 - gamma) * B_without_i / one_minus_B);
+        res.gradient[dim[i]] += df_dp * slope[i];
+        prefix *= 1 - poss[i];
+    }
+    return res;
 }
 
-Community::Community(int id_, const string &name_) :
-        id(id_),name(name_)
+Community::Community(int id_, const string &name_, const SiteType& type) :
+        id(id_),name(name_),siteType(type.share())
 {}
 
 
 SiteRange Community::envelope() const {
-    if (species.empty())
+    if (speciesStorage.empty())
         throw BERN::NoSpeciesError(*this);
-    SiteRange envelope = species[0] -> pess;
-    for(const auto& spec: species)
+    return envelopeStorage;
+}
+
+SiteRange Community::calculateEnvelope() const {
+    //Outside of the pessimum of a single species the gamma operator is 0, hence the intersection
+    SiteRange envelope = speciesStorage[0] -> pess;
+    for(const auto& spec: speciesStorage)
     {
-        envelope = envelope | spec->pess;
+        envelope = envelope & spec->pess;
     }
     return envelope;
 
 }
 
+void Community::add_species(const Species *spec) {
+    if (&spec->type() != siteType.get())
+        throw std::invalid_argument("Species " + std::to_string(spec->id) + " has another site schema than community "
+                                    + std::to_string(id));
+    speciesStorage.push_back(spec);
+    invalidate();
+}
+
+bool Community::remove_species(const Species *spec) {
+    auto it = std::find(speciesStorage.begin(), speciesStorage.end(), spec);
+    if (it == speciesStorage.end())
+        return false;
+    speciesStorage.erase(it);
+    invalidate();
+    return true;
+}
+
+void Community::invalidate() {
+    optimumStorage = Possibility();
+    aggregationOptima.clear();
+    if (speciesStorage.empty()) {
+        envelopeStorage = SiteRange(type());
+    } else {
+        envelopeStorage = calculateEnvelope();
+    }
+    //Order by the normalized volume of the pessimum, the narrowest niche first
+    std::vector<std::pair<double, const Species*>> selectivity;
+    for (auto spec: speciesStorage) {
+        double volume = 1;
+        for (size_t d = 0; d < type().size(); ++d) {
+            volume *= std::max(0.0, spec->pess.max[d] - spec->pess.min[d]) / (type()[d].max - type()[d].min);
+        }
+        selectivity.emplace_back(volume, spec);
+    }
+    std::stable_sort(selectivity.begin(), selectivity.end(),
+                     [](const std::pair<double, const Species*>& a, const std::pair<double, const Species*>& b) {
+                         return a.first < b.first;
+                     });
+    evaluationOrder.clear();
+    for (const auto& it: selectivity) {
+        evaluationOrder.push_back(it.second);
+    }
+}
+
+void Community::adapt_order(const std::vector<SiteVector> &sites) {
+    if (speciesStorage.empty())
+        return;
+    std::map<const Species*, size_t> rejects;
+    for (const auto& site: sites) {
+        if (!envelopeStorage.contains(site))
+            continue;
+        for (auto spec: speciesStorage) {
+            if (spec->possibility(site) <= 0)
+                ++rejects[spec];
+        }
+    }
+    //Most rejects first, the selectivity order stays for equal reject counts
+    std::stable_sort(evaluationOrder.begin(), evaluationOrder.end(),
+                     [&rejects](const Species* a, const Species* b) {
+                         return rejects[a] > rejects[b];
+                     });
+}
+
 BERN::Possibility Community::optimum() const {
     if (!optimumStorage)
         optimumStorage = calculateOptimum();
     return optimumStorage;
 }
 
+BERN::Possibility Community::optimum(const Aggregation &aggregation) const {
+    if (aggregation == Aggregation())
+        return optimum();
+    auto it = aggregationOptima.find(aggregation);
+    if (it != aggregationOptima.end())
+        return it->second;
+    //The search starts at the same site as the standard optimum
+    Possibility res = aggregation::dispatch(aggregation, [&](auto policy) {
+        return maximize([&](const SiteVector& site) {return this->evaluate(site, policy);}, this->center());
+    });
+    aggregationOptima[aggregation] = res;
+    return res;
+}
+
 
 /*
 BERN::SiteVector BERN::Community::disharmonicAlphaPosition( double alpha,double tolerance )
@@ -190,7 +288,9 @@ BERN::SiteVector BERN::Community::disharmonicAlphaPosition( double alpha,double
 */
 
 std::vector<double> BERN::possibility(std::vector<const Community *> comms, const SiteVector &site) {
+    BERN_PHASE(evaluate_ns);
     std::vector<double> res(comms.size());
+    check_schema(comms, {site});
 #pragma omp parallel for
     for (int i=0; i<comms.size(); i++){
         try {
@@ -216,9 +316,11 @@ double BERN::max_possibility(std::vector<const Community *> comms, const SiteVec
 }
 
 std::vector<double> BERN::possibility_matrix(const vector<const Community *> &comms, const vector<SiteVector> &sites) {
+    BERN_PHASE(evaluate_ns);
     size_t nc = comms.size();
     size_t ns = sites.size();
     size_t ntot = nc * ns;
+    check_schema(comms, sites);
     std::vector<double> res(ntot);
 #pragma omp parallel for
     for (int s=0; s < ns; s++) {
@@ -234,4 +336,51 @@ std::vector<double> BERN::possibility_matrix(const vector<const Community *> &co
     return res;
 }
 
+std::vector<double> BERN::possibility_matrix(const vector<const Community *> &comms, const vector<SiteVector> &sites,
+                                             const Aggregation &aggregation) {
+    BERN_PHASE(evaluate_ns);
+    size_t nc = comms.size();
+    size_t ns = sites.size();
+    std::vector<double> res(nc * ns);
+    check_schema(comms, sites);
+#pragma omp parallel for
+    for (int s=0; s < (int)ns; s++) {
+        for (size_t c = 0; c < nc; c++) {
+            size_t i = s * nc + c;
+            try {
+                res[i] = comms[c]->possibility(sites[s], aggregation);
+            } catch (const std::runtime_error &e) {
+                res[i] = NaN;
+            }
+        }
+    }
+    return res;
+}
 
+GradientMatrix BERN::possibility_gradient_matrix(const vector<const Community *> &comms, const vector<SiteVector> &sites) {
+    BERN_PHASE(evaluate_ns);
+    const size_t nc = comms.size();
+    const size_t ns = sites.size();
+    const size_t dims = nc ? comms[0]->type().size() : SiteVector::dims();
+    check_schema(comms, sites);
+    GradientMatrix res;
+    res.sites = ns;
+    res.communities = nc;
+    res.values.resize(nc * ns);
+    res.gradients.resize(nc * ns * dims);
+#pragma omp parallel for
+    for (int s=0; s < (int)ns; s++) {
+        for (size_t c = 0; c < nc; c++) {
+            size_t i = s * nc + c;
+            try {
+                PossibilityGradient pg = comms[c]->possibility_with_gradient(sites[s]);
+                res.values[i] = pg.value;
+                std::copy(pg.gradient.begin(), pg.gradient.end(), res.gradients.begin() + i * dims);
+            } catch (const std::runtime_error &e) {
+                res.values[i] = NaN;
+                std::fill_n(res.gradients.begin() + i * dims, dims, NaN);
+            }
+        }
+    }
+    return res;
+}
@@ -21,6 +21,8 @@
 
 #include "SiteVector.h"
 #include "Species.h"
+#include "Stats.h"
+#include "Aggregation.h"
 #include <vector>
 #include <map>
 #include <string>
@@ -32,8 +34,6 @@ namespace BERN {
 	{
 	public:
 		typedef std::vector<const Species*> SpeciesVector;
-        ///@brief The vector of species belonging to this community
-        SpeciesVector species;
 
         ///Can be used to store additional information as key/value pairs
         std::map< std::string, std::string > extra_info;
@@ -51,19 +51,66 @@ namespace BERN {
 		std::string name;
 
     private:
+        ///@brief The species belonging to this community, changed only by add_species and remove_species
+        SpeciesVector speciesStorage;
+        ///@brief The site schema of the species
+        std::shared_ptr<const SiteType> siteType;
         mutable Possibility optimumStorage;
+        mutable OptimizerStats optimizerStats;
+        ///@brief The optima of other aggregation operators than the standard, cleared by invalidate()
+        mutable std::map<Aggregation, Possibility> aggregationOptima;
+        ///@brief The envelope of the species niches, rebuilt by invalidate()
+        SiteRange envelopeStorage;
+        ///@brief The species in the order of evaluation, the most selective first. Rebuilt by invalidate()
+        SpeciesVector evaluationOrder;
 		///@brief calculates the highest possibility value and populates the m_Optimum vector with the optimal site condition
         Possibility calculateOptimum() const;
+        ///@brief calculates the envelope from the species niches
+        SiteRange calculateEnvelope() const;
+        ///@brief The possibility with the aggregation policy, see BERN::aggregation
+        template<typename Policy>
+        double evaluate(const SiteVector &SiteCondition, Policy policy) const;
 
 	public:
-		///Constructor (no species added)
-		explicit Community(int id_=-1, const std::string &name_="");
+		///Constructor (no species added), the species need to have the site schema type
+		explicit Community(int id_=-1, const std::string &name_="", const SiteType& type=site_type);
+		///@brief The site schema of the community
+		const SiteType& type() const {return *siteType;}
 
 		///@name Species of community
 		//@{
 		///Gets the number of species in the community
-		size_t size() const {return species.size();}
-
+		size_t size() const {return speciesStorage.size();}
+		///@brief The species belonging to this community
+		const SpeciesVector& species() const {return speciesStorage;}
+		///Adds a species to the community and invalidates the cached envelope and optimum.
+		///Throws std::invalid_argument, if the species has another site schema
+		void add_species(const Species* spec);
+		///Removes one occurence of a species from the community and invalidates the cached envelope and optimum
+		///@returns false, if the species is not part of the community
+		bool remove_species(const Species* spec);
+		///@brief Marks the cached envelope and optimum as outdated
+		///
+		///Needs to be called, if the niche of a species is changed directly. The species of a Database are
+		///only changed by Database::update_niche, which invalidates the communities containing the species.
+		///The envelope is rebuilt immediately, the optimum is recalculated on the next call of optimum()
+		void invalidate();
+		///Returns true, if the optimum needs to be (re)calculated
+		bool outdated() const {return !optimumStorage;}
+		///@brief Orders the species for the evaluation by the rate of zero possibility at the given sites
+		///
+		///Community::possibility stops at the first species with possibility 0, hence species that exclude
+		///most sites should be evaluated first. By default (after invalidate) the species are ordered by the
+		///normalized volume of their pessimum. Sites outside the envelope are not used.
+		void adapt_order(const std::vector<SiteVector>& sites);
+		///Returns the iterations and step width reductions of the last optimum calculation
+		OptimizerStats optimizer_stats() const {return optimizerStats;}
+
+        ///@brief The species in the order used by possibility(), see adapt_order
+        const SpeciesVector& evaluation_order() const {
+            return evaluationOrder;
+        }
+        ///@brief The intersection of the niche pessima of the species, where the possibility may be greater than 0
         SiteRange envelope() const;
         SiteVector center() const;
 
@@ -72,12 +119,30 @@ namespace BERN {
     public:
 		///Returns the optimal site conditions of this community. It calculates the optimum if the current optimum is outdated
         BERN::Possibility optimum() const;
+		///@brief Returns the optimal site conditions with the given aggregation operator
+		///
+		///The optima are cached per operator until invalidate() is called. Like optimum(), this is not thread safe for the same community
+        BERN::Possibility optimum(const Aggregation& aggregation) const;
 		///Returns the hypercube, where the possibility may be greater than 0. It calculates the envelope if the current envelope is outdated
 
 		///Calculates the possibility of existence of this community at given site conditions
 		/// @returns  The possibility, [0..1]
-		/// @param SiteCondition The site conditions, for which the possibility is calculated
+		/// @param SiteCondition The site conditions, for which the possibility is calculated.
+		///        NaN values are missing values, they do not restrict any species (see BERN::trapez)
         double possibility(const SiteVector &SiteCondition) const;
+		///@brief Calculates the possibility of existence of this community with another aggregation operator than the standard gamma operator
+        double possibility(const SiteVector &SiteCondition, const Aggregation& aggregation) const;
+
+		///@brief Returns bounds of the possibility for all sites in the box
+		///
+		///All aggregation operators are monotone in the species possibilities, hence the bounds of the species
+		///give bounds of the community. The bounds are not tight, but converge for small boxes
+        PossibilityBounds possibility_bounds(const SiteRange &box, const Aggregation& aggregation=Aggregation()) const;
+
+		///Calculates the possibility of existence of this community and its gradient with respect to the site dimensions
+		///
+		///The gradient is analytic, but only a subgradient at the kinks of the species niches and 0 where the possibility is 0
+        PossibilityGradient possibility_with_gradient(const SiteVector &SiteCondition) const;
 
 
 
@@ -87,6 +152,11 @@ namespace BERN {
         explicit NoSpeciesError(const Community& comm) : std::runtime_error(std::to_string(comm.id) + ": " + comm.name + " has no species") {}
     };
 
+    ///@brief Throws a SchemaError, if the communities and sites do not have the same number of dimensions
+    ///
+    ///The batch functions check their input before the parallel loops, an exception can not leave an OpenMP region
+    void check_schema(const std::vector<const Community*>& comms, const std::vector<SiteVector>& sites);
+
     /// Calculates the possibility for a group of communities at the same site. Uses OpenMP parallelisation, if available
     std::vector<double> possibility(std::vector<const Community*> comms, const SiteVector & site);
 
@@ -102,6 +172,26 @@ namespace BERN {
     /// \param sites Sites
     /// \return array in the size comms.size() * sites.size()
     std::vector<double> possibility_matrix(const std::vector<const Community*> & comms, const std::vector<SiteVector> & sites);
+    /// Like possibility_matrix, with the given aggregation operator for all communities
+    std::vector<double> possibility_matrix(const std::vector<const Community*> & comms, const std::vector<SiteVector> & sites,
+                                           const Aggregation& aggregation);
+
+    ///@brief Possibilities and gradients for many communities and sites, see possibility_gradient_matrix
+    struct GradientMatrix {
+        size_t sites = 0;
+        size_t communities = 0;
+        ///@brief The possibilities in the order of possibility_matrix
+        std::vector<double> values;
+        ///@brief The gradients, each value has SiteVector::dims() consecutive entries
+        std::vector<double> gradients;
+    };
+
+    /// Calculates the possibilities and their gradients for every community in comms at every site in sites.
+    /// Uses OpenMP parallelisation, if available.
+    ///
+    /// The values have the structure of possibility_matrix, the gradients have an extra inner dimension for
+    /// the site dimensions: dp(c1,s1)/dx1, dp(c1,s1)/dx2, ... dp(c2,s1)/dx1 ...
+    GradientMatrix possibility_gradient_matrix(const std::vector<const Community*> & comms, const std::vector<SiteVector> & sites);
 
     /// Calculate the maximum possibility at a site
     double max_possibility(std::vector<const Community*> comms, const SiteVector & site);
@@ -17,8 +17,11 @@
 // The database is usually in the same repository as this code, but covered by another, less free licence
 
 #include "DataAccess.h"
+#include "Stats.h"
 #include <ostream>
 #include <fstream>
+#include <sstream>
+#include <cctype>
 #include <omp.h>
 
 
@@ -45,32 +48,40 @@ bool skip_comment(std::istream& str) {
 }
 
 
+std::shared_ptr<BERN::SiteType> BERN::SiteType::load(const std::string &filename) {
+    //Open the file (exception handling needed)
+    std::ifstream varFile;
+    varFile.open(filename);
+    if (!varFile) {
+        throw std::runtime_error(filename + " does not exist");
+    }
+    auto res = std::make_shared<SiteType>();
+    //A place for something uninteresting
+    SiteValue var;
+    std::string dummy;
+    size_t id=0;
+    while (varFile.good() && !varFile.eof()) {
+        if (!skip_comment(varFile)) {
+            std::getline(varFile, var.Name, '\t');
+            std::getline(varFile, var.LongName, '\t');
+            varFile >> var.min >> var.max;
+            //An empty line at the end of the file is not a dimension
+            if (!varFile)
+                break;
+            var.id = id++;
+            std::getline(varFile, dummy);
+            res->push_back(var);
+        }
+    }
+    res->_self = res;
+    return res;
+}
+
 const BERN::SiteType& BERN::load_variables(const std::string& filename) {
     if (!site_type.empty()) {
         std::cerr << "Warning: Site type is not empty. Variables already populated, load aborted.\n";
     } else {
-        //Open the file (exception handling needed)
-        std::ifstream varFile;
-        // specFile.exceptions(std::ios::failbit);
-        varFile.open(filename);
-        if (varFile) {
-            //A place for something uninteresting
-            SiteValue var;
-            std::string dummy;
-            size_t id=0;
-            while (varFile.good() && !varFile.eof()) {
-                if (!skip_comment(varFile)) {
-                    var.id = id++;
-                    std::getline(varFile, var.Name, '\t');
-                    std::getline(varFile, var.LongName, '\t');
-                    varFile >> var.min >> var.max;
-                    std::getline(varFile, dummy);
-                    site_type.push_back(var);
-                }
-            }
-        } else {
-            throw std::runtime_error(filename + " does not exist");
-        }
+        site_type = *SiteType::load(filename);
     }
     return site_type;
 }
@@ -82,6 +93,16 @@ std::ostream &BERN::operator<<(std::ostream &ostr, const BERN::Species &spec) {
 
 
 
+BERN::Database::Database()
+    : _type(&site_type, [](const SiteType*) {})
+{
+}
+
+BERN::Database::Database(const std::string &site_type_file)
+    : _type(SiteType::load(site_type_file))
+{
+}
+
 BERN::Database::~Database() {
     for (auto com: _communities) {
         delete com.second;
@@ -91,24 +112,98 @@ BERN::Database::~Database() {
     }
 }
 
-BERN::Species &BERN::Database::species(int index) {
-    return *_species[index];
+const BERN::Species &BERN::Database::species(int index) const {
+    auto it = _species.find(index);
+    if (it == _species.end())
+        throw std::out_of_range("Species " + std::to_string(index) + " does not exist");
+    return *it->second;
+}
+
+const BERN::Community &BERN::Database::community(int index) const {
+    auto it = _communities.find(index);
+    if (it == _communities.end())
+        throw std::out_of_range("Community " + std::to_string(index) + " does not exist");
+    return *it->second;
 }
 
-BERN::Community &BERN::Database::community(int index) {
-    return *_communities[index];
+const BERN::Species *BERN::Database::find_species(int id) const {
+    auto it = _species.find(id);
+    return it == _species.end() ? nullptr : it->second;
+}
+
+const BERN::Community *BERN::Database::find_community(int id) const {
+    auto it = _communities.find(id);
+    return it == _communities.end() ? nullptr : it->second;
 }
 
 void BERN::Database::link(int comm_id, int spec_id) {
     auto comIt = _communities.find(comm_id);
     auto specIt = _species.find(spec_id);
     if (comIt!=_communities.end() && specIt!=_species.end()) {
-        comIt->second->species.push_back(specIt->second);
+        comIt->second->add_species(specIt->second);
+        _species_communities[spec_id].insert(comm_id);
+    }
+
+}
+
+bool BERN::Database::unlink(int comm_id, int spec_id) {
+    auto comIt = _communities.find(comm_id);
+    auto specIt = _species.find(spec_id);
+    if (comIt==_communities.end() || specIt==_species.end()) {
+        return false;
     }
+    Community* comm = comIt->second;
+    if (!comm->remove_species(specIt->second)) {
+        return false;
+    }
+    // The link table may contain a species twice for the same community, keep the index until the last one is gone
+    if (std::find(comm->species().begin(), comm->species().end(), specIt->second) == comm->species().end()) {
+        auto idxIt = _species_communities.find(spec_id);
+        idxIt->second.erase(comm_id);
+        if (idxIt->second.empty())
+            _species_communities.erase(idxIt);
+    }
+    return true;
+}
+
+void BERN::Database::invalidate_species(int spec_id) {
+    auto idxIt = _species_communities.find(spec_id);
+    if (idxIt == _species_communities.end())
+        return;
+    for (int comm_id: idxIt->second) {
+        _communities.at(comm_id)->invalidate();
+    }
+}
+
+void BERN::Database::update_niche(int spec_id, const SiteVector &pessMin, const SiteVector &optMin,
+                                  const SiteVector &optMax, const SiteVector &pessMax) {
+    auto specIt = _species.find(spec_id);
+    if (specIt == _species.end())
+        throw std::out_of_range("Species " + std::to_string(spec_id) + " does not exist");
+    Species& spec = *specIt->second;
+    spec.pess = {SiteVector(pessMin, type()), SiteVector(pessMax, type())};
+    spec.opt = {SiteVector(optMin, type()), SiteVector(optMax, type())};
+    invalidate_species(spec_id);
+}
 
+std::vector<int> BERN::Database::communities_of(int spec_id) const {
+    auto idxIt = _species_communities.find(spec_id);
+    if (idxIt == _species_communities.end())
+        return {};
+    return {idxIt->second.begin(), idxIt->second.end()};
+}
+
+std::vector<int> BERN::Database::outdated_communities() const {
+    std::vector<int> res;
+    for (const auto& it: _communities) {
+        if (it.second->outdated() && it.second->size())
+            res.push_back(it.first);
+    }
+    return res;
 }
 
 int BERN::Database::link_communities(std::string filename) {
+    BERN_PHASE(load_ns);
     //Open the file (exception handling needed)
     std::ifstream relateFile;
     relateFile.open(filename.c_str());
@@ -135,6 +230,7 @@ int BERN::Database::link_communities(std::string filename) {
 }
 
 int BERN::Database::load_species(std::string filename) {
+    BERN_PHASE(load_ns);
     //Open the file (exception handling needed)
     std::ifstream specFile;
     // specFile.exceptions(std::ios::failbit);
@@ -144,11 +240,12 @@ int BERN::Database::load_species(std::string filename) {
     while (specFile.good() && !specFile.eof())
     {
         if (!skip_comment(specFile)) {
-            auto spec = new Species;
+            auto spec = new Species(*_type);
             specFile >> *spec;
-            if (spec->id >= 0)
+            if (spec->id >= 0) {
                 _species[spec->id] = spec;
-            else
+                index_name(spec->name, spec->id, 1);
+            } else
                 delete spec;
             std::getline(specFile, dummy);
         }
@@ -158,7 +255,84 @@ int BERN::Database::load_species(std::string filename) {
 
 }
 
+void BERN::Database::index_name(const std::string &name, int spec_id, int priority) {
+    _names.insert(NameIndex::normalize(name, false), spec_id, priority);
+    _names.insert(NameIndex::normalize(name, true), spec_id, priority);
+}
+
+int BERN::Database::load_synonyms(std::string filename) {
+    BERN_PHASE(load_ns);
+    std::ifstream synFile;
+    synFile.open(filename);
+    if (!synFile) {
+        throw std::runtime_error(filename + " does not exist");
+    }
+    std::string line;
+    int count = 0;
+    while (std::getline(synFile, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        // Columns: species_ID, species_name (with author), species_ID_copy, species_name_synonym
+        std::vector<std::string> fields;
+        std::istringstream columns(line);
+        std::string field;
+        while (std::getline(columns, field, '\t'))
+            fields.push_back(field);
+        // Skips the header and incomplete lines
+        if (fields.size() < 4 || fields[0].empty() || !std::isdigit((unsigned char)fields[0][0]))
+            continue;
+        int spec_id = std::stoi(fields[0]);
+        if (_species.find(spec_id) == _species.end())
+            continue;
+        index_name(fields[1], spec_id, 1);
+        index_name(fields[3], spec_id, 0);
+        ++count;
+    }
+    return count;
+}
+
+int BERN::Database::load_indicators(std::string filename) {
+    return _indicators.load(filename);
+}
+
+BERN::IndicatorMeans BERN::Database::indicator_means(const std::vector<SiteVector> &sites, double threshold) const {
+    std::vector<const Species*> species;
+    for (auto& item: _species)
+        species.push_back(item.second);
+    return BERN::indicator_means(_indicators, species, sites, threshold);
+}
+
+BERN::IndicatorMeans BERN::Database::community_indicator_means(const std::vector<SiteVector> &sites,
+                                                               const Aggregation &aggregation) const {
+    std::vector<const Community*> comms;
+    for (auto& item: _communities)
+        comms.push_back(item.second);
+    return BERN::community_indicator_means(_indicators, comms, sites, aggregation);
+}
+
+int BERN::Database::resolve(const std::string &name, bool strip_authors) const {
+    int id = _names.find(NameIndex::normalize(name, false));
+    if (id < 0 && strip_authors)
+        id = _names.find(NameIndex::normalize(name, true));
+    return id;
+}
+
+BERN::NameResolution BERN::Database::resolve_names(const std::vector<std::string> &names, bool strip_authors) const {
+    NameResolution res;
+    res.ids.resize(names.size());
+#pragma omp parallel for
+    for (int i=0; i < (int)names.size(); ++i) {
+        res.ids[i] = resolve(names[i], strip_authors);
+    }
+    for (size_t i=0; i < names.size(); ++i) {
+        if (res.ids[i] < 0)
+            res.unresolved.push_back(i);
+    }
+    return res;
+}
+
 int BERN::Database::load_communities(std::string filename) {
+    BERN_PHASE(load_ns);
     //Open the file (exception handling needed)
     std::ifstream commFile;
     commFile.open(filename.c_str());
@@ -168,7 +342,7 @@ int BERN::Database::load_communities(std::string filename) {
     {
         if (!skip_comment(commFile))
         {
-            auto com = new BERN::Community;
+            auto com = new BERN::Community(-1, "", *_type);
             commFile >> com->id;
             dummy = commFile.get();
             std::getline(commFile, com->name, '\t');
@@ -181,11 +355,10 @@ int BERN::Database::load_communities(std::string filename) {
 }
 
 void BERN::Database::calculate_optima() const{
+    BERN_PHASE(optimize_ns);
 
-    std::vector<int> comm_ids;
-    std::transform(_communities.begin(), _communities.end(), std::back_inserter(comm_ids),
-                   [](auto & kv){return kv.first;}
-   );
+    // Only communities without a valid optimum need to be calculated
+    std::vector<int> comm_ids = outdated_communities();
 #pragma omp parallel for
     for (int i=0; i<comm_ids.size(); i++){
         try {
@@ -200,6 +373,38 @@ void BERN::Database::calculate_optima() const{
 
 }
 
+void BERN::Database::calculate_optima(const Aggregation &aggregation) const {
+    BERN_PHASE(optimize_ns);
+    std::vector<int> comm_ids = community_ids();
+#pragma omp parallel for
+    for (int i=0; i<(int)comm_ids.size(); i++){
+        try {
+            _communities.at(comm_ids[i])->optimum(aggregation);
+        } catch (const std::runtime_error& e) {
+
+        }
+    }
+}
+
+BERN::OptimumIndex BERN::Database::optimum_index() const {
+    calculate_optima();
+    std::vector<const Community*> comms;
+    for (auto& item: _communities)
+        comms.push_back(item.second);
+    return OptimumIndex(comms);
+}
+
+void BERN::Database::adapt_evaluation_order(const std::vector<SiteVector> &sites) {
+    for (auto& site: sites)
+        if (site.size() != type().size())
+            throw SchemaError(site.size(), type().size());
+    std::vector<int> comm_ids = community_ids();
+#pragma omp parallel for
+    for (int i=0; i<(int)comm_ids.size(); i++){
+        _communities.at(comm_ids[i])->adapt_order(sites);
+    }
+}
+
 std::vector<int> BERN::Database::community_ids() const {
     std::vector<int> res;
     res.reserve(community_size());
@@ -217,3 +422,43 @@ std::vector<int> BERN::Database::species_ids() const {
     }
     return res;
 }
+
+BERN::Community::SpeciesVector BERN::Database::species_list(const std::vector<int> &species_ids) const {
+    Community::SpeciesVector res;
+    res.reserve(species_ids.size());
+    for (int id: species_ids) {
+        auto it = _species.find(id);
+        if (it != _species.end())
+            res.push_back(it->second);
+    }
+    return res;
+}
+
+BERN::Indication BERN::Database::indicate(const std::vector<int> &releve, double alpha) const {
+    return BERN::indicate(species_list(releve), alpha);
+}
+
+std::vector<BERN::Indication> BERN::Database::indicate(const std::vector<std::vector<int>> &releves, double alpha) const {
+    std::vector<Community::SpeciesVector> lists;
+    lists.reserve(releves.size());
+    for (const auto& releve: releves) {
+        lists.push_back(species_list(releve));
+    }
+    return BERN::indicate(lists, alpha);
+}
+
+std::string BERN::Database::stats_json() const {
+    std::stringstream s;
+    s << "{\"stats\": " << stats().json() << ", \"communities\": {";
+    bool first = true;
+    for (const auto& it: _communities) {
+        OptimizerStats opt = it.second->optimizer_stats();
+        if (!opt.iterations)
+            continue;
+        s << (first ? "" : ", ") << "\"" << it.first << "\": {\"optimizer_iterations\": " << opt.iterations
+          << ", \"step_reductions\": " << opt.step_reductions << "}";
+        first = false;
+    }
+    s << "}}";
+    return s.str();
+}
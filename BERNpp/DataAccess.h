@@ -22,10 +22,16 @@
 #include <iostream>
 #include <string>
 #include <memory>
+#include <set>
 #include "SiteVector.h"
 #include "Species.h"
 #include "Community.h"
 #include "Site.h"
+#include "Bioindication.h"
+#include "Names.h"
+#include "Stats.h"
+#include "OptimumIndex.h"
+#include "Indicators.h"
 
 
 namespace BERN {
@@ -39,10 +45,36 @@ namespace BERN {
     private:
         std::map<int, Species*> _species;
         std::map<int, Community*> _communities;
+        ///@brief Reverse index: species id -> ids of the communities containing the species
+        std::map<int, std::set<int>> _species_communities;
+        ///@brief Hash index of the species names and synonyms
+        NameIndex _names;
+        ///@brief Indicator values of the species, see load_indicators
+        IndicatorTable _indicators;
+        ///@brief The site schema of the species and communities
+        std::shared_ptr<const SiteType> _type;
+        void invalidate_species(int spec_id);
+        void index_name(const std::string& name, int spec_id, int priority);
     public:
+        ///@brief A database with the default schema BERN::site_type, see load_variables
+        Database();
+        ///@brief A database with an own site schema, independent of other databases in the same process
+        explicit Database(const std::string& site_type_file);
         ~Database();
-        Species& species(int index);
-        Community& community(int index);;
+        ///@brief The site schema of the database
+        const SiteType& type() const {return *_type;}
+        ///@brief A site of the database schema with NaN values
+        SiteVector site() const {return SiteVector(*_type);}
+        ///@brief The species with the id, throws std::out_of_range if it does not exist.
+        ///The niche is changed with update_niche, to keep the communities up to date
+        const Species& species(int index) const;
+        ///@brief The community with the id, throws std::out_of_range if it does not exist.
+        ///The species of a community are changed with link and unlink, to keep the index of communities_of up to date
+        const Community& community(int index) const;
+        ///@brief Returns the species with the id or nullptr, if the species does not exist
+        const Species* find_species(int id) const;
+        ///@brief Returns the community with the id or nullptr, if the community does not exist
+        const Community* find_community(int id) const;
         size_t  species_size() const {
             return _species.size();
         }
@@ -51,18 +83,74 @@ namespace BERN {
         }
 
 
+        ///@brief Adds a species to a community. Unknown ids are ignored.
         void link(int comm_id, int spec_id);
+        ///@brief Removes a species from a community
+        ///@returns false, if the species is not linked to the community
+        bool unlink(int comm_id, int spec_id);
+        ///@brief Changes the niche of a species (in the database schema) and invalidates the envelopes and optima of all communities containing it
+        void update_niche(int spec_id, const SiteVector& pessMin, const SiteVector& optMin, const SiteVector& optMax, const SiteVector& pessMax);
+        ///@brief Returns the ids of all communities containing the species
+        std::vector<int> communities_of(int spec_id) const;
+        ///@brief Returns the ids of all communities with an outdated optimum
+        std::vector<int> outdated_communities() const;
 
         int load_species(std::string filename);
         int load_communities(std::string filename);
         int link_communities(std::string filename);
+        ///@brief Loads synonyms of the species names (species_synonym.tsv) for the name resolution
+        ///@returns the number of synonyms
+        int load_synonyms(std::string filename);
+        ///@brief Loads indicator values of the species (species_ellenberg.tsv), see IndicatorTable::load
+        ///@returns the number of species with indicator values
+        int load_indicators(std::string filename);
+        ///@brief The loaded indicator values of the species
+        const IndicatorTable& indicators() const {return _indicators;}
+        ///@brief The means of the indicator values at each site weighted by the possibility of all species, see BERN::indicator_means
+        IndicatorMeans indicator_means(const std::vector<SiteVector>& sites, double threshold=0) const;
+        ///@brief The means of the indicator values at each site weighted by the possibility of all communities,
+        ///see BERN::community_indicator_means
+        IndicatorMeans community_indicator_means(const std::vector<SiteVector>& sites, const Aggregation& aggregation=Aggregation()) const;
+        ///@brief Calculates the optima of all outdated communities in parallel
         void calculate_optima() const;
+        ///@brief Calculates the optima of all communities with the aggregation operator in parallel, see Community::optimum
+        void calculate_optima(const Aggregation& aggregation) const;
+        ///@brief Calculates the outdated optima and returns a nearest neighbor index of the optima of all communities
+        OptimumIndex optimum_index() const;
+        ///@brief Orders the species of all communities by their rate of zero possibility at typical sites
+        ///
+        ///Speeds up the evaluation at similar sites, see Community::adapt_order. A later change of a
+        ///community restores the default order by the niche volume.
+        void adapt_evaluation_order(const std::vector<SiteVector>& sites);
         std::vector<int> community_ids() const;
         std::vector<int> species_ids() const;
 
+        ///@brief Returns the hot path counters and phase timings of all threads, see BERN::Stats
+        Stats stats() const {return Stats::collect();}
+        ///@brief Sets all counters of stats() to 0
+        void reset_stats() {Stats::reset();}
+        ///@brief Returns stats() and the optimizer counts of each community as JSON
+        std::string stats_json() const;
+
+        ///@brief Returns the id of a species by its name or synonym, -1 if the name is unknown or ambiguous
+        ///
+        ///Names are compared case insensitive. If strip_authors is true, a name without match is compared
+        ///again without the author citation, see NameIndex::normalize
+        int resolve(const std::string& name, bool strip_authors=true) const;
+        ///@brief Resolves many names to species ids in parallel, see resolve
+        NameResolution resolve_names(const std::vector<std::string>& names, bool strip_authors=true) const;
+
+        ///@brief Returns the species for a list of species ids, unknown ids are ignored
+        Community::SpeciesVector species_list(const std::vector<int>& species_ids) const;
+        ///@brief Estimates the site conditions from a relevé given as species ids, see BERN::indicate
+        Indication indicate(const std::vector<int>& releve, double alpha=0.5) const;
+        ///@brief Estimates the site conditions for many relevés in parallel, see BERN::indicate
+        std::vector<Indication> indicate(const std::vector<std::vector<int>>& releves, double alpha=0.5) const;
+
 
     };
 
+    ///@brief Loads the default schema BERN::site_type, used by Database()
     const BERN::SiteType& load_variables(const std::string & filename);
 
 
@@ -0,0 +1,190 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Grid.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace BERN;
+
+namespace {
+    ///Side length of the blocks at the top level, the unit of parallelisation
+    const size_t top_block = 64;
+    ///Blocks with this number of cells or less are evaluated cell by cell
+    const size_t leaf_cells = 4;
+
+    struct GridCounts {
+        size_t evaluations = 0, bound_evaluations = 0, filled_cells = 0;
+    };
+
+    ///Refines the blocks of a raster recursively, see adaptive_grid
+    class GridRefiner {
+    public:
+        GridRefiner(const std::vector<const Community*>& comms, const std::vector<SiteVector>& cells, size_t cols,
+                    double threshold, double tolerance, const Aggregation& aggregation, GridResult& res)
+            : _comms(comms), _cells(cells), _cols(cols), _threshold(threshold), _tolerance(tolerance),
+              _aggregation(aggregation), _res(res) {}
+
+        ///@param candidates The indices of the communities, that may be the best in the block
+        void refine(size_t r0, size_t c0, size_t h, size_t w, const std::vector<size_t>& candidates, GridCounts& counts) const {
+            if (h * w <= leaf_cells || candidates.empty()) {
+                leaf(r0, c0, h, w, candidates, counts);
+                return;
+            }
+            SiteRange box;
+            if (!block_range(r0, c0, h, w, box)) {
+                split(r0, c0, h, w, candidates, counts);
+                return;
+            }
+            std::vector<PossibilityBounds> bounds;
+            double max_lower = 0;
+            for (size_t c: candidates) {
+                bounds.push_back(_comms[c]->possibility_bounds(box, _aggregation));
+                max_lower = std::max(max_lower, bounds.back().lower);
+            }
+            counts.bound_evaluations += candidates.size();
+            //Communities that are worse than another one everywhere in the block are dropped
+            std::vector<size_t> next;
+            PossibilityBounds best;
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                if (bounds[i].upper >= max_lower && bounds[i].upper > 0) {
+                    next.push_back(candidates[i]);
+                    best = bounds[i];
+                }
+            }
+            if (next.empty()) {
+                //No community is possible anywhere in the block
+                fill(r0, c0, h, w, -1, 0.0, counts);
+            } else if (next.size() == 1 && best.lower > 0 && best.upper - best.lower <= _tolerance &&
+                       (best.lower >= _threshold || best.upper < _threshold)) {
+                fill(r0, c0, h, w, _comms[next[0]]->id, 0.5 * (best.lower + best.upper), counts);
+            } else {
+                split(r0, c0, h, w, next, counts);
+            }
+        }
+
+    private:
+        void split(size_t r0, size_t c0, size_t h, size_t w, const std::vector<size_t>& candidates, GridCounts& counts) const {
+            const size_t h2 = (h + 1) / 2, w2 = (w + 1) / 2;
+            refine(r0, c0, h2, w2, candidates, counts);
+            if (w > w2)
+                refine(r0, c0 + w2, h2, w - w2, candidates, counts);
+            if (h > h2) {
+                refine(r0 + h2, c0, h - h2, w2, candidates, counts);
+                if (w > w2)
+                    refine(r0 + h2, c0 + w2, h - h2, w - w2, candidates, counts);
+            }
+        }
+
+        ///Evaluates each cell, the first community with the highest possibility is the best
+        void leaf(size_t r0, size_t c0, size_t h, size_t w, const std::vector<size_t>& candidates, GridCounts& counts) const {
+            for (size_t r = r0; r < r0 + h; ++r) {
+                for (size_t c = c0; c < c0 + w; ++c) {
+                    const size_t i = r * _cols + c;
+                    double max = 0;
+                    int best = -1;
+                    for (size_t k: candidates) {
+                        const double p = _comms[k]->possibility(_cells[i], _aggregation);
+                        if (p > max) {
+                            max = p;
+                            best = _comms[k]->id;
+                        }
+                    }
+                    counts.evaluations += candidates.size();
+                    _res.best[i] = best;
+                    _res.value[i] = max;
+                    _res.present[i] = max >= _threshold;
+                }
+            }
+        }
+
+        void fill(size_t r0, size_t c0, size_t h, size_t w, int best, double value, GridCounts& counts) const {
+            for (size_t r = r0; r < r0 + h; ++r) {
+                for (size_t c = c0; c < c0 + w; ++c) {
+                    const size_t i = r * _cols + c;
+                    _res.best[i] = best;
+                    _res.value[i] = value;
+                    _res.present[i] = value >= _threshold;
+                }
+            }
+            counts.filled_cells += h * w;
+        }
+
+        ///The range of the site conditions in the block, false if a cell contains NaN
+        bool block_range(size_t r0, size_t c0, size_t h, size_t w, SiteRange& box) const {
+            box.min = box.max = _cells[r0 * _cols + c0];
+            const size_t dims = box.min.size();
+            for (size_t r = r0; r < r0 + h; ++r) {
+                for (size_t c = c0; c < c0 + w; ++c) {
+                    const SiteVector& site = _cells[r * _cols + c];
+                    for (size_t d = 0; d < dims; ++d) {
+                        if (std::isnan(site[d]))
+                            return false;
+                        box.min[d] = std::min(box.min[d], site[d]);
+                        box.max[d] = std::max(box.max[d], site[d]);
+                    }
+                }
+            }
+            return true;
+        }
+
+        const std::vector<const Community*>& _comms;
+        const std::vector<SiteVector>& _cells;
+        size_t _cols;
+        double _threshold, _tolerance;
+        const Aggregation& _aggregation;
+        GridResult& _res;
+    };
+}
+
+GridResult BERN::adaptive_grid(const std::vector<const Community *> &comms, const std::vector<SiteVector> &cells,
+                               size_t rows, size_t cols, double threshold, double tolerance,
+                               const Aggregation &aggregation) {
+    BERN_PHASE(evaluate_ns);
+    if (cells.size() != rows * cols)
+        throw std::invalid_argument("adaptive_grid: " + std::to_string(cells.size()) + " cells for a raster of " +
+                                    std::to_string(rows) + " x " + std::to_string(cols));
+    check_schema(comms, cells);
+    GridResult res;
+    res.rows = rows;
+    res.cols = cols;
+    res.best.resize(cells.size());
+    res.value.resize(cells.size());
+    res.present.resize(cells.size());
+    std::vector<size_t> candidates;
+    for (size_t c = 0; c < comms.size(); ++c) {
+        if (comms[c]->size())
+            candidates.push_back(c);
+    }
+    const GridRefiner refiner(comms, cells, cols, threshold, tolerance, aggregation, res);
+    const size_t block_rows = (rows + top_block - 1) / top_block, block_cols = (cols + top_block - 1) / top_block;
+    size_t evaluations = 0, bound_evaluations = 0, filled_cells = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:evaluations,bound_evaluations,filled_cells)
+    for (int b = 0; b < (int)(block_rows * block_cols); ++b) {
+        const size_t r0 = (b / block_cols) * top_block, c0 = (b % block_cols) * top_block;
+        GridCounts counts;
+        refiner.refine(r0, c0, std::min(top_block, rows - r0), std::min(top_block, cols - c0), candidates, counts);
+        evaluations += counts.evaluations;
+        bound_evaluations += counts.bound_evaluations;
+        filled_cells += counts.filled_cells;
+    }
+    res.evaluations = evaluations;
+    res.bound_evaluations = bound_evaluations;
+    res.filled_cells = filled_cells;
+    return res;
+}
@@ -0,0 +1,67 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Grid_h__
+#define Grid_h__
+
+#include "SiteVector.h"
+#include "Community.h"
+#include <vector>
+
+namespace BERN {
+
+    ///@brief The best community of each cell of a raster, see adaptive_grid
+    struct GridResult {
+        size_t rows = 0;
+        size_t cols = 0;
+        ///@brief Id of the community with the highest possibility (> 0) per cell, row major, -1 if none
+        std::vector<int> best;
+        ///@brief The highest possibility per cell, with an error of at most tolerance / 2
+        std::vector<double> value;
+        ///@brief 1, if the highest possibility of the cell is >= threshold
+        std::vector<int> present;
+        ///@brief Number of Community::possibility calls
+        size_t evaluations = 0;
+        ///@brief Number of Community::possibility_bounds calls
+        size_t bound_evaluations = 0;
+        ///@brief Number of cells filled from a uniform block without evaluation
+        size_t filled_cells = 0;
+    };
+
+    /// Finds the best community for every cell of a raster of sites by adaptive refinement.
+    ///
+    /// The raster is divided into blocks. For each block the bounds of the community possibilities over
+    /// the range of the site conditions in the block are calculated (Community::possibility_bounds). If one
+    /// community is better than all others for the whole block, the threshold is passed or missed in the
+    /// whole block and the bounds of the best community differ less than tolerance, the block is filled.
+    /// Otherwise it is divided into 4 blocks. Communities that cannot be the best in a block are not
+    /// evaluated in its sub blocks. The best community and the threshold classification are exact.
+    /// Uses OpenMP parallelisation over the top level blocks, if available.
+    /// \param comms Communities, communities without species are ignored
+    /// \param cells The sites of the raster, row major, rows * cols. Cells with NaN are evaluated one by one
+    /// \param rows, cols Size of the raster
+    /// \param threshold Threshold of the present flag
+    /// \param tolerance Largest uncertainty of the highest possibility in a filled block. With 0 only blocks
+    ///                  with a constant best possibility (e.g. 0 or 1) are filled
+    /// \param aggregation The aggregation operator of the species possibilities
+    GridResult adaptive_grid(const std::vector<const Community*>& comms, const std::vector<SiteVector>& cells,
+                             size_t rows, size_t cols, double threshold=0.5, double tolerance=0.05,
+                             const Aggregation& aggregation=Aggregation());
+}
+
+#endif // Grid_h__
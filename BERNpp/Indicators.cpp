@@ -0,0 +1,200 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Indicators.h"
+#include "Richness.h"
+#include "Stats.h"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace BERN;
+
+namespace {
+    std::vector<std::string> split_tabs(std::string line) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        std::vector<std::string> fields;
+        std::istringstream columns(line);
+        std::string field;
+        while (std::getline(columns, field, '\t'))
+            fields.push_back(field);
+        return fields;
+    }
+    ///Parses an indicator value, returns false for missing values
+    bool parse_value(const std::string& field, double& value) {
+        char* end = nullptr;
+        value = std::strtod(field.c_str(), &end);
+        return end != field.c_str() && value >= 0;
+    }
+    ///Divides the weighted sums by the weights, NaN for a weight of 0
+    void finish(IndicatorMeans& res) {
+        for (size_t i = 0; i < res.mean.size(); ++i)
+            res.mean[i] = res.weight[i] > 0 ? res.mean[i] / res.weight[i] : NaN;
+    }
+    IndicatorMeans prepare(const IndicatorTable& table, size_t sites) {
+        IndicatorMeans res;
+        res.sites = sites;
+        res.columns = table.columns();
+        res.names = table.names();
+        res.mean.resize(sites * res.columns);
+        res.weight.resize(sites * res.columns);
+        return res;
+    }
+}
+
+int IndicatorTable::load(const std::string &filename) {
+    BERN_PHASE(load_ns);
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error(filename + " does not exist");
+    }
+    std::string line;
+    if (!std::getline(file, line))
+        return 0;
+    // Columns: species id, species name, indicators
+    std::vector<std::string> header = split_tabs(line);
+    if (header.size() < 3)
+        throw std::runtime_error(filename + " has no indicator columns");
+    _names.assign(header.begin() + 2, header.end());
+    _species_ids.clear();
+    _rows.clear();
+    _values.clear();
+    _mask.clear();
+    const size_t n = columns();
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields = split_tabs(line);
+        if (fields.empty() || fields[0].empty() || !std::isdigit((unsigned char)fields[0][0]))
+            continue;
+        const int spec_id = std::stoi(fields[0]);
+        if (_rows.count(spec_id))
+            continue;
+        _rows[spec_id] = rows();
+        _species_ids.push_back(spec_id);
+        for (size_t c = 0; c < n; ++c) {
+            double value = 0;
+            const bool present = c + 2 < fields.size() && parse_value(fields[c + 2], value);
+            _values.push_back(present ? value : 0.0);
+            _mask.push_back(present ? 1.0 : 0.0);
+        }
+    }
+    return int(rows());
+}
+
+size_t IndicatorTable::column(const std::string &name) const {
+    for (size_t c = 0; c < _names.size(); ++c)
+        if (_names[c] == name)
+            return c;
+    throw std::out_of_range("Unknown indicator " + name);
+}
+
+int IndicatorTable::row(int species_id) const {
+    auto it = _rows.find(species_id);
+    return it == _rows.end() ? -1 : int(it->second);
+}
+
+double IndicatorTable::value(int species_id, size_t column) const {
+    if (column >= columns())
+        throw std::out_of_range("Indicator column " + std::to_string(column) + " does not exist");
+    int r = row(species_id);
+    return r >= 0 && mask(r)[column] ? values(r)[column] : NaN;
+}
+
+IndicatorMeans BERN::indicator_means(const IndicatorTable &table, const std::vector<const Species *> &species,
+                                     const std::vector<SiteVector> &sites, double threshold) {
+    BERN_PHASE(evaluate_ns);
+    IndicatorMeans res = prepare(table, sites.size());
+    const size_t nc = table.columns();
+    // Only species with indicator values need to be evaluated
+    std::vector<const Species*> indicated;
+    std::vector<size_t> rows;
+    for (auto spec: species) {
+        int r = table.row(spec->id);
+        if (r >= 0) {
+            indicated.push_back(spec);
+            rows.push_back(size_t(r));
+        }
+    }
+    const SpeciesTable niches(indicated);
+    for (auto& site: sites)
+        if (site.size() != niches.dims())
+            throw SchemaError(site.size(), niches.dims());
+#pragma omp parallel
+    {
+        std::vector<double> poss(niches.size());
+#pragma omp for
+        for (int i = 0; i < (int)sites.size(); ++i) {
+            niches.possibility(sites[i], poss.data(), threshold);
+            double* sum = &res.mean[i * nc];
+            double* weight = &res.weight[i * nc];
+            for (size_t s = 0; s < poss.size(); ++s) {
+                const double p = poss[s];
+                if (p > threshold) {
+                    const double* values = table.values(rows[s]);
+                    const double* mask = table.mask(rows[s]);
+                    for (size_t c = 0; c < nc; ++c) {
+                        sum[c] += p * values[c];
+                        weight[c] += p * mask[c];
+                    }
+                }
+            }
+        }
+    }
+    finish(res);
+    return res;
+}
+
+IndicatorMeans BERN::community_indicator_means(const IndicatorTable &table, const std::vector<const Community *> &comms,
+                                               const std::vector<SiteVector> &sites, const Aggregation &aggregation) {
+    BERN_PHASE(evaluate_ns);
+    check_schema(comms, sites);
+    IndicatorMeans res = prepare(table, sites.size());
+    const size_t nc = table.columns();
+    // The sums of the indicator values and masks of the species of each community
+    std::vector<double> comm_values(comms.size() * nc), comm_mask(comms.size() * nc);
+    for (size_t k = 0; k < comms.size(); ++k) {
+        for (auto spec: comms[k]->species()) {
+            int r = table.row(spec->id);
+            if (r < 0)
+                continue;
+            for (size_t c = 0; c < nc; ++c) {
+                comm_values[k * nc + c] += table.values(r)[c];
+                comm_mask[k * nc + c] += table.mask(r)[c];
+            }
+        }
+    }
+#pragma omp parallel for
+    for (int i = 0; i < (int)sites.size(); ++i) {
+        double* sum = &res.mean[i * nc];
+        double* weight = &res.weight[i * nc];
+        for (size_t k = 0; k < comms.size(); ++k) {
+            if (!comms[k]->size())
+                continue;
+            const double p = comms[k]->possibility(sites[i], aggregation);
+            if (p > 0) {
+                for (size_t c = 0; c < nc; ++c) {
+                    sum[c] += p * comm_values[k * nc + c];
+                    weight[c] += p * comm_mask[k * nc + c];
+                }
+            }
+        }
+    }
+    finish(res);
+    return res;
+}
@@ -0,0 +1,89 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Indicators_h__
+#define Indicators_h__
+
+#include "SiteVector.h"
+#include "Species.h"
+#include "Community.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace BERN {
+
+    ///@brief Indicator values of species (e.g. Ellenberg) as dense columns with missing value masks
+    ///
+    ///Missing values have the mask 0 and the value 0, hence they drop out of weighted sums without branches
+    class IndicatorTable {
+    private:
+        std::vector<std::string> _names;
+        std::vector<int> _species_ids;
+        std::map<int, size_t> _rows;
+        std::vector<double> _values;
+        std::vector<double> _mask;
+    public:
+        ///@brief Loads a table with the columns species id, species name and the indicators (species_ellenberg.tsv)
+        ///
+        ///The first line holds the names of the indicators. Empty, non numeric and negative values
+        ///(-1 marks indifferent species in the Ellenberg system) are missing.
+        ///@returns the number of species
+        int load(const std::string& filename);
+        ///@brief Number of species
+        size_t rows() const {return _species_ids.size();}
+        ///@brief Number of indicators
+        size_t columns() const {return _names.size();}
+        const std::vector<std::string>& names() const {return _names;}
+        const std::vector<int>& species_ids() const {return _species_ids;}
+        ///@brief The position of an indicator by its name, throws std::out_of_range for unknown names
+        size_t column(const std::string& name) const;
+        ///@brief The row of a species, -1 if the species has no indicator values
+        int row(int species_id) const;
+        ///@brief The indicator value of a species, NaN if missing
+        double value(int species_id, size_t column) const;
+        ///@brief The values of a row, 0 for missing values, see mask
+        const double* values(size_t row) const {return &_values[row * columns()];}
+        ///@brief 1 for each present value of a row, 0 for missing values
+        const double* mask(size_t row) const {return &_mask[row * columns()];}
+    };
+
+    ///@brief Weighted means of indicator values at many sites, see indicator_means
+    struct IndicatorMeans {
+        size_t sites = 0;
+        size_t columns = 0;
+        std::vector<std::string> names;
+        ///@brief The weighted means (sites, columns), NaN if no weighted species has a value
+        std::vector<double> mean;
+        ///@brief The sum of weights of the species with a value (sites, columns)
+        std::vector<double> weight;
+    };
+
+    /// The means of the indicator values weighted by the possibility of the species, species with
+    /// a possibility <= threshold are ignored. The species possibilities are evaluated with a
+    /// SpeciesTable scan and summed up in the same pass. Uses OpenMP parallelisation, if available
+    IndicatorMeans indicator_means(const IndicatorTable& table, const std::vector<const Species*>& species,
+                                   const std::vector<SiteVector>& sites, double threshold=0);
+    /// The means of the indicator values of the species of the communities, weighted by the possibility
+    /// of the communities. A species of several possible communities counts for each of them.
+    /// Uses OpenMP parallelisation, if available
+    IndicatorMeans community_indicator_means(const IndicatorTable& table, const std::vector<const Community*>& comms,
+                                             const std::vector<SiteVector>& sites, const Aggregation& aggregation=Aggregation());
+}
+
+#endif // Indicators_h__
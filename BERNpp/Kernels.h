@@ -0,0 +1,127 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Kernels_h__
+#define Kernels_h__
+
+#include <cstddef>
+#include <type_traits>
+#include <algorithm>
+#include <initializer_list>
+
+namespace BERN {
+    ///@brief Evaluation kernels with the number of site dimensions as template parameter
+    ///
+    ///With a known dimension count the compiler unrolls the loops over the site dimensions. The
+    ///template parameter N=0 is the generic kernel, using the runtime dimension count n.
+    ///Use dispatch to select the kernel for SiteVector::dims()
+    namespace kernels {
+
+        /// The trapezoid function, see BERN::trapez
+        inline double trapez(double x, double pMin, double oMin, double oMax, double pMax) {
+            if (x < pMin || x > pMax) { // Outside pessimum
+                return 0;
+            } else if (x < oMin) {  // Left flank
+                return (x - pMin) / (oMin - pMin);
+            } else if (x > oMax) { // Right flank
+                return (pMax - x) / (pMax - oMax);
+            } else { //Optimum plateau
+                return 1;
+            }
+        }
+
+        ///@brief Bounds of the trapezoid function for all x in [lo, hi]
+        ///
+        ///The function is piecewise linear between the niche points, hence the extrema are at the interval ends
+        ///or at niche points inside. The bounds hold for inconsistent niches (e.g. pMin > pMax), too
+        inline void trapez_bounds(double lo, double hi, double pMin, double oMin, double oMax, double pMax,
+                                  double& lower, double& upper) {
+            const double a = trapez(lo, pMin, oMin, oMax, pMax), b = trapez(hi, pMin, oMin, oMax, pMax);
+            lower = std::min(a, b);
+            upper = std::max(a, b);
+            for (double x: {pMin, oMin, oMax, pMax}) {
+                if (x > lo && x < hi) {
+                    const double v = trapez(x, pMin, oMin, oMax, pMax);
+                    lower = std::min(lower, v);
+                    upper = std::max(upper, v);
+                }
+            }
+            // Outside of the pessimum the function jumps to 0
+            if (lo < pMin || hi > pMax)
+                lower = 0;
+        }
+
+        /// The minimum of the trapezoid functions of all dimensions (Liebig's law)
+        template<size_t N>
+        inline double species_possibility(size_t n, const double* x,
+                                          const double* pMin, const double* oMin, const double* oMax, const double* pMax) {
+            const size_t dims = N ? N : n;
+            double minValue = 1;
+            for (size_t i = 0; i < dims; ++i) {
+                minValue = std::min(trapez(x[i], pMin[i], oMin[i], oMax[i], pMax[i]), minValue);
+            }
+            return minValue;
+        }
+
+        /// Like species_possibility, but also returns the first dimension with the minimal possibility
+        template<size_t N>
+        inline double species_possibility(size_t n, const double* x,
+                                          const double* pMin, const double* oMin, const double* oMax, const double* pMax,
+                                          size_t& limiting_dim) {
+            const size_t dims = N ? N : n;
+            double minValue = 1;
+            limiting_dim = 0;
+            for (size_t i = 0; i < dims; ++i) {
+                double poss = trapez(x[i], pMin[i], oMin[i], oMax[i], pMax[i]);
+                if (poss < minValue) {
+                    minValue = poss;
+                    limiting_dim = i;
+                }
+            }
+            return minValue;
+        }
+
+        /// true, if no x[i] is below min[i] or above max[i]. Like trapez, a NaN (missing value) is not outside
+        template<size_t N>
+        inline bool contains(size_t n, const double* x, const double* min, const double* max) {
+            const size_t dims = N ? N : n;
+            bool inside = true;
+            // No early exit, the loop is cheaper without branches
+            for (size_t i = 0; i < dims; ++i) {
+                inside &= !((x[i] < min[i]) | (x[i] > max[i]));
+            }
+            return inside;
+        }
+
+        ///@brief Calls kernel with std::integral_constant<size_t, N>, where N is n for the specialized
+        ///dimension counts and 0 (generic) otherwise
+        ///
+        ///Usage: dispatch(SiteVector::dims(), [&](auto N) {return contains<decltype(N)::value>(...);});
+        template<typename Kernel>
+        inline auto dispatch(size_t n, Kernel&& kernel) -> decltype(kernel(std::integral_constant<size_t, 0>())) {
+            switch (n) {
+                case 5: return kernel(std::integral_constant<size_t, 5>()); // Legacy BERN
+                case 6: return kernel(std::integral_constant<size_t, 6>());
+                case 7: return kernel(std::integral_constant<size_t, 7>()); // site_type.tsv of BERNdata
+                default: return kernel(std::integral_constant<size_t, 0>());
+            }
+        }
+    }
+}
+
+#endif // Kernels_h__
@@ -0,0 +1,300 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "MappedMatrix.h"
+#include "Stats.h"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace BERN;
+
+namespace {
+    ///The .npy header (format version 1.0), padded to a multiple of 64 bytes
+    std::string npy_header(MatrixType type, size_t rows, size_t cols) {
+        const uint16_t one = 1;
+        const char order = *reinterpret_cast<const char*>(&one) ? '<' : '>';
+        std::string descr;
+        switch (type) {
+            case MatrixType::float64: descr = std::string(1, order) + "f8"; break;
+            case MatrixType::float32: descr = std::string(1, order) + "f4"; break;
+            case MatrixType::float16: descr = std::string(1, order) + "f2"; break;
+            case MatrixType::uint8: descr = "|u1"; break;
+        }
+        std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': ("
+                           + std::to_string(rows) + ", " + std::to_string(cols) + "), }";
+        // magic (6), version (2), header length (2), dict, newline
+        const size_t unpadded = 10 + dict.size() + 1;
+        dict.append((64 - unpadded % 64) % 64, ' ');
+        dict += '\n';
+        const size_t len = dict.size();
+        std::string header("\x93NUMPY\x01\x00", 8);
+        header += char(len & 0xff);
+        header += char((len >> 8) & 0xff);
+        return header + dict;
+    }
+#ifndef _WIN32
+    std::runtime_error file_error(const std::string& filename) {
+        return std::runtime_error(filename + ": " + std::strerror(errno));
+    }
+#else
+    std::runtime_error file_error(const std::string& filename) {
+        return std::runtime_error(filename + ": Windows error " + std::to_string(GetLastError()));
+    }
+#endif
+}
+
+uint16_t MappedMatrix::to_float16(double value) {
+    uint64_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    const uint16_t sign = uint16_t((x >> 48) & 0x8000);
+    const int exp = int((x >> 52) & 0x7ff);
+    uint64_t mant = x & ((uint64_t(1) << 52) - 1);
+    if (exp == 0x7ff) // Infinity or NaN
+        return sign | 0x7c00 | (mant ? 0x200 : 0);
+    const int e = exp - 1023 + 15;
+    if (e >= 0x1f) // Overflow
+        return sign | 0x7c00;
+    int shift = 42;
+    uint64_t half;
+    if (e <= 0) { // Subnormal half
+        if (e < -10)
+            return sign;
+        mant |= uint64_t(1) << 52;
+        shift = 43 - e;
+        half = mant >> shift;
+    } else {
+        half = (uint64_t(e) << 10) | (mant >> shift);
+    }
+    // Round to nearest even, a carry into the exponent is correct
+    const uint64_t rem = mant & ((uint64_t(1) << shift) - 1);
+    const uint64_t mid = uint64_t(1) << (shift - 1);
+    if (rem > mid || (rem == mid && (half & 1)))
+        ++half;
+    return uint16_t(sign | half);
+}
+
+float MappedMatrix::from_float16(uint16_t bits) {
+    const uint32_t sign = uint32_t(bits & 0x8000) << 16;
+    const int exp = (bits >> 10) & 0x1f;
+    const uint32_t mant = bits & 0x3ff;
+    float value;
+    if (exp == 0)
+        value = std::ldexp(float(mant), -24);
+    else if (exp == 0x1f)
+        value = mant ? NAN : INFINITY;
+    else
+        value = std::ldexp(float(mant | 0x400), exp - 25);
+    uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    x |= sign;
+    std::memcpy(&value, &x, sizeof(x));
+    return value;
+}
+
+uint8_t MappedMatrix::quantize(double value) {
+    if (std::isnan(value))
+        return 255;
+    return uint8_t(std::lround(std::min(1.0, std::max(0.0, value)) * 254));
+}
+
+MappedMatrix::MappedMatrix(const std::string &filename, size_t rows, size_t cols, MatrixType type, MatrixLayout layout)
+    : _filename(filename), _rows(rows), _cols(cols), _type(type)
+{
+    const std::string header = layout == MatrixLayout::npy ? npy_header(type, rows, cols) : std::string();
+    _header = header.size();
+    _size = _header + rows * cols * element_size();
+#ifdef _WIN32
+    _file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) {
+        _file = nullptr;
+        throw file_error(filename);
+    }
+    if (_size) {
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READWRITE, DWORD(uint64_t(_size) >> 32),
+                                      DWORD(_size & 0xffffffff), nullptr);
+        if (_mapping)
+            _data = static_cast<unsigned char*>(MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, 0, 0, _size));
+        if (!_data) {
+            auto error = file_error(filename);
+            close();
+            throw error;
+        }
+    }
+#else
+    _file = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (_file < 0)
+        throw file_error(filename);
+    if (_size) {
+        void* data = MAP_FAILED;
+        if (::ftruncate(_file, off_t(_size)) == 0)
+            data = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _file, 0);
+        if (data == MAP_FAILED) {
+            auto error = file_error(filename);
+            close();
+            throw error;
+        }
+        _data = static_cast<unsigned char*>(data);
+    }
+#endif
+    if (_header)
+        std::memcpy(_data, header.data(), _header);
+}
+
+MappedMatrix::~MappedMatrix() {
+    close();
+}
+
+size_t MappedMatrix::element_size() const {
+    switch (_type) {
+        case MatrixType::float64: return 8;
+        case MatrixType::float32: return 4;
+        case MatrixType::float16: return 2;
+        default: return 1;
+    }
+}
+
+unsigned char *MappedMatrix::element(size_t row, size_t col) const {
+    if (!_data || row >= _rows || col >= _cols)
+        throw std::out_of_range("Element (" + std::to_string(row) + ", " + std::to_string(col) + ") is not in the matrix "
+                                + _filename);
+    return _data + _header + (row * _cols + col) * element_size();
+}
+
+void MappedMatrix::set(size_t row, size_t col, double value) {
+    write(row, col, &value, 1);
+}
+
+void MappedMatrix::write(size_t row, size_t col, const double *values, size_t n) {
+    if (!n)
+        return;
+    // Checks the first and the last element
+    element(row, col + n - 1);
+    unsigned char* target = element(row, col);
+    for (size_t i = 0; i < n; ++i) {
+        switch (_type) {
+            case MatrixType::float64:
+                std::memcpy(target + 8 * i, values + i, 8);
+                break;
+            case MatrixType::float32: {
+                const float v = float(values[i]);
+                std::memcpy(target + 4 * i, &v, 4);
+                break;
+            }
+            case MatrixType::float16: {
+                const uint16_t v = to_float16(values[i]);
+                std::memcpy(target + 2 * i, &v, 2);
+                break;
+            }
+            case MatrixType::uint8:
+                target[i] = quantize(values[i]);
+                break;
+        }
+    }
+}
+
+double MappedMatrix::get(size_t row, size_t col) const {
+    const unsigned char* source = element(row, col);
+    switch (_type) {
+        case MatrixType::float64: {
+            double v;
+            std::memcpy(&v, source, 8);
+            return v;
+        }
+        case MatrixType::float32: {
+            float v;
+            std::memcpy(&v, source, 4);
+            return v;
+        }
+        case MatrixType::float16: {
+            uint16_t v;
+            std::memcpy(&v, source, 2);
+            return from_float16(v);
+        }
+        default:
+            return *source == 255 ? NaN : *source / 254.0;
+    }
+}
+
+void MappedMatrix::flush() {
+    if (!_data)
+        return;
+#ifdef _WIN32
+    FlushViewOfFile(_data, _size);
+    FlushFileBuffers(_file);
+#else
+    ::msync(_data, _size, MS_SYNC);
+#endif
+}
+
+void MappedMatrix::close() {
+#ifdef _WIN32
+    if (_data) {
+        FlushViewOfFile(_data, _size);
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping)
+        CloseHandle(_mapping);
+    if (_file)
+        CloseHandle(_file);
+    _mapping = nullptr;
+    _file = nullptr;
+#else
+    if (_data)
+        ::munmap(_data, _size);
+    if (_file >= 0)
+        ::close(_file);
+    _file = -1;
+#endif
+    _data = nullptr;
+}
+
+void BERN::possibility_matrix(const std::vector<const Community *> &comms, const std::vector<SiteVector> &sites,
+                              MappedMatrix &out, size_t first_row, const Aggregation &aggregation) {
+    BERN_PHASE(evaluate_ns);
+    if (out.cols() != comms.size())
+        throw std::invalid_argument("The matrix " + out.filename() + " has " + std::to_string(out.cols())
+                                    + " columns for " + std::to_string(comms.size()) + " communities");
+    if (first_row + sites.size() > out.rows())
+        throw std::out_of_range("The matrix " + out.filename() + " has " + std::to_string(out.rows())
+                                + " rows, not " + std::to_string(first_row + sites.size()));
+    check_schema(comms, sites);
+#pragma omp parallel
+    {
+        std::vector<double> row(comms.size());
+#pragma omp for
+        for (int s = 0; s < (int)sites.size(); ++s) {
+            for (size_t c = 0; c < comms.size(); ++c) {
+                try {
+                    row[c] = comms[c]->possibility(sites[s], aggregation);
+                } catch (const std::runtime_error &e) {
+                    row[c] = NaN;
+                }
+            }
+            out.write(first_row + s, 0, row.data(), row.size());
+        }
+    }
+}
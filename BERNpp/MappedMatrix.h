@@ -0,0 +1,109 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef MappedMatrix_h__
+#define MappedMatrix_h__
+
+#include "SiteVector.h"
+#include "Community.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BERN {
+
+    ///@brief The element type of a MappedMatrix
+    enum class MatrixType {
+        float64,
+        float32,
+        ///@brief IEEE half precision, round to nearest even
+        float16,
+        ///@brief Quantized possibilities: value * 254 rounded, 255 for NaN. Values are clamped to 0..1
+        uint8
+    };
+
+    ///@brief The file layout of a MappedMatrix
+    enum class MatrixLayout {
+        ///@brief The values only, row major
+        raw,
+        ///@brief The NumPy .npy format (version 1.0), can be opened with numpy.load(filename, mmap_mode='r')
+        npy
+    };
+
+    ///@brief A row major matrix in a memory mapped file, for results that do not fit in memory
+    ///
+    ///The file is created with its final size. Values are converted to the element type on writing, hence
+    ///only the pages of the file are held in memory and the operating system writes them back when needed.
+    ///Threads may write disjoint parts of the matrix at the same time without locks.
+    class MappedMatrix {
+    public:
+        MappedMatrix(const std::string& filename, size_t rows, size_t cols,
+                     MatrixType type=MatrixType::float32, MatrixLayout layout=MatrixLayout::npy);
+        ~MappedMatrix();
+        MappedMatrix(const MappedMatrix&) = delete;
+        MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+        size_t rows() const {return _rows;}
+        size_t cols() const {return _cols;}
+        MatrixType type() const {return _type;}
+        const std::string& filename() const {return _filename;}
+        ///@brief Bytes per element
+        size_t element_size() const;
+        ///@brief Bytes before the first element (the .npy header)
+        size_t header_size() const {return _header;}
+
+        ///@brief Writes a single value
+        void set(size_t row, size_t col, double value);
+        ///@brief Writes n values of a row, starting at col
+        void write(size_t row, size_t col, const double* values, size_t n);
+        ///@brief Reads a value back, converted to double
+        double get(size_t row, size_t col) const;
+        ///@brief Writes the changed pages to the file
+        void flush();
+        ///@brief Flushes and unmaps the file, the matrix can not be used afterwards
+        void close();
+
+        ///@brief Converts a value to half precision (bits of IEEE binary16)
+        static uint16_t to_float16(double value);
+        static float from_float16(uint16_t bits);
+        ///@brief Quantizes a possibility to 0..254, 255 for NaN
+        static uint8_t quantize(double value);
+    private:
+        std::string _filename;
+        size_t _rows, _cols;
+        MatrixType _type;
+        size_t _header = 0;
+        size_t _size = 0;
+        unsigned char* _data = nullptr;
+#ifdef _WIN32
+        void* _file = nullptr;
+        void* _mapping = nullptr;
+#else
+        int _file = -1;
+#endif
+        unsigned char* element(size_t row, size_t col) const;
+    };
+
+    /// Writes the possibilities of the communities at the sites into rows first_row ... of out.
+    /// Calling it for chunks of sites keeps the memory constant. Each thread converts and writes whole rows.
+    /// Communities without species result in NaN. Uses OpenMP parallelisation, if available
+    void possibility_matrix(const std::vector<const Community*>& comms, const std::vector<SiteVector>& sites,
+                            MappedMatrix& out, size_t first_row=0, const Aggregation& aggregation=Aggregation());
+}
+
+#endif // MappedMatrix_h__
@@ -0,0 +1,162 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Names.h"
+#include <cctype>
+#include <algorithm>
+
+using namespace BERN;
+
+namespace {
+    bool is_rank(const std::string& token) {
+        return token == "subsp." || token == "ssp." || token == "var." || token == "f." || token == "cv.";
+    }
+    bool is_group(const std::string& token) {
+        return token == "agg." || token == "aggr." || token == "s.l." || token == "s.str.";
+    }
+    bool is_epithet(const std::string& token) {
+        if (token.empty() || !std::islower((unsigned char)token[0]))
+            return false;
+        for (char c: token) {
+            if (c == '.' || c == '(' || c == ')' || c == '&' || c == ',')
+                return false;
+        }
+        return true;
+    }
+}
+
+std::string NameIndex::normalize(const std::string &name, bool strip_authors) {
+    //Split at white space, the UTF-8 multiplication sign used for hybrids is a token of its own
+    std::vector<std::string> tokens;
+    std::string token;
+    for (size_t i=0; i < name.size(); ++i) {
+        const unsigned char c = name[i];
+        if (c == 0xC3 && i + 1 < name.size() && (unsigned char)name[i + 1] == 0x97) {
+            if (!token.empty())
+                tokens.push_back(std::move(token));
+            tokens.emplace_back("x");
+            token.clear();
+            ++i;
+        } else if (std::isspace(c)) {
+            if (!token.empty())
+                tokens.push_back(std::move(token));
+            token.clear();
+        } else {
+            token += (char)c;
+        }
+    }
+    if (!token.empty())
+        tokens.push_back(std::move(token));
+    std::string res;
+    res.reserve(name.size());
+    auto append = [&res](const std::string& token) {
+        if (!res.empty())
+            res += ' ';
+        for (char c: token)
+            res += (char)std::tolower((unsigned char)c);
+    };
+    if (!strip_authors) {
+        for (const auto& token: tokens)
+            append(token);
+        return res;
+    }
+    if (tokens.empty())
+        return res;
+    // Genus
+    append(tokens[0]);
+    bool expect_epithet = true;
+    for (size_t i=1; i < tokens.size(); ++i) {
+        const std::string& token = tokens[i];
+        if (token == "x" || token == "X") {
+            append("x");
+            expect_epithet = true;
+        } else if (is_rank(token)) {
+            append(token == "ssp." ? "subsp." : token);
+            expect_epithet = true;
+        } else if (is_group(token)) {
+            append(token);
+            expect_epithet = false;
+        } else if (expect_epithet && is_epithet(token)) {
+            append(token);
+            expect_epithet = false;
+        }
+        // Everything else belongs to an author citation
+    }
+    return res;
+}
+
+uint64_t NameIndex::hash(const std::string &key) {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (char c: key) {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+size_t NameIndex::probe(const std::string &key, uint64_t h) const {
+    const size_t mask = _slots.size() - 1;
+    size_t pos = h & mask;
+    while (_slots[pos].priority >= 0 && !(_slots[pos].hash == h && _slots[pos].key == key)) {
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+void NameIndex::rehash(size_t capacity) {
+    std::vector<Slot> old;
+    old.swap(_slots);
+    _slots.resize(capacity);
+    for (auto& slot: old) {
+        if (slot.priority >= 0) {
+            _slots[probe(slot.key, slot.hash)] = std::move(slot);
+        }
+    }
+}
+
+void NameIndex::insert(const std::string &normalized_name, int id, int priority) {
+    if (normalized_name.empty() || priority < 0)
+        return;
+    // Keep the load factor below 0.5
+    if (2 * (_count + 1) > _slots.size())
+        rehash(std::max<size_t>(64, 2 * _slots.size()));
+    uint64_t h = hash(normalized_name);
+    Slot& slot = _slots[probe(normalized_name, h)];
+    if (slot.priority < 0) {
+        slot.hash = h;
+        slot.key = normalized_name;
+        slot.id = id;
+        slot.priority = priority;
+        ++_count;
+    } else if (priority > slot.priority) {
+        slot.id = id;
+        slot.priority = priority;
+        slot.ambiguous = false;
+    } else if (priority == slot.priority && id != slot.id) {
+        slot.ambiguous = true;
+    }
+}
+
+int NameIndex::find(const std::string &normalized_name) const {
+    if (_slots.empty())
+        return -1;
+    const Slot& slot = _slots[probe(normalized_name, hash(normalized_name))];
+    if (slot.priority < 0 || slot.ambiguous)
+        return -1;
+    return slot.id;
+}
@@ -0,0 +1,76 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Names_h__
+#define Names_h__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace BERN {
+    ///@brief A hash index of normalized species names and synonyms to species ids
+    ///
+    ///The index uses open addressing with linear probing. Lookups do not change the index,
+    ///hence many threads can resolve names at the same time.
+    class NameIndex {
+    public:
+        ///@brief Normalizes a scientific name for the lookup
+        ///
+        ///The name is lower cased, white space is collapsed and the hybrid sign × is replaced by x.
+        ///If strip_authors is true, only the genus, hybrid markers, rank markers (subsp., var., f., agg.)
+        ///and the epithets are kept, e.g. "Festuca perennis (L.) Columbus & J.P.Sm." -> "festuca perennis"
+        static std::string normalize(const std::string& name, bool strip_authors=false);
+
+        ///@brief Adds a normalized name to the index
+        ///
+        ///A name already in the index is replaced, if the new priority is higher. Names with the same
+        ///priority but different species become ambiguous and are not resolved
+        void insert(const std::string& normalized_name, int id, int priority);
+
+        ///@brief Returns the species id of a normalized name or -1 if the name is unknown or ambiguous
+        int find(const std::string& normalized_name) const;
+
+        ///@brief Number of names in the index
+        size_t size() const {return _count;}
+
+    private:
+        struct Slot {
+            uint64_t hash = 0;
+            int id = -1;
+            int priority = -1;
+            bool ambiguous = false;
+            std::string key;
+        };
+        std::vector<Slot> _slots;
+        size_t _count = 0;
+        static uint64_t hash(const std::string& key);
+        size_t probe(const std::string& key, uint64_t h) const;
+        void rehash(size_t capacity);
+    };
+
+    ///@brief The result of a batch name resolution
+    struct NameResolution {
+        ///@brief The species id for each name, -1 for unresolved names
+        std::vector<int> ids;
+        ///@brief The position of the unresolved names in the input
+        std::vector<size_t> unresolved;
+    };
+}
+
+#endif // Names_h__
@@ -0,0 +1,123 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Optimizer_h__
+#define Optimizer_h__
+
+#include "SiteVector.h"
+#include "Stats.h"
+#include <cmath>
+
+namespace BERN {
+
+    /// Integer power function, cheaper then pow
+    inline int ipow(int base, int exponent) {
+        if (!exponent) { return 1;}
+        int res = base;
+        for (int i=1; i<exponent; ++i) {
+            res *= base;
+        }
+        return res;
+    }
+
+    ///@brief Finds the maximum of a possibility function in the site space, starting at start
+    ///
+    ///Since the possibility function's derivate is not a continuous function, usual n-dimension numeric solutions for optimum problems are not suitable
+    ///The optimum is calculated by trying in the n direction at specified step width. If no position with a higher possibility value is found,
+    ///the step width is divided by 10, until the step width is smaller then the accuracy of the schema of start
+    ///@param objective A callable double(const SiteVector&) returning a possibility in [0..1]
+    ///@param start The site to start the search
+    ///@param stats If given, gets the number of iterations and step width reductions
+    ///@param step_factor The first step width as multiple of SiteType::accuracy, a power of 10.
+    ///                   Smaller values save the first iterations, if the optimum is known to be close to start
+    template<typename Objective>
+    Possibility maximize(const Objective& objective, const SiteVector& start, OptimizerStats* stats=nullptr,
+                         double step_factor=1e10)
+    {
+        OptimizerStats counts;
+        //Site near actual to test for higher possibility
+        SiteVector  test(start.type());
+        double
+                curVal=0,
+                bestVal,
+                testVal=0;
+        SiteVector curSite=start;
+        //Each step in any dimension is a multiple of the calculation accuracy of that dimension (stored in SiteVector::CalcAccuracy)
+        double stepWidthFactor = step_factor;
+        //As long as the factor of the step width factor is greater than 1
+        while (stepWidthFactor >= 1) {
+            ++counts.iterations;
+            BERN_COUNT(optimizer_iterations);
+            //Calculate the possibility at the actual site
+            curVal = objective(curSite);
+            if (curVal > 1 - 1e-12) {
+                break;
+            }
+            //An "in between" storage for the preliminary best neighbor
+            SiteVector best = curSite;
+            bestVal = curVal;
+            //hasDir becomes true if a direction towards a higher possibility value is found. If it becomes false the step width is adjusted
+            bool hasDir = false;
+            //Calculate the step width vector for all site parameters
+            SiteVector stepWidthVector = start.type().accuracy() * stepWidthFactor;
+            //Test in each dimension, 3 directions per dimension: left, no move, right
+            //Possible combinations (including the actual position) is direction^dimensions
+            size_t dims = start.size();
+            int combinations = ipow(3, int(dims));
+            for (int i = 0; i < combinations; i++) {
+                //If i is not pointing on the actual site conditions
+                if (i != (combinations - 1) / 2) {
+                    //Populate the direction vector, the digits of i in base 3 are the directions [0,1,2] per dimension
+                    int digits = i;
+                    for (size_t d = 0; d < dims; d++) {
+                        test[d] = curSite[d] + (digits % 3 - 1) * stepWidthVector[d];
+                        digits /= 3;
+                    }
+                    //Calculate the possiblity at the test site
+                    testVal = objective(test);
+                    //Is the test site the best neighbor until now?
+                    if (testVal > bestVal) {
+                        //test is the best...
+                        best = test;
+                        bestVal = testVal;
+                        //We've found a Direction for further search of the optimum
+                        hasDir = true;
+                    }
+                }
+            }
+            //A "better" direction found
+            if (hasDir)
+                //Take the best estimate as the new actual site condition
+                curSite = best;
+            else {
+                //Minimize the step width
+                stepWidthFactor /= 10;
+                ++counts.step_reductions;
+                BERN_COUNT(step_reductions);
+            }
+        } //While (stepWidthFactor>=1)
+
+        //The optimum is found in the given accuracy
+        if (stats)
+            *stats = counts;
+        return {curSite, curVal};
+    }
+
+}
+
+#endif // Optimizer_h__
@@ -0,0 +1,223 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "OptimumIndex.h"
+#include "Stats.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <stdexcept>
+
+using namespace BERN;
+
+namespace {
+    ///Keeps the k closest neighbors in a max heap
+    struct NearestVisitor {
+        size_t k;
+        std::priority_queue<Neighbor> heap;
+        explicit NearestVisitor(size_t k_) : k(k_) {}
+        ///Squared distance, nodes farther away than this can not improve the result
+        double bound() const {
+            return heap.size() < k ? INFINITY : heap.top().distance;
+        }
+        void add(int id, double dist2) {
+            Neighbor n(id, dist2);
+            if (heap.size() < k)
+                heap.push(n);
+            else if (n < heap.top()) {
+                heap.pop();
+                heap.push(n);
+            }
+        }
+        NeighborVector result() {
+            NeighborVector res(heap.size());
+            for (size_t i = res.size(); i > 0; --i) {
+                res[i - 1] = heap.top();
+                heap.pop();
+            }
+            for (auto& n: res)
+                n.distance = std::sqrt(n.distance);
+            return res;
+        }
+    };
+    ///Collects all neighbors inside a radius
+    struct RadiusVisitor {
+        double radius2;
+        NeighborVector found;
+        explicit RadiusVisitor(double radius) : radius2(radius * radius) {}
+        double bound() const {
+            return radius2;
+        }
+        void add(int id, double dist2) {
+            if (dist2 <= radius2)
+                found.push_back(Neighbor(id, dist2));
+        }
+        NeighborVector result() {
+            std::sort(found.begin(), found.end());
+            for (auto& n: found)
+                n.distance = std::sqrt(n.distance);
+            return found;
+        }
+    };
+}
+
+SiteVector OptimumIndex::normalize(const SiteVector &site) {
+    SiteVector res(site);
+    for (size_t d = 0; d < res.size(); ++d)
+        res[d] = (site[d] - site.type()[d].min) / (site.type()[d].max - site.type()[d].min);
+    return res;
+}
+
+OptimumIndex::OptimumIndex(const std::vector<const Community *> &comms)
+    : _dims(comms.empty() ? SiteVector::dims() : comms[0]->type().size()),
+      _type(comms.empty() ? site_type.share() : comms[0]->type().share())
+{
+    for (auto comm: comms) {
+        if (!comm->size())
+            continue;
+        if (comm->type().size() != _dims)
+            throw SchemaError(comm->type().size(), _dims);
+        Possibility opt = comm->optimum();
+        if (!(opt.value > 0))
+            continue;
+        SiteVector p = normalize(opt.site);
+        _points.insert(_points.end(), p.begin(), p.end());
+        _ids.push_back(comm->id);
+    }
+    _split.resize(_ids.size());
+    build(0, _ids.size());
+}
+
+void OptimumIndex::build(size_t lo, size_t hi) {
+    if (hi - lo < 2)
+        return;
+    // Split at the dimension with the largest spread
+    size_t split = 0;
+    double spread = -1;
+    for (size_t d = 0; d < _dims; ++d) {
+        double dmin = INFINITY, dmax = -INFINITY;
+        for (size_t i = lo; i < hi; ++i) {
+            dmin = std::min(dmin, _points[i * _dims + d]);
+            dmax = std::max(dmax, _points[i * _dims + d]);
+        }
+        if (dmax - dmin > spread) {
+            spread = dmax - dmin;
+            split = d;
+        }
+    }
+    // Move the median to the middle, points and ids are permuted together
+    size_t mid = (lo + hi) / 2;
+    std::vector<size_t> order(hi - lo);
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = lo + i;
+    std::nth_element(order.begin(), order.begin() + (mid - lo), order.end(),
+                     [&](size_t a, size_t b) {
+                         return _points[a * _dims + split] < _points[b * _dims + split];
+                     });
+    std::vector<double> points(order.size() * _dims);
+    std::vector<int> ids(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        std::copy_n(_points.begin() + order[i] * _dims, _dims, points.begin() + i * _dims);
+        ids[i] = _ids[order[i]];
+    }
+    std::copy(points.begin(), points.end(), _points.begin() + lo * _dims);
+    std::copy(ids.begin(), ids.end(), _ids.begin() + lo);
+    _split[mid] = (unsigned char)split;
+    build(lo, mid);
+    build(mid + 1, hi);
+}
+
+template<typename Visitor>
+void OptimumIndex::search(const double *query, size_t lo, size_t hi, Visitor &visitor) const {
+    if (lo >= hi)
+        return;
+    size_t mid = (lo + hi) / 2;
+    const double* p = &_points[mid * _dims];
+    // Missing values of the query do not count, like in the trapezoid of the niches
+    double dist2 = 0;
+    for (size_t d = 0; d < _dims; ++d) {
+        const double delta = query[d] - p[d];
+        if (!std::isnan(delta))
+            dist2 += delta * delta;
+    }
+    visitor.add(_ids[mid], dist2);
+    if (hi - lo == 1)
+        return;
+    // Search the side of the query first, the other side only if the split plane is close enough
+    double offset = query[_split[mid]] - p[_split[mid]];
+    if (std::isnan(offset)) {
+        // A missing split value does not separate the sides
+        search(query, lo, mid, visitor);
+        search(query, mid + 1, hi, visitor);
+    } else if (offset < 0) {
+        search(query, lo, mid, visitor);
+        if (offset * offset <= visitor.bound())
+            search(query, mid + 1, hi, visitor);
+    } else {
+        search(query, mid + 1, hi, visitor);
+        if (offset * offset <= visitor.bound())
+            search(query, lo, mid, visitor);
+    }
+}
+
+void OptimumIndex::check(const SiteVector &site) const {
+    if (site.size() != _dims && size())
+        throw SchemaError(site.size(), _dims);
+}
+
+NeighborVector OptimumIndex::nearest(const SiteVector &site, size_t k) const {
+    check(site);
+    NearestVisitor visitor(k);
+    // An empty index (e.g. default constructed) has no schema
+    if (k && size()) {
+        SiteVector query = normalize(SiteVector(site, *_type));
+        search(&query[0], 0, size(), visitor);
+    }
+    return visitor.result();
+}
+
+NeighborVector OptimumIndex::within(const SiteVector &site, double radius) const {
+    check(site);
+    RadiusVisitor visitor(radius);
+    if (radius >= 0 && size()) {
+        SiteVector query = normalize(SiteVector(site, *_type));
+        search(&query[0], 0, size(), visitor);
+    }
+    return visitor.result();
+}
+
+std::vector<NeighborVector> OptimumIndex::nearest(const std::vector<SiteVector> &sites, size_t k) const {
+    BERN_PHASE(evaluate_ns);
+    std::vector<NeighborVector> res(sites.size());
+    for (auto& site: sites)
+        check(site);
+#pragma omp parallel for
+    for (int i = 0; i < (int)sites.size(); ++i)
+        res[i] = nearest(sites[i], k);
+    return res;
+}
+
+std::vector<NeighborVector> OptimumIndex::within(const std::vector<SiteVector> &sites, double radius) const {
+    BERN_PHASE(evaluate_ns);
+    std::vector<NeighborVector> res(sites.size());
+    for (auto& site: sites)
+        check(site);
+#pragma omp parallel for
+    for (int i = 0; i < (int)sites.size(); ++i)
+        res[i] = within(sites[i], radius);
+    return res;
+}
@@ -0,0 +1,83 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef OptimumIndex_h__
+#define OptimumIndex_h__
+
+#include "SiteVector.h"
+#include "Community.h"
+#include <vector>
+
+namespace BERN {
+
+    ///@brief A community found by OptimumIndex with the distance of its optimum
+    struct Neighbor {
+        int id = -1;
+        ///@brief Euclidean distance in normalized units, each SiteValue range (min..max) has the length 1
+        double distance = NaN;
+        Neighbor() = default;
+        Neighbor(int id_, double distance_) : id(id_), distance(distance_) {}
+        bool operator<(const Neighbor& other) const {
+            return distance < other.distance || (distance == other.distance && id < other.id);
+        }
+    };
+    typedef std::vector<Neighbor> NeighborVector;
+
+    ///@brief k-d tree over the optimal sites of communities, for "most similar community" queries
+    ///
+    ///The optima and the queries are normalized by the ranges of the SiteValues of the community schema. Communities without species or with an
+    ///optimum possibility of 0 are not indexed. The index is a snapshot, build it after
+    ///Database::calculate_optima, since Community::optimum() is calculated on demand otherwise.
+    ///Queries are thread safe. Results are sorted by distance, ties by community id. Missing values (NaN) of a query
+    ///are ignored in the distance
+    class OptimumIndex {
+    public:
+        explicit OptimumIndex(const std::vector<const Community*>& comms);
+        OptimumIndex() = default;
+        ///@brief Number of indexed communities
+        size_t size() const {return _ids.size();}
+        ///@brief The site in normalized units of its schema
+        static SiteVector normalize(const SiteVector& site);
+
+        ///@brief The k communities with the optimum closest to site
+        NeighborVector nearest(const SiteVector& site, size_t k) const;
+        ///@brief All communities with the optimum not farther than radius from site
+        NeighborVector within(const SiteVector& site, double radius) const;
+        /// Batch version of nearest, uses OpenMP parallelisation, if available
+        std::vector<NeighborVector> nearest(const std::vector<SiteVector>& sites, size_t k) const;
+        /// Batch version of within, uses OpenMP parallelisation, if available
+        std::vector<NeighborVector> within(const std::vector<SiteVector>& sites, double radius) const;
+
+    private:
+        size_t _dims = 0;
+        ///@brief The site schema of the communities
+        std::shared_ptr<const SiteType> _type;
+        ///@brief The normalized optima in tree order, the node of the range [lo, hi) is at (lo + hi) / 2
+        std::vector<double> _points;
+        std::vector<int> _ids;
+        ///@brief The split dimension of each node
+        std::vector<unsigned char> _split;
+        void build(size_t lo, size_t hi);
+        ///@brief Throws a SchemaError, if the site does not have the dimensions of the index
+        void check(const SiteVector& site) const;
+        template<typename Visitor>
+        void search(const double* query, size_t lo, size_t hi, Visitor& visitor) const;
+    };
+}
+
+#endif // OptimumIndex_h__
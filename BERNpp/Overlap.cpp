@@ -0,0 +1,140 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Overlap.h"
+#include "Optimizer.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace BERN;
+
+namespace {
+    ///An overlapping pair of communities
+    struct Overlap {
+        size_t row, col;
+        double volume, joint;
+        bool operator<(const Overlap& other) const {
+            return row < other.row || (row == other.row && col < other.col);
+        }
+    };
+}
+
+OverlapMatrix BERN::envelope_overlap(const std::vector<const Community *> &comms, bool joint,
+                                     const Aggregation &aggregation) {
+    BERN_PHASE(evaluate_ns);
+    const size_t nc = comms.size();
+    // All communities share the schema of the first one
+    const SiteType& type = nc ? comms[0]->type() : site_type;
+    const size_t dims = type.size();
+    // The envelopes as flat arrays, dimension minor, without heap vectors in the inner loop
+    std::vector<double> lo(nc * dims), hi(nc * dims), range(dims);
+    const SiteVector accuracy = type.accuracy();
+    std::vector<size_t> boxes;
+    for (size_t d = 0; d < dims; ++d)
+        range[d] = type[d].max - type[d].min;
+    for (size_t c = 0; c < nc; ++c) {
+        if (comms[c]->type().size() != dims)
+            throw SchemaError(comms[c]->type().size(), dims);
+        if (!comms[c]->size())
+            continue;
+        SiteRange env = comms[c]->envelope();
+        bool empty = false;
+        for (size_t d = 0; d < dims; ++d) {
+            lo[c * dims + d] = env.min[d];
+            hi[c * dims + d] = env.max[d];
+            empty |= !(env.min[d] <= env.max[d]);
+        }
+        if (!empty)
+            boxes.push_back(c);
+    }
+    // Sweep along the dimension with the narrowest envelopes relative to the range
+    size_t sweep = 0;
+    double narrowest = INFINITY;
+    for (size_t d = 0; d < dims; ++d) {
+        double width = 0;
+        for (size_t c: boxes)
+            width += (hi[c * dims + d] - lo[c * dims + d]) / range[d];
+        if (width < narrowest) {
+            narrowest = width;
+            sweep = d;
+        }
+    }
+    std::sort(boxes.begin(), boxes.end(), [&](size_t a, size_t b) {
+        return lo[a * dims + sweep] < lo[b * dims + sweep] || (lo[a * dims + sweep] == lo[b * dims + sweep] && a < b);
+    });
+
+    // The pairs found for each box in the sweep order, written by one thread each
+    std::vector<std::vector<Overlap>> pairs(boxes.size());
+    size_t tested = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:tested)
+    for (int k = 0; k < (int)boxes.size(); ++k) {
+        const size_t a = boxes[k];
+        const double* alo = &lo[a * dims];
+        const double* ahi = &hi[a * dims];
+        // All boxes starting before the end of a in the sweep dimension
+        for (size_t l = k + 1; l < boxes.size() && lo[boxes[l] * dims + sweep] <= ahi[sweep]; ++l) {
+            const size_t b = boxes[l];
+            const double* blo = &lo[b * dims];
+            const double* bhi = &hi[b * dims];
+            ++tested;
+            double volume = 1;
+            bool intersects = true;
+            for (size_t d = 0; d < dims; ++d) {
+                const double width = std::min(ahi[d], bhi[d]) - std::max(alo[d], blo[d]);
+                intersects &= width >= 0;
+                volume *= std::max(width, 0.0) / range[d];
+            }
+            if (!intersects)
+                continue;
+            double joint_possibility = NaN;
+            if (joint) {
+                SiteRange box(type);
+                for (size_t d = 0; d < dims; ++d) {
+                    box.min[d] = std::max(alo[d], blo[d]);
+                    box.max[d] = std::min(ahi[d], bhi[d]);
+                }
+                // The first step width is the largest power of 10 of the accuracy inside the intersection
+                double steps = 1;
+                for (size_t d = 0; d < dims; ++d)
+                    steps = std::max(steps, (box.max[d] - box.min[d]) / accuracy[d]);
+                // Outside of the intersection min(p_a, p_b) is 0 for absorbing operators, the search stays inside
+                joint_possibility = maximize([&](const SiteVector& site) {
+                    if (!box.contains(site))
+                        return 0.0;
+                    return std::min(comms[a]->possibility(site, aggregation), comms[b]->possibility(site, aggregation));
+                }, box.center(), nullptr, std::pow(10.0, std::floor(std::log10(steps)))).value;
+            }
+            pairs[k].push_back({std::min(a, b), std::max(a, b), volume, joint_possibility});
+        }
+    }
+
+    OverlapMatrix res;
+    res.communities = nc;
+    res.tested_pairs = tested;
+    // Sorted by row and column, independent of the sweep order
+    std::vector<Overlap> all;
+    for (const auto& list: pairs)
+        all.insert(all.end(), list.begin(), list.end());
+    std::sort(all.begin(), all.end());
+    for (const Overlap& o: all) {
+        res.rows.push_back(o.row);
+        res.cols.push_back(o.col);
+        res.volume.push_back(o.volume);
+        res.joint.push_back(o.joint);
+    }
+    return res;
+}
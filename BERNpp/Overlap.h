@@ -0,0 +1,58 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Overlap_h__
+#define Overlap_h__
+
+#include "SiteVector.h"
+#include "Community.h"
+#include <vector>
+
+namespace BERN {
+
+    ///@brief Sparse matrix of the envelope overlaps of communities in coordinate format (COO)
+    ///
+    ///Only pairs with intersecting envelopes are stored, each pair once with row < col.
+    ///Rows and columns are indices of the communities given to envelope_overlap
+    struct OverlapMatrix {
+        size_t communities = 0;
+        std::vector<size_t> rows, cols;
+        ///@brief Volume of the intersection of the envelopes, normalized by the ranges of the SiteValues
+        std::vector<double> volume;
+        ///@brief The highest min(p_a, p_b) in the intersection, NaN if not calculated
+        std::vector<double> joint;
+        ///@brief Number of pairs tested in all dimensions after the sweep
+        size_t tested_pairs = 0;
+        size_t size() const {return rows.size();}
+    };
+
+    /// Finds all pairs of communities with intersecting envelopes.
+    ///
+    /// The envelopes are sorted along the dimension that separates them best, only pairs overlapping in this
+    /// dimension are tested in the others (sweep and prune). Communities without species or with an empty
+    /// envelope have no overlaps. Uses OpenMP parallelisation, if available, the result does not depend on it.
+    /// \param comms The communities
+    /// \param joint If true, the highest joint possibility min(p_a, p_b) in the intersection is searched by
+    ///              BERN::maximize from the center of the intersection, with a first step width fitting into
+    ///              the intersection. This is expensive, about 10 ms per pair for the shipped database
+    /// \param aggregation The aggregation operator for the joint possibility
+    OverlapMatrix envelope_overlap(const std::vector<const Community*>& comms, bool joint=false,
+                                   const Aggregation& aggregation=Aggregation());
+}
+
+#endif // Overlap_h__
@@ -0,0 +1,65 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Random_h__
+#define Random_h__
+
+#include <cstdint>
+#include <cmath>
+
+namespace BERN {
+    ///@brief A stateless, counter based random number generator
+    ///
+    ///Each number is a hash of the seed, a stream id (e.g. the site) and a counter (e.g. the sample), hence the
+    ///numbers do not depend on the order of the evaluation or the number of threads. The hash is a
+    ///variant of the SplitMix64 finalizer, good enough for Monte Carlo sampling, not for cryptography.
+    class CounterRNG {
+    public:
+        uint64_t seed;
+        explicit CounterRNG(uint64_t seed_=0) : seed(seed_) {}
+
+        ///@brief Returns 64 random bits for a stream and counter
+        uint64_t bits(uint64_t stream, uint64_t counter) const {
+            uint64_t z = mix(seed ^ mix(stream + 0x9E3779B97F4A7C15ull)) + counter * 0xD1B54A32D192ED03ull;
+            return mix(z);
+        }
+        ///@brief Returns a uniform random number in [0, 1)
+        double uniform(uint64_t stream, uint64_t counter) const {
+            return (bits(stream, counter) >> 11) * (1.0 / 9007199254740992.0);
+        }
+        ///@brief Returns a uniform random number in [lower, upper)
+        double uniform(uint64_t stream, uint64_t counter, double lower, double upper) const {
+            return lower + (upper - lower) * uniform(stream, counter);
+        }
+        ///@brief Returns a standard normal random number (Box-Muller), uses the counters 2 * counter and 2 * counter + 1
+        double normal(uint64_t stream, uint64_t counter) const {
+            // 1 - u avoids log(0)
+            double u1 = 1.0 - uniform(stream, 2 * counter);
+            double u2 = uniform(stream, 2 * counter + 1);
+            return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+        }
+    private:
+        static uint64_t mix(uint64_t z) {
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+    };
+}
+
+#endif // Random_h__
@@ -0,0 +1,155 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Richness.h"
+#include "Stats.h"
+#include "Kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace BERN;
+
+namespace {
+    ///Species per block of the scan, small enough for the L1 cache
+    const size_t block_size = 256;
+}
+
+SpeciesTable::SpeciesTable(const std::vector<const Species *> &species)
+    : _dims(species.empty() ? SiteVector::dims() : species[0]->type().size()), _niches(4 * _dims * species.size())
+{
+    const size_t n = species.size();
+    const SiteType& type = species.empty() ? site_type : species[0]->type();
+    std::vector<double> width(_dims);
+    for (size_t s = 0; s < n; ++s) {
+        if (species[s]->type().size() != _dims)
+            throw SchemaError(species[s]->type().size(), _dims);
+        _ids.push_back(species[s]->id);
+        for (size_t d = 0; d < _dims; ++d) {
+            double* niche = &_niches[4 * d * n];
+            niche[s] = species[s]->pess.min[d];
+            niche[n + s] = species[s]->opt.min[d];
+            niche[2 * n + s] = species[s]->opt.max[d];
+            niche[3 * n + s] = species[s]->pess.max[d];
+            const double w = (niche[3 * n + s] - niche[s]) / (type[d].max - type[d].min);
+            if (std::isfinite(w))
+                width[d] += w;
+        }
+    }
+    // Scan the dimension with the narrowest niches first, it rejects the most species
+    for (size_t d = 0; d < _dims; ++d)
+        _order.push_back(d);
+    std::stable_sort(_order.begin(), _order.end(), [&](size_t a, size_t b) {return width[a] < width[b];});
+}
+
+void SpeciesTable::possibility(const SiteVector &site, double *out, double threshold) const {
+    const size_t n = size();
+    if (site.size() != _dims)
+        throw SchemaError(site.size(), _dims);
+    if (!_dims) {
+        std::fill(out, out + n, 1.0);
+        return;
+    }
+    size_t alive[block_size];
+    for (size_t lo = 0; lo < n; lo += block_size) {
+        const size_t hi = std::min(n, lo + block_size);
+        // The first dimension for the whole block, in a branch free loop
+        const size_t first = _order[0];
+        const double x = site[first];
+        const double* pMin = &_niches[4 * first * n];
+        const double* oMin = pMin + n;
+        const double* oMax = oMin + n;
+        const double* pMax = oMax + n;
+        // The comparisons may raise floating point exceptions, hence the compiler needs a hint to vectorize
+#pragma omp simd
+        for (size_t s = lo; s < hi; ++s) {
+            // kernels::trapez with selects instead of branches
+            const double left = (x - pMin[s]) / (oMin[s] - pMin[s]);
+            const double right = (pMax[s] - x) / (pMax[s] - oMax[s]);
+            const double v = x < oMin[s] ? left : (x > oMax[s] ? right : 1.0);
+            out[s] = (x < pMin[s]) | (x > pMax[s]) ? 0.0 : v;
+        }
+        // The further dimensions only for the species above the threshold, the minimum can only decrease
+        size_t count = 0;
+        for (size_t s = lo; s < hi; ++s)
+            if (out[s] > threshold)
+                alive[count++] = s;
+        for (size_t k = 1; k < _dims && count; ++k) {
+            const size_t d = _order[k];
+            const double* niche = &_niches[4 * d * n];
+            size_t remaining = 0;
+            for (size_t i = 0; i < count; ++i) {
+                const size_t s = alive[i];
+                out[s] = std::min(kernels::trapez(site[d], niche[s], niche[n + s], niche[2 * n + s], niche[3 * n + s]), out[s]);
+                if (out[s] > threshold)
+                    alive[remaining++] = s;
+            }
+            count = remaining;
+        }
+    }
+}
+
+RichnessResult BERN::species_richness(const std::vector<const Species *> &species, const std::vector<SiteVector> &sites,
+                                      double threshold, size_t top) {
+    BERN_PHASE(evaluate_ns);
+    const SpeciesTable table(species);
+    for (auto& site: sites)
+        if (site.size() != table.dims())
+            throw SchemaError(site.size(), table.dims());
+    const std::vector<int>& ids = table.ids();
+    RichnessResult res;
+    res.sites = sites.size();
+    res.top = top;
+    res.threshold = threshold;
+    res.count.resize(sites.size());
+    res.sum.resize(sites.size());
+    res.top_ids.assign(sites.size() * top, -1);
+    res.top_possibility.assign(sites.size() * top, 0.0);
+#pragma omp parallel
+    {
+        std::vector<double> poss(table.size());
+        std::vector<std::pair<double, int>> feasible;
+#pragma omp for
+        for (int i = 0; i < (int)sites.size(); ++i) {
+            table.possibility(sites[i], poss.data(), threshold);
+            feasible.clear();
+            int count = 0;
+            double sum = 0;
+            for (size_t s = 0; s < poss.size(); ++s) {
+                if (poss[s] > threshold) {
+                    ++count;
+                    sum += poss[s];
+                    if (top)
+                        feasible.emplace_back(poss[s], ids[s]);
+                }
+            }
+            res.count[i] = count;
+            res.sum[i] = sum;
+            const size_t n = std::min(feasible.size(), top);
+            // Highest possibility first, lower id first on ties
+            std::partial_sort(feasible.begin(), feasible.begin() + n, feasible.end(),
+                              [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+                                  return a.first > b.first || (a.first == b.first && a.second < b.second);
+                              });
+            for (size_t k = 0; k < n; ++k) {
+                res.top_ids[i * top + k] = feasible[k].second;
+                res.top_possibility[i * top + k] = feasible[k].first;
+            }
+        }
+    }
+    return res;
+}
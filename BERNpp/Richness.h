@@ -0,0 +1,78 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Richness_h__
+#define Richness_h__
+
+#include "SiteVector.h"
+#include "Species.h"
+#include <vector>
+
+namespace BERN {
+
+    ///@brief Potential species richness of many sites, see species_richness
+    struct RichnessResult {
+        size_t sites = 0;
+        ///@brief Number of top species per site
+        size_t top = 0;
+        double threshold = 0;
+        ///@brief Number of species with a possibility > threshold per site
+        std::vector<int> count;
+        ///@brief Sum of the possibilities > threshold per site
+        std::vector<double> sum;
+        ///@brief Ids of the species with the highest possibilities (sites, top), -1 if there are less feasible species
+        std::vector<int> top_ids;
+        ///@brief The possibilities of top_ids, 0 for missing species
+        std::vector<double> top_possibility;
+    };
+
+#ifndef SWIG
+    ///@brief The niches of many species as a dimension major table for scans over all species
+    ///
+    ///The trapezoid values of the dimension with the narrowest niches are calculated for a block of species
+    ///in a branch free loop, which the compiler vectorizes. The other dimensions are only evaluated for the
+    ///species of the block above the threshold. The values are identical to Species::possibility
+    class SpeciesTable {
+    public:
+        explicit SpeciesTable(const std::vector<const Species*>& species);
+        size_t size() const {return _ids.size();}
+        size_t dims() const {return _dims;}
+        const std::vector<int>& ids() const {return _ids;}
+        ///@brief Writes the possibilities of all species at site to out (size() values)
+        ///
+        ///Values <= threshold are only guaranteed to be <= threshold, the remaining dimensions of species
+        ///below the threshold are skipped
+        void possibility(const SiteVector& site, double* out, double threshold=-1) const;
+    private:
+        size_t _dims;
+        std::vector<int> _ids;
+        ///@brief pMin, oMin, oMax, pMax of each dimension, each with size() values
+        std::vector<double> _niches;
+        ///@brief The dimensions by increasing mean niche width
+        std::vector<size_t> _order;
+    };
+#endif
+
+    /// Counts the species with a possibility > threshold at each site, sums their possibilities and
+    /// lists the top species with the highest possibility (ties by lower id).
+    /// Uses a fused scan over the niche table (see SpeciesTable) and OpenMP parallelisation, if available
+    RichnessResult species_richness(const std::vector<const Species*>& species, const std::vector<SiteVector>& sites,
+                                    double threshold=0, size_t top=0);
+}
+
+#endif // Richness_h__
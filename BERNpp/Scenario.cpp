@@ -0,0 +1,127 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Scenario.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <stdexcept>
+
+using namespace BERN;
+
+namespace {
+    ///The best community and the present communities (column indices, ascending) of one site
+    struct SiteSummary {
+        int best = -1;
+        double max = 0;
+        std::vector<size_t> present;
+    };
+
+    void summarize(const std::vector<const Community*>& comms, const SiteVector& site, double threshold,
+                   const Aggregation& aggregation, SiteSummary& res) {
+        res.best = -1;
+        res.max = 0;
+        res.present.clear();
+        for (size_t c = 0; c < comms.size(); ++c) {
+            if (!comms[c]->size())
+                continue;
+            const double p = comms[c]->possibility(site, aggregation);
+            if (p > res.max) {
+                res.max = p;
+                res.best = comms[c]->id;
+            }
+            if (p >= threshold)
+                res.present.push_back(c);
+        }
+    }
+
+    ///Exact comparison, any change of the scenario needs an evaluation. Missing values (NaN) are equal
+    bool identical(const SiteVector& a, const SiteVector& b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](double x, double y) {
+            return x == y || (std::isnan(x) && std::isnan(y));
+        });
+    }
+
+    ///Flattens the id lists per site to compressed rows
+    void compress(const std::vector<std::vector<int>>& rows, std::vector<size_t>& offsets, std::vector<int>& ids) {
+        offsets.assign(1, 0);
+        for (const auto& row: rows) {
+            ids.insert(ids.end(), row.begin(), row.end());
+            offsets.push_back(ids.size());
+        }
+    }
+}
+
+ScenarioDiff BERN::scenario_diff(const std::vector<const Community *> &comms, const std::vector<SiteVector> &baseline,
+                                 const std::vector<SiteVector> &scenario, double threshold,
+                                 const Aggregation &aggregation) {
+    BERN_PHASE(evaluate_ns);
+    if (baseline.size() != scenario.size())
+        throw std::invalid_argument("scenario_diff: " + std::to_string(baseline.size()) + " baseline sites, but " +
+                                    std::to_string(scenario.size()) + " scenario sites");
+    check_schema(comms, baseline);
+    check_schema(comms, scenario);
+    const size_t ns = baseline.size();
+    ScenarioDiff res;
+    res.sites = ns;
+    res.communities = comms.size();
+    res.threshold = threshold;
+    res.baseline_best.resize(ns);
+    res.scenario_best.resize(ns);
+    res.changed.resize(ns);
+    res.baseline_max.resize(ns);
+    res.delta_max.resize(ns);
+    std::vector<std::vector<int>> lost(ns), gained(ns);
+    size_t evaluated = 0;
+#pragma omp parallel reduction(+:evaluated)
+    {
+        SiteSummary base, scen;
+        std::vector<size_t> diff;
+#pragma omp for schedule(dynamic, 64)
+        for (int s = 0; s < (int)ns; ++s) {
+            summarize(comms, baseline[s], threshold, aggregation, base);
+            res.baseline_best[s] = base.best;
+            res.baseline_max[s] = base.max;
+            // Unchanged cells need no second evaluation
+            if (identical(scenario[s], baseline[s])) {
+                res.scenario_best[s] = base.best;
+                res.changed[s] = 0;
+                res.delta_max[s] = 0;
+                continue;
+            }
+            ++evaluated;
+            summarize(comms, scenario[s], threshold, aggregation, scen);
+            res.scenario_best[s] = scen.best;
+            res.changed[s] = base.best != scen.best;
+            res.delta_max[s] = scen.max - base.max;
+            diff.clear();
+            std::set_difference(base.present.begin(), base.present.end(), scen.present.begin(), scen.present.end(),
+                                std::back_inserter(diff));
+            for (size_t c: diff)
+                lost[s].push_back(comms[c]->id);
+            diff.clear();
+            std::set_difference(scen.present.begin(), scen.present.end(), base.present.begin(), base.present.end(),
+                                std::back_inserter(diff));
+            for (size_t c: diff)
+                gained[s].push_back(comms[c]->id);
+        }
+    }
+    res.evaluated_scenarios = evaluated;
+    compress(lost, res.lost_offsets, res.lost_ids);
+    compress(gained, res.gained_offsets, res.gained_ids);
+    return res;
+}
@@ -0,0 +1,67 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Scenario_h__
+#define Scenario_h__
+
+#include "SiteVector.h"
+#include "Community.h"
+#include <vector>
+
+namespace BERN {
+
+    ///@brief The changes between a baseline and a scenario for paired sites, see scenario_diff
+    ///
+    ///The per site arrays have the size sites. The lost and gained communities are stored as compressed
+    ///rows: the ids of site i are ids[offsets[i]] .. ids[offsets[i + 1] - 1]
+    struct ScenarioDiff {
+        size_t sites = 0;
+        size_t communities = 0;
+        double threshold = 0.5;
+        ///@brief Id of the community with the highest possibility (> 0), -1 if none
+        std::vector<int> baseline_best, scenario_best;
+        ///@brief 1, if the best community differs between baseline and scenario
+        std::vector<int> changed;
+        ///@brief The highest possibility of the baseline site
+        std::vector<double> baseline_max;
+        ///@brief Highest possibility of the scenario minus the highest possibility of the baseline
+        std::vector<double> delta_max;
+        ///@brief Communities with a possibility >= threshold in the baseline, but not in the scenario
+        std::vector<size_t> lost_offsets;
+        std::vector<int> lost_ids;
+        ///@brief Communities with a possibility >= threshold in the scenario, but not in the baseline
+        std::vector<size_t> gained_offsets;
+        std::vector<int> gained_ids;
+        ///@brief Number of sites with a scenario different from the baseline (all others are evaluated once)
+        size_t evaluated_scenarios = 0;
+    };
+
+    /// Evaluates baseline and scenario sites pairwise in one parallel pass and returns only the changes.
+    /// No possibility matrix is stored. Communities without species are ignored.
+    /// Sites of another schema than the communities throw a SchemaError before the evaluation
+    /// \param comms The communities
+    /// \param baseline The baseline sites
+    /// \param scenario The scenario sites, same size as baseline
+    /// \param threshold A community is present at a site, if its possibility is >= threshold
+    /// \param aggregation The aggregation operator of the species possibilities
+    ScenarioDiff scenario_diff(const std::vector<const Community*>& comms, const std::vector<SiteVector>& baseline,
+                               const std::vector<SiteVector>& scenario, double threshold=0.5,
+                               const Aggregation& aggregation=Aggregation());
+}
+
+#endif // Scenario_h__
@@ -21,7 +21,6 @@
 
 #include "SiteVector.h"
 #include <string>
-#include <strstream>
 #include <map>
 namespace BERN {
 	///Class that represents named site conditions, e.g. different measured or modelled plots, or time series of a single plot
@@ -44,14 +43,10 @@ namespace BERN {
 		int ID() const { return m_ID; }
 
 		///Complete constructor
-		SiteState(int Id, const std::string& _Name, SiteVector& siteconditions) : m_ID(Id), m_Name(_Name), m_SiteVector(siteconditions) {}
+		SiteState(int Id, const std::string& _Name, const SiteVector& siteconditions) : m_SiteVector(siteconditions), m_Name(_Name), m_ID(Id) {}
 		///Constructor with automatic name generation
-		SiteState(int Id, SiteVector& siteconditions): m_ID(Id), m_SiteVector(siteconditions)
-		{
-			std::strstream strstr;
-			strstr << m_ID;
-			m_Name=strstr.str();
-		}
+		SiteState(int Id, const SiteVector& siteconditions): m_SiteVector(siteconditions), m_Name(std::to_string(Id)), m_ID(Id) {}
+		SiteState() : m_ID(-1) {}
 		///The STL-Map of this type
 		typedef std::map<int,SiteState*> Map;
 		///Adds this to a given SiteState::Map
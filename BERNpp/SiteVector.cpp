@@ -18,7 +18,9 @@
 
 #include <sstream>
 #include "SiteVector.h"
+#include "Kernels.h"
 #include <algorithm>
+#include <cmath>
 
 #define self (*this)
 
@@ -26,48 +28,49 @@ BERN::SiteType BERN::site_type;
 
 std::istream& BERN::operator >>( std::istream& istr, BERN::SiteVector& sv )
 {
-    for (int i = 0; i < BERN::SiteVector::dims() ; i++)
+    for (size_t i = 0; i < sv.size() ; i++)
         istr >> sv[i];
     return istr;
 }
 std::ostream& BERN::operator <<(std::ostream& ostr, const BERN::SiteVector& sv )
 {
-    for (int i = 0; i < BERN::SiteVector::dims() ; i++)
-        ostr << site_type[i].Name << ": " << sv[i] << "\t";
+    for (size_t i = 0; i < sv.size() ; i++)
+        ostr << sv.type()[i].Name << ": " << sv[i] << "\t";
     return ostr;
 }
 
 
 bool BERN::SiteVector::operator==(const BERN::SiteVector &sv) const {
-    for (int i = 0; i < dims() ; i++)
-        if (abs(self[i]-sv[i]) > site_type[i].error_tolerance()) return false;
+    if (size() != sv.size()) return false;
+    for (size_t i = 0; i < size() ; i++)
+        if (std::abs(self[i]-sv[i]) > type()[i].error_tolerance()) return false;
     return true;
 }
 
 BERN::SiteVector BERN::SiteVector::operator+(const BERN::SiteVector &sv) const {
-    SiteVector result;
-    for (int i = 0; i < dims() ; i++)
+    SiteVector result(type());
+    for (size_t i = 0; i < size() ; i++)
         result[i] = self[i] + sv[i];
     return result;
 }
 
 BERN::SiteVector BERN::SiteVector::operator-(const BERN::SiteVector &sv) const {
-    SiteVector result;
-    for (int i = 0; i < dims() ; i++)
+    SiteVector result(type());
+    for (size_t i = 0; i < size() ; i++)
         result[i] = self[i] - sv[i];
     return result;
 }
 
 BERN::SiteVector BERN::SiteVector::operator*(double scalar) const {
-    SiteVector result;
-    for (int i = 0; i < dims() ; i++)
+    SiteVector result(type());
+    for (size_t i = 0; i < size() ; i++)
         result[i] = self[i] * scalar;
     return result;
 }
 
 BERN::SiteVector BERN::SiteVector::operator/(double scalar) const {
-    SiteVector result;
-    for (int i = 0; i < dims() ; i++)
+    SiteVector result(type());
+    for (size_t i = 0; i < size() ; i++)
         result[i] = self[i] / scalar;
     return result;
 }
@@ -77,41 +80,55 @@ BERN::SiteVector BERN::SiteVector::center(const BERN::SiteVector &sv1, const BER
 }
 
 BERN::SiteVector::SiteVector()
-: std::vector<double>(SiteVector::dims(), NaN) {
+: std::vector<double>(SiteVector::dims(), NaN), _type(site_type.share()) {
+
+}
+
+BERN::SiteVector::SiteVector(const SiteType &type)
+: std::vector<double>(type.size(), NaN), _type(type.share()) {
 
 }
 
 BERN::SiteVector::SiteVector(const BERN::SiteVector &src) = default;
 BERN::SiteVector::SiteVector(const std::vector<double>& src)
-: std::vector<double>(SiteVector::dims(), NaN)
+: SiteVector(src, site_type)
 {
-    if (src.size() < this->dims()) {
+}
+
+BERN::SiteVector::SiteVector(const std::vector<double> &src, const SiteType &type)
+: std::vector<double>(type.size(), NaN), _type(type.share())
+{
+    if (src.size() < type.size()) {
         throw std::runtime_error("Too few values for a bern.SiteVector");
-    } else if (src.size() > this->dims()) {
+    } else if (src.size() > type.size()) {
         throw std::runtime_error("Too many values for a bern.SiteVector");
     }
     std::copy(src.begin(), src.end(), this->begin());
 }
 
-BERN::SiteVector BERN::SiteVector::calc_accuracy() {
-    SiteVector result;
+BERN::SiteVector BERN::SiteType::accuracy() const {
+    SiteVector result(self);
     std::transform(
-        site_type.begin(), site_type.end(),
+        begin(), end(),
         result.begin(),
         [](const SiteValue & var) -> double {return var.error_tolerance();}
     );
     return result;
 }
 
+BERN::SiteVector BERN::SiteVector::calc_accuracy() {
+    return site_type.accuracy();
+}
+
 BERN::SiteVector BERN::SiteVector::min(const BERN::SiteVector &sv1, const BERN::SiteVector &sv2)  {
     // Element wise min
-    BERN::SiteVector res;
+    BERN::SiteVector res(sv1.type());
     std::transform(sv1.begin(), sv1.end(), sv2.begin(), res.begin(), [](double v1, double v2) -> double {return std::min(v1, v2);});
     return res;
 }
 BERN::SiteVector BERN::SiteVector::max(const BERN::SiteVector &sv1, const BERN::SiteVector &sv2)  {
     // Element wise max
-    BERN::SiteVector res;
+    BERN::SiteVector res(sv1.type());
     std::transform(sv1.begin(), sv1.end(), sv2.begin(), res.begin(), [](double v1, double v2) -> double {return std::max(v1, v2);});
     return res;
 }
@@ -133,8 +150,8 @@ double BERN::calculate_wetness_index(double accessible_field_capacity, double gr
 }
 
 BERN::SiteRange BERN::operator&(const BERN::SiteRange &left, const BERN::SiteRange &right) {
-    BERN::SiteRange res;
-    const size_t dims = left.min.dims();
+    BERN::SiteRange res(left.min.type());
+    const size_t dims = left.min.size();
     for (size_t dim=0; dim < dims; ++dim) {
         res.min[dim] = std::max(left.min[dim], right.min[dim]);
         res.max[dim] = std::min(left.max[dim], right.max[dim]);
@@ -143,8 +160,8 @@ BERN::SiteRange BERN::operator&(const BERN::SiteRange &left, const BERN::SiteRan
 }
 
 BERN::SiteRange BERN::operator|(const BERN::SiteRange &left, const BERN::SiteRange &right) {
-    BERN::SiteRange res;
-    const size_t dims = left.min.dims();
+    BERN::SiteRange res(left.min.type());
+    const size_t dims = left.min.size();
     for (size_t dim=0; dim < dims; ++dim) {
         res.min[dim] = std::min(left.min[dim], right.min[dim]);
         res.max[dim] = std::max(left.max[dim], right.max[dim]);
@@ -152,6 +169,12 @@ BERN::SiteRange BERN::operator|(const BERN::SiteRange &left, const BERN::SiteRan
     return res;
 }
 
+std::shared_ptr<const BERN::SiteType> BERN::SiteType::share() const {
+    std::shared_ptr<const SiteType> owner = _self.lock();
+    // Without owner the aliasing constructor points at the schema without a reference count
+    return owner ? owner : std::shared_ptr<const SiteType>(std::shared_ptr<const SiteType>(), this);
+}
+
 size_t BERN::SiteType::find(const std::string &text_index) const {
     for (int i=0; i<this->size(); ++i) {
         if (text_index == self[i].Name) {
@@ -175,12 +198,12 @@ BERN::SiteVector BERN::SiteRange::center() const {
 }
 
 bool BERN::SiteRange::contains(const BERN::SiteVector & site) const {
-    for (int i=0; i<BERN::SiteVector::dims();++i) {
-        if ((site[i] >= self.min[i]) && (site[i] <= self.max[i])) {
-            return true;
-        }
-    }
-    return false;
+    const size_t n = self.min.size();
+    if (site.size() != n)
+        throw BERN::SchemaError(site.size(), n);
+    return BERN::kernels::dispatch(n, [&](auto N) {
+        return BERN::kernels::contains<decltype(N)::value>(n, site.data(), self.min.data(), self.max.data());
+    });
 }
 
 BERN::Possibility::operator bool() const {
@@ -197,3 +220,9 @@ std::string BERN::Possibility::str() const {
     s << "p = " << std::fixed << value << " @ " << site << "\n";
     return s.str();
 }
+
+std::string BERN::PossibilityGradient::str() const {
+    std::stringstream s;
+    s << "p = " << std::fixed << value << " grad = " << gradient << "\n";
+    return s.str();
+}
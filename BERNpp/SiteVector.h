@@ -25,6 +25,7 @@
 #include <map>
 #include <string>
 #include <iostream>
+#include <memory>
 
 namespace BERN {
     const double NaN = std::numeric_limits<double>::quiet_NaN();
@@ -41,12 +42,35 @@ namespace BERN {
 
     };
 
+    class SiteVector;
+
+    ///@brief The schema of the site dimensions (site_type.tsv)
+    ///
+    ///Each Database owns a schema, site vectors, species and communities are bound to the schema they are
+    ///created with. A schema created by load is shared by its vectors and lives as long as the last of them,
+    ///other schemas (like BERN::site_type) must outlive their vectors.
     class SiteType: public std::vector<BERN::SiteValue> {
+    private:
+        ///@brief The owner of a loaded schema, not copied with the dimensions
+        std::weak_ptr<const SiteType> _self;
     public:
+        SiteType() = default;
+        SiteType(const SiteType& src) : std::vector<BERN::SiteValue>(src) {}
+        SiteType& operator=(const SiteType& src) {
+            std::vector<BERN::SiteValue>::operator=(src);
+            return *this;
+        }
+        ///@brief A pointer sharing the ownership of a loaded schema, a pointer without ownership for other schemas
+        std::shared_ptr<const SiteType> share() const;
         size_t find(const std::string& text_index) const;
         std::string str() const;
+        ///@brief The accuracy of the optimum search for each dimension, see SiteValue::error_tolerance
+        SiteVector accuracy() const;
+        ///@brief Loads the dimensions from a tab separated file (columns Name, LongName, min, max)
+        static std::shared_ptr<SiteType> load(const std::string& filename);
     };
 
+    ///@brief The default schema, used for vectors and databases without an explicit schema, see load_variables
     extern SiteType site_type;
 
     ///A class holding a vector pointing at a position in the functional space of site properties.
@@ -58,10 +82,19 @@ namespace BERN {
     ///- Add a Get-Accessor @code double X() {return values[n]; } @endcode where n is DimensionCount-1 (Don't forget the DoxyGen comments)
     ///- Extend the Constructor by values
     class SiteVector : public std::vector<double> {
+    private:
+        std::shared_ptr<const SiteType> _type;
     public:
+        ///@brief A site of the default schema with NaN values
         SiteVector();
+        ///@brief A site of the schema with NaN values
+        explicit SiteVector(const SiteType& type);
         SiteVector(const SiteVector& src);
+        SiteVector& operator=(const SiteVector& src) = default;
+        ///@brief A site of the default schema, src needs a value for each dimension
         SiteVector(const std::vector<double>& src);
+        ///@brief A site of the schema, src needs a value for each dimension
+        SiteVector(const std::vector<double>& src, const SiteType& type);
 
 
         ///@brief Returns true if all elements have the same value (may be wrongfully false in case of heavier mathematical calculations, floating point dilemma)
@@ -77,6 +110,7 @@ namespace BERN {
 
         std::string str() const;
 
+        ///@brief Number of dimensions of the default schema, a site has size() dimensions
         static size_t dims() {
             return site_type.size();
         }
@@ -84,10 +118,12 @@ namespace BERN {
         static SiteVector center(const SiteVector& sv1, const SiteVector& sv2);
         static SiteVector min(const SiteVector& sv1, const SiteVector& sv2);
         static SiteVector max(const SiteVector& sv1, const SiteVector& sv2);
+        ///@brief The accuracy of the default schema, see SiteType::accuracy
         static SiteVector calc_accuracy();
 
-        static const SiteType& type() {
-            return site_type;
+        ///@brief The schema of the site
+        const SiteType& type() const {
+            return *_type;
         }
 
     };
@@ -96,11 +132,22 @@ namespace BERN {
     std::istream & operator >>(std::istream& istr,BERN::SiteVector& sv);
     std::ostream& operator <<(std::ostream& ostr, const BERN::SiteVector& sv);
 
+    ///@brief Thrown, if a site does not have the dimensions of the schema it is used with
+    class SchemaError: public std::invalid_argument {
+    public:
+        SchemaError(size_t site_dims, size_t schema_dims)
+            : std::invalid_argument("Site has " + std::to_string(site_dims) + " dimensions, the schema " + std::to_string(schema_dims)) {}
+    };
 
     struct SiteRange {
         BERN::SiteVector min;
         BERN::SiteVector max;
+        SiteRange() = default;
+        SiteRange(const BERN::SiteVector& min_, const BERN::SiteVector& max_) : min(min_), max(max_) {}
+        ///@brief A range of the schema with NaN bounds
+        explicit SiteRange(const SiteType& type) : min(type), max(type) {}
         BERN::SiteVector center() const;
+        ///@brief true, if the site is inside the range in every dimension (bounds included). NaN values of the site are ignored
         bool contains(const BERN::SiteVector&) const;
     };
     BERN::SiteRange operator&(const BERN::SiteRange& left, const BERN::SiteRange& right);
@@ -124,6 +171,24 @@ namespace BERN {
         std::string str() const;
     };
 
+    ///@brief A possibility value with its gradient with respect to each site dimension
+    ///
+    ///The possibility functions are piecewise linear in each dimension, hence the gradient is a subgradient
+    ///at the kinks of the trapezoids and 0 where the possibility is 0 or 1
+    struct PossibilityGradient {
+        double value = NaN;
+        SiteVector gradient;
+        std::string str() const;
+    };
+
+    ///@brief Lower and upper bound of a possibility for all sites in a SiteRange
+    struct PossibilityBounds {
+        double lower = 0;
+        double upper = 1;
+        PossibilityBounds() = default;
+        PossibilityBounds(double lower_, double upper_) : lower(lower_), upper(upper_) {}
+    };
+
     double calculate_wetness_index(double accessible_field_capacity, double groundwater_table);
 
 }
@@ -0,0 +1,210 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Slice.h"
+#include "Kernels.h"
+#include <map>
+#include <cmath>
+#include <stdexcept>
+
+using namespace BERN;
+
+namespace {
+    ///@brief The separated trapezoid values of species on a slice
+    ///
+    ///The possibility of species s at the point (i, j) is min(fixed[s], tx[s][i], ty[s][j])
+    class SliceTables {
+    public:
+        SliceTables(const SiteVector& base, const SliceAxis& x, const SliceAxis& y)
+            : _base(base), _x(x), _y(y), nx(x.steps), ny(std::max<size_t>(1, y.steps))
+        {
+            const size_t dims = base.size();
+            if (x.dim >= dims || (y.steps && y.dim >= dims) || (y.steps && x.dim == y.dim))
+                throw std::invalid_argument("Slice: invalid axis dimensions");
+        }
+
+        ///Adds a species and returns its index
+        size_t add(const Species* spec) {
+            auto it = _index.find(spec);
+            if (it != _index.end())
+                return it->second;
+            const size_t dims = _base.size();
+            if (spec->type().size() != dims)
+                throw SchemaError(dims, spec->type().size());
+            double fixed = 1;
+            for (size_t d = 0; d < dims; ++d) {
+                if (d != _x.dim && !(_y.steps && d == _y.dim))
+                    fixed = std::min(trapez(spec, d, _base[d]), fixed);
+            }
+            _fixed.push_back(fixed);
+            for (size_t i = 0; i < nx; ++i)
+                _tx.push_back(trapez(spec, _x.dim, _x.value(i)));
+            for (size_t j = 0; j < ny; ++j)
+                _ty.push_back(_y.steps ? trapez(spec, _y.dim, _y.value(j)) : 1.0);
+            _index[spec] = _fixed.size() - 1;
+            return _fixed.size() - 1;
+        }
+
+        double fixed(size_t s) const {return _fixed[s];}
+        double possibility(size_t s, size_t i, size_t j) const {
+            return std::min(std::min(_fixed[s], _tx[s * nx + i]), _ty[s * ny + j]);
+        }
+
+    private:
+        static double trapez(const Species* spec, size_t d, double value) {
+            return kernels::trapez(value, spec->pess.min[d], spec->opt.min[d], spec->opt.max[d], spec->pess.max[d]);
+        }
+        const SiteVector& _base;
+        const SliceAxis &_x, &_y;
+        std::map<const Species*, size_t> _index;
+        std::vector<double> _fixed, _tx, _ty;
+    public:
+        const size_t nx, ny;
+    };
+
+    ///The community possibilities on a slice from the species tables, like Community::evaluate
+    class CommunitySlicer {
+    public:
+        CommunitySlicer(const std::vector<const Community*>& comms, const SiteVector& base,
+                        const SliceAxis& x, const SliceAxis& y)
+            : tables(base, x, y), _members(comms.size())
+        {
+            for (size_t c = 0; c < comms.size(); ++c) {
+                if (!comms[c]->size())
+                    continue;
+                for (const Species* spec: comms[c]->evaluation_order())
+                    _members[c].push_back(tables.add(spec));
+            }
+        }
+
+        ///Writes the possibilities of community c for the row j into row (x.steps values)
+        template<typename Policy>
+        void row(size_t c, size_t j, Policy policy, double* res) const {
+            const std::vector<size_t>& members = _members[c];
+            if (members.empty()) {
+                std::fill_n(res, tables.nx, NaN);
+                return;
+            }
+            if (Policy::absorbing) {
+                //A species without possibility in the fixed dimensions excludes the community from the slice
+                bool excluded = false;
+                for (size_t s: members)
+                    excluded |= !(tables.fixed(s) > 0);
+                if (excluded) {
+                    std::fill_n(res, tables.nx, 0.0);
+                    return;
+                }
+            }
+            for (size_t i = 0; i < tables.nx; ++i) {
+                Policy p = policy;
+                bool zero = false;
+                for (size_t s: members) {
+                    const double poss = tables.possibility(s, i, j);
+                    if (Policy::absorbing && poss <= 0) {
+                        zero = true;
+                        break;
+                    }
+                    p.add(poss);
+                }
+                res[i] = zero ? 0.0 : p.result();
+            }
+        }
+
+        SliceTables tables;
+    private:
+        std::vector<std::vector<size_t>> _members;
+    };
+}
+
+void BERN::species_slice(const std::vector<const Species *> &species, const SiteVector &base, const SliceAxis &x,
+                         const SliceAxis &y, double *out) {
+    SliceTables tables(base, x, y);
+    for (size_t k = 0; k < species.size(); ++k) {
+        const size_t s = tables.add(species[k]);
+        double* res = out + k * tables.ny * tables.nx;
+        for (size_t j = 0; j < tables.ny; ++j)
+            for (size_t i = 0; i < tables.nx; ++i)
+                *res++ = tables.possibility(s, i, j);
+    }
+}
+
+std::vector<double> BERN::species_slice(const std::vector<const Species *> &species, const SiteVector &base,
+                                        const SliceAxis &x, const SliceAxis &y) {
+    std::vector<double> res(species.size() * std::max<size_t>(1, y.steps) * x.steps);
+    species_slice(species, base, x, y, res.data());
+    return res;
+}
+
+void BERN::community_slice(const std::vector<const Community *> &comms, const SiteVector &base, const SliceAxis &x,
+                           const SliceAxis &y, double *out, const Aggregation &aggregation) {
+    BERN_PHASE(evaluate_ns);
+    const CommunitySlicer slicer(comms, base, x, y);
+    const size_t nx = slicer.tables.nx, ny = slicer.tables.ny;
+    aggregation::dispatch(aggregation, [&](auto policy) {
+#pragma omp parallel for
+        for (int k = 0; k < (int)(comms.size() * ny); ++k) {
+            slicer.row(k / ny, k % ny, policy, out + k * nx);
+        }
+        return 0;
+    });
+}
+
+std::vector<double> BERN::community_slice(const std::vector<const Community *> &comms, const SiteVector &base,
+                                          const SliceAxis &x, const SliceAxis &y, const Aggregation &aggregation) {
+    std::vector<double> res(comms.size() * std::max<size_t>(1, y.steps) * x.steps);
+    community_slice(comms, base, x, y, res.data(), aggregation);
+    return res;
+}
+
+void BERN::best_community_slice(const std::vector<const Community *> &comms, const SiteVector &base, const SliceAxis &x,
+                                const SliceAxis &y, int *labels, double *values, const Aggregation &aggregation) {
+    BERN_PHASE(evaluate_ns);
+    const CommunitySlicer slicer(comms, base, x, y);
+    const size_t nx = slicer.tables.nx, ny = slicer.tables.ny;
+    aggregation::dispatch(aggregation, [&](auto policy) {
+#pragma omp parallel
+        {
+            std::vector<double> row(nx), max(nx);
+#pragma omp for
+            for (int j = 0; j < (int)ny; ++j) {
+                std::fill(max.begin(), max.end(), 0.0);
+                std::fill_n(labels + j * nx, nx, -1);
+                for (size_t c = 0; c < comms.size(); ++c) {
+                    if (!comms[c]->size())
+                        continue;
+                    slicer.row(c, j, policy, row.data());
+                    for (size_t i = 0; i < nx; ++i) {
+                        if (row[i] > max[i]) {
+                            max[i] = row[i];
+                            labels[j * nx + i] = comms[c]->id;
+                        }
+                    }
+                }
+                if (values)
+                    std::copy(max.begin(), max.end(), values + j * nx);
+            }
+        }
+        return 0;
+    });
+}
+
+std::vector<int> BERN::best_community_slice(const std::vector<const Community *> &comms, const SiteVector &base,
+                                            const SliceAxis &x, const SliceAxis &y, const Aggregation &aggregation) {
+    std::vector<int> res(std::max<size_t>(1, y.steps) * x.steps);
+    best_community_slice(comms, base, x, y, res.data(), nullptr, aggregation);
+    return res;
+}
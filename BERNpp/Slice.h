@@ -0,0 +1,78 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Slice_h__
+#define Slice_h__
+
+#include "SiteVector.h"
+#include "Species.h"
+#include "Community.h"
+#include <vector>
+
+namespace BERN {
+
+    ///@brief A regular axis of a slice through the site space
+    struct SliceAxis {
+        ///@brief The site dimension of the axis
+        size_t dim = 0;
+        double min = 0;
+        double max = 0;
+        ///@brief Number of points, including min and max. A y axis with 0 steps makes the slice a curve along x
+        size_t steps = 0;
+        SliceAxis() = default;
+        SliceAxis(size_t dim_, double min_, double max_, size_t steps_) : dim(dim_), min(min_), max(max_), steps(steps_) {}
+        ///@brief The site value of point i
+        double value(size_t i) const {
+            return steps > 1 ? min + (max - min) * double(i) / double(steps - 1) : min;
+        }
+    };
+
+    /// Renders the possibility of species on a slice into a buffer of the caller.
+    ///
+    /// The slice goes through base, the dimensions of x and y are replaced by the axis values. The trapezoid
+    /// values of the fixed dimensions are calculated once per species and the axis values once per axis point.
+    /// The buffer needs species.size() * max(1, y.steps) * x.steps values, ordered species, y, x (x is the fastest)
+    void species_slice(const std::vector<const Species*>& species, const SiteVector& base,
+                       const SliceAxis& x, const SliceAxis& y, double* out);
+    /// Like species_slice, returns the values
+    std::vector<double> species_slice(const std::vector<const Species*>& species, const SiteVector& base,
+                                      const SliceAxis& x, const SliceAxis& y=SliceAxis());
+
+    /// Renders the possibility of communities on a slice into a buffer of the caller, see species_slice.
+    /// The values are identical to Community::possibility, communities without species get NaN.
+    /// Uses OpenMP parallelisation, if available
+    void community_slice(const std::vector<const Community*>& comms, const SiteVector& base,
+                         const SliceAxis& x, const SliceAxis& y, double* out,
+                         const Aggregation& aggregation=Aggregation());
+    /// Like community_slice, returns the values
+    std::vector<double> community_slice(const std::vector<const Community*>& comms, const SiteVector& base,
+                                        const SliceAxis& x, const SliceAxis& y=SliceAxis(),
+                                        const Aggregation& aggregation=Aggregation());
+
+    /// Renders the id of the community with the highest possibility (> 0, else -1) on a slice into labels,
+    /// and the highest possibility into values if given. Both have max(1, y.steps) * x.steps entries
+    void best_community_slice(const std::vector<const Community*>& comms, const SiteVector& base,
+                              const SliceAxis& x, const SliceAxis& y, int* labels, double* values=nullptr,
+                              const Aggregation& aggregation=Aggregation());
+    /// Like best_community_slice, returns the labels
+    std::vector<int> best_community_slice(const std::vector<const Community*>& comms, const SiteVector& base,
+                                          const SliceAxis& x, const SliceAxis& y=SliceAxis(),
+                                          const Aggregation& aggregation=Aggregation());
+}
+
+#endif // Slice_h__
@@ -26,6 +26,8 @@
 namespace BERN {
 
     double trapez(double x,double pMin,double oMin,double oMax,double pMax);
+    ///@brief The derivative of trapez with respect to x, 0 outside the pessimum and at the optimum plateau
+    double trapez_slope(double x,double pMin,double oMin,double oMax,double pMax);
 	
 	///@brief A class to characterize the niche width of a species.
 	///
@@ -56,12 +58,28 @@ namespace BERN {
 		Species(int id,const std::string& name,const SiteVector& pessMin, const SiteVector& optMin, const SiteVector& optMax,const SiteVector& pessMax);
 
         Species();
+        ///@brief A species without niche in the site schema type
+        explicit Species(const SiteType& type);
+        ///@brief The site schema of the niche
+        const SiteType& type() const {return pess.min.type();}
 
 		///@brief Returns the possibility value at given site conditions
 		///
-		///According to Liebig's minimum law, the minimum of the possibilities for each single site parameter is returned
+		///According to Liebig's minimum law, the minimum of the possibilities for each single site parameter is returned.
+		///The site needs the dimensions of the niche (see type()), else a SchemaError is thrown
 		///@returns The minimum possibility for each site condition
 		double possibility(const SiteVector& SiteConditions) const;
+
+		///@brief Returns the possibility value and its gradient at given site conditions
+		///
+		///Only the dimension with the minimal possibility has a gradient. On ties the first dimension is used.
+		PossibilityGradient possibility_with_gradient(const SiteVector& SiteConditions) const;
+
+		///@brief Returns the possibility value and the limiting dimension and the slope of the possibility in this dimension
+		double possibility(const SiteVector& SiteConditions, size_t& limiting_dim, double& slope) const;
+
+		///@brief Returns bounds of the possibility for all sites in the box
+		PossibilityBounds possibility_bounds(const SiteRange& box) const;
 		
 
 	};
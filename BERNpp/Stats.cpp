@@ -0,0 +1,143 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Stats.h"
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <sstream>
+
+using namespace BERN;
+
+namespace {
+    //The counters of all threads. Counters of finished threads are kept to preserve their counts
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<StatsCounters>>& registry() {
+        static std::vector<std::unique_ptr<StatsCounters>> counters;
+        return counters;
+    }
+#ifdef BERN_STATS
+    //The innermost running phase timer of the thread
+    thread_local PhaseTimer* active_timer = nullptr;
+#endif
+}
+
+void *BERN::StatsCounters::operator new(size_t size) {
+    //The address of the allocation is stored in front of the aligned object
+    const size_t align = alignof(StatsCounters);
+    void* raw = ::operator new(size + align + sizeof(void*));
+    const uintptr_t first = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+    void* aligned = reinterpret_cast<void*>((first + align - 1) & ~uintptr_t(align - 1));
+    static_cast<void**>(aligned)[-1] = raw;
+    return aligned;
+}
+
+void BERN::StatsCounters::operator delete(void *p) {
+    if (p)
+        ::operator delete(static_cast<void**>(p)[-1]);
+}
+
+#ifdef BERN_STATS
+BERN::PhaseTimer::PhaseTimer(std::atomic<uint64_t> StatsCounters::* phase)
+: _phase(phase), _start(std::chrono::steady_clock::now()), _outer(active_timer) {
+    if (_outer)
+        _outer->stop(_start);
+    active_timer = this;
+}
+
+BERN::PhaseTimer::~PhaseTimer() {
+    const auto now = std::chrono::steady_clock::now();
+    stop(now);
+    active_timer = _outer;
+    if (_outer)
+        _outer->_start = now;
+}
+
+void BERN::PhaseTimer::stop(std::chrono::steady_clock::time_point now) const {
+    StatsCounters::add(StatsCounters::local().*_phase,
+                       uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - _start).count()));
+}
+#endif
+
+StatsCounters &BERN::StatsCounters::local() {
+    thread_local StatsCounters* counters = nullptr;
+    if (!counters) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry().emplace_back(new StatsCounters);
+        counters = registry().back().get();
+    }
+    return *counters;
+}
+
+Stats &BERN::Stats::operator+=(const Stats &other) {
+    species_evaluations += other.species_evaluations;
+    community_evaluations += other.community_evaluations;
+    envelope_rejects += other.envelope_rejects;
+    optimizer_iterations += other.optimizer_iterations;
+    step_reductions += other.step_reductions;
+    load_seconds += other.load_seconds;
+    optimize_seconds += other.optimize_seconds;
+    evaluate_seconds += other.evaluate_seconds;
+    return *this;
+}
+
+Stats BERN::Stats::collect() {
+    Stats res;
+#ifdef BERN_STATS
+    res.enabled = true;
+#endif
+    const auto relaxed = std::memory_order_relaxed;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& c: registry()) {
+        res.species_evaluations += c->species_evaluations.load(relaxed);
+        res.community_evaluations += c->community_evaluations.load(relaxed);
+        res.envelope_rejects += c->envelope_rejects.load(relaxed);
+        res.optimizer_iterations += c->optimizer_iterations.load(relaxed);
+        res.step_reductions += c->step_reductions.load(relaxed);
+        res.load_seconds += c->load_ns.load(relaxed) * 1e-9;
+        res.optimize_seconds += c->optimize_ns.load(relaxed) * 1e-9;
+        res.evaluate_seconds += c->evaluate_ns.load(relaxed) * 1e-9;
+    }
+    return res;
+}
+
+void BERN::Stats::reset() {
+    const auto relaxed = std::memory_order_relaxed;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& c: registry()) {
+        for (auto counter: {&StatsCounters::species_evaluations, &StatsCounters::community_evaluations,
+                            &StatsCounters::envelope_rejects, &StatsCounters::optimizer_iterations,
+                            &StatsCounters::step_reductions, &StatsCounters::load_ns,
+                            &StatsCounters::optimize_ns, &StatsCounters::evaluate_ns}) {
+            ((*c).*counter).store(0, relaxed);
+        }
+    }
+}
+
+std::string BERN::Stats::json() const {
+    std::stringstream s;
+    s << "{\"enabled\": " << (enabled ? "true" : "false")
+      << ", \"species_evaluations\": " << species_evaluations
+      << ", \"community_evaluations\": " << community_evaluations
+      << ", \"envelope_rejects\": " << envelope_rejects
+      << ", \"optimizer_iterations\": " << optimizer_iterations
+      << ", \"step_reductions\": " << step_reductions
+      << ", \"load_seconds\": " << load_seconds
+      << ", \"optimize_seconds\": " << optimize_seconds
+      << ", \"evaluate_seconds\": " << evaluate_seconds << "}";
+    return s.str();
+}
@@ -0,0 +1,125 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Stats_h__
+#define Stats_h__
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace BERN {
+    ///@brief Counters of the hot paths and timings of the phases of a run
+    ///
+    ///The counters are only collected, if the library is compiled with BERN_STATS defined
+    ///(cmake -DBERN_STATS=ON). Each thread counts in its own Stats object, Stats::collect()
+    ///sums the counters of all threads. The phase times are exclusive: a phase started inside another
+    ///phase of the same thread (e.g. a batch evaluation calculating an optimum) pauses the outer phase,
+    ///hence the time of a thread is counted once. The times of the threads are summed.
+    struct Stats {
+        ///@brief true, if the library is compiled with BERN_STATS
+        bool enabled = false;
+        ///@brief Calls of Species::possibility
+        uint64_t species_evaluations = 0;
+        ///@brief Calls of Community::possibility
+        uint64_t community_evaluations = 0;
+        ///@brief Calls of Community::possibility that returned 0 by the envelope test
+        uint64_t envelope_rejects = 0;
+        ///@brief Iterations of the optimizer (BERN::maximize)
+        uint64_t optimizer_iterations = 0;
+        ///@brief Reductions of the optimizer step width
+        uint64_t step_reductions = 0;
+        ///@brief Time spent to load the database files
+        double load_seconds = 0;
+        ///@brief Time spent to calculate optima
+        double optimize_seconds = 0;
+        ///@brief Time spent in batch evaluations (possibility_matrix etc.)
+        double evaluate_seconds = 0;
+
+        Stats& operator+=(const Stats& other);
+        std::string json() const;
+
+        ///@brief Sums the counters of all threads
+        static Stats collect();
+        ///@brief Sets the counters of all threads to 0. Should not be called during an evaluation
+        static void reset();
+    };
+
+    ///@brief Counts of a single run of the optimizer, see BERN::maximize
+    struct OptimizerStats {
+        size_t iterations = 0;
+        size_t step_reductions = 0;
+    };
+
+#ifndef SWIG
+    ///@brief The thread local counters of Stats, updated by the owning thread only
+    ///
+    ///Each thread owns a cache line, other threads do not invalidate it by their updates
+    struct alignas(64) StatsCounters {
+        std::atomic<uint64_t> species_evaluations{0};
+        std::atomic<uint64_t> community_evaluations{0};
+        std::atomic<uint64_t> envelope_rejects{0};
+        std::atomic<uint64_t> optimizer_iterations{0};
+        std::atomic<uint64_t> step_reductions{0};
+        std::atomic<uint64_t> load_ns{0};
+        std::atomic<uint64_t> optimize_ns{0};
+        std::atomic<uint64_t> evaluate_ns{0};
+        ///@brief Returns the counters of the calling thread
+        static StatsCounters& local();
+        ///@brief Increments a counter. Only the owning thread writes, hence no atomic read-modify-write is needed
+        static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+        ///@brief Allocates with the alignment of the type, which operator new does not guarantee before C++17
+        static void* operator new(size_t size);
+        static void operator delete(void* p);
+    };
+
+    ///@brief Adds the lifetime of the object to a phase timer of the calling thread
+    ///
+    ///The time of nested timers of the same thread is only added to the innermost phase
+    class PhaseTimer {
+    public:
+#ifdef BERN_STATS
+        explicit PhaseTimer(std::atomic<uint64_t> StatsCounters::* phase);
+        ~PhaseTimer();
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+    private:
+        ///Adds the time since _start to the phase
+        void stop(std::chrono::steady_clock::time_point now) const;
+        std::atomic<uint64_t> StatsCounters::* _phase;
+        std::chrono::steady_clock::time_point _start;
+        PhaseTimer* _outer;
+#else
+        explicit PhaseTimer(std::atomic<uint64_t> StatsCounters::*) {}
+#endif
+    };
+#endif
+}
+
+#ifdef BERN_STATS
+#define BERN_COUNT(counter) BERN::StatsCounters::add(BERN::StatsCounters::local().counter, 1)
+#define BERN_PHASE(phase) BERN::PhaseTimer bern_phase_timer_(&BERN::StatsCounters::phase)
+#else
+#define BERN_COUNT(counter) ((void)0)
+#define BERN_PHASE(phase) ((void)0)
+#endif
+
+#endif // Stats_h__
@@ -0,0 +1,207 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Trajectory.h"
+#include "Kernels.h"
+#include <map>
+#include <algorithm>
+#include <cmath>
+
+using namespace BERN;
+
+namespace {
+    ///@brief The state of a trajectory evaluation between the steps
+    template<typename Policy>
+    class TrajectoryEvaluator {
+    public:
+        TrajectoryEvaluator(const std::vector<const Community*>& comms, Policy policy)
+            : _comms(comms), _policy(policy), _members(comms.size()),
+              _dims(comms.empty() ? SiteVector::dims() : comms[0]->type().size())
+        {
+            std::map<const Species*, size_t> index;
+            for (size_t c = 0; c < comms.size(); ++c) {
+                if (!comms[c]->size())
+                    continue;
+                // The same order as Community::possibility for identical floating point results
+                for (const Species* spec: comms[c]->evaluation_order()) {
+                    auto it = index.find(spec);
+                    if (it == index.end()) {
+                        it = index.emplace(spec, _species.size()).first;
+                        _species.push_back(spec);
+                        _communities_of.emplace_back();
+                    }
+                    _communities_of[it->second].push_back(c);
+                    _members[c].push_back(it->second);
+                }
+            }
+            const size_t dims = _dims;
+            const size_t ns = _species.size();
+            _niches.resize(4 * dims * ns);
+            for (size_t d = 0; d < dims; ++d) {
+                for (size_t s = 0; s < ns; ++s) {
+                    const Species& spec = *_species[s];
+                    double* niche = &_niches[4 * (d * ns + s)];
+                    niche[0] = spec.pess.min[d];
+                    niche[1] = spec.opt.min[d];
+                    niche[2] = spec.opt.max[d];
+                    niche[3] = spec.pess.max[d];
+                }
+            }
+            _trapez.assign(dims * ns, 0.0);
+            _zeros.assign(ns, dims);
+            _possibility.assign(ns, 0.0);
+            _dirty.assign(comms.size(), false);
+        }
+
+        ///Evaluates the next site, previous are the results of the step before or nullptr for the first step
+        void step(const SiteVector& site, const double* previous, double* res, size_t& trapez_evaluations) {
+            const size_t dims = _dims;
+            std::vector<size_t> changed_dims;
+            for (size_t d = 0; d < dims; ++d) {
+                // A NaN (missing value) is never equal, its trapezoid value of 1 is recalculated
+                if (!previous || !(site[d] == _site[d]))
+                    changed_dims.push_back(d);
+            }
+            const bool first = !previous;
+            _site = site;
+            const size_t ns = _species.size();
+            // Update the trapezoid values of the changed dimensions and count the dimensions with 0
+            for (size_t d: changed_dims) {
+                double* values = &_trapez[d * ns];
+                const double* niche = &_niches[4 * d * ns];
+                for (size_t s = 0; s < ns; ++s, niche += 4) {
+                    const double value = kernels::trapez(site[d], niche[0], niche[1], niche[2], niche[3]);
+                    _zeros[s] += size_t(value == 0) - size_t(values[s] == 0);
+                    values[s] = value;
+                }
+            }
+            // The species possibility is the minimum, 0 without recalculation if any dimension is 0
+            for (size_t s = 0; s < ns; ++s) {
+                double minValue = 0;
+                if (!_zeros[s]) {
+                    minValue = 1;
+                    for (size_t d = 0; d < dims; ++d) {
+                        minValue = std::min(_trapez[d * ns + s], minValue);
+                    }
+                }
+                if (first || !(minValue == _possibility[s])) {
+                    for (size_t c: _communities_of[s])
+                        _dirty[c] = true;
+                }
+                _possibility[s] = minValue;
+            }
+            trapez_evaluations += changed_dims.size() * _species.size();
+
+            for (size_t c = 0; c < _comms.size(); ++c) {
+                if (_members[c].empty()) {
+                    res[c] = NaN;
+                    continue;
+                }
+                res[c] = first || _dirty[c] ? aggregate(c) : previous[c];
+                _dirty[c] = false;
+            }
+        }
+
+    private:
+        //Like Community::evaluate, with the cached species possibilities. The envelope test is not needed,
+        //outside of the envelope the trapezoid value of a species is 0
+        double aggregate(size_t c) const {
+            Policy policy = _policy;
+            for (size_t s: _members[c]) {
+                const double poss = _possibility[s];
+                if (Policy::absorbing && poss <= 0)
+                    return 0;
+                policy.add(poss);
+            }
+            return policy.result();
+        }
+
+        const std::vector<const Community*>& _comms;
+        Policy _policy;
+        std::vector<const Species*> _species;
+        ///@brief The indices in _species for each community
+        std::vector<std::vector<size_t>> _members;
+        size_t _dims;
+        SiteVector _site;
+        ///@brief The niche points (pess.min, opt.min, opt.max, pess.max) of the species, dimension major
+        std::vector<double> _niches;
+        ///@brief Trapezoid values, dimension major
+        std::vector<double> _trapez;
+        ///@brief Number of dimensions with a trapezoid value of 0 per species
+        std::vector<size_t> _zeros;
+        std::vector<double> _possibility;
+        ///@brief The indices in comms for each species
+        std::vector<std::vector<size_t>> _communities_of;
+        ///@brief Communities with a changed species possibility in the current step
+        std::vector<bool> _dirty;
+    };
+
+    //Throws a SchemaError, if a state does not fit to the communities
+    void check_states(const std::vector<const Community *> &comms, const std::vector<SiteState> &states) {
+        std::vector<SiteVector> sites;
+        for (auto& state: states)
+            sites.push_back(state.SiteConditions());
+        check_schema(comms, sites);
+    }
+}
+
+TrajectoryResult BERN::trajectory(const std::vector<const Community *> &comms, const std::vector<SiteState> &states,
+                                  const Aggregation &aggregation) {
+    BERN_PHASE(evaluate_ns);
+    check_states(comms, states);
+    TrajectoryResult res;
+    res.steps = states.size();
+    res.communities = comms.size();
+    res.possibilities.resize(res.steps * res.communities);
+    aggregation::dispatch(aggregation, [&](auto policy) {
+        TrajectoryEvaluator<decltype(policy)> evaluator(comms, policy);
+        for (size_t t = 0; t < states.size(); ++t) {
+            double* row = &res.possibilities[t * res.communities];
+            evaluator.step(states[t].SiteConditions(), t ? row - res.communities : nullptr, row, res.trapez_evaluations);
+        }
+        return 0;
+    });
+    for (size_t t = 0; t < states.size(); ++t) {
+        res.ids.push_back(states[t].ID());
+        const double* row = &res.possibilities[t * res.communities];
+        int best = -1;
+        double max = 0;
+        for (size_t c = 0; c < comms.size(); ++c) {
+            if (row[c] > max) {
+                max = row[c];
+                best = comms[c]->id;
+            }
+        }
+        res.best.push_back(best);
+        if (t && best != res.best[t - 1])
+            res.transitions.push_back(t);
+    }
+    return res;
+}
+
+std::vector<TrajectoryResult> BERN::trajectories(const std::vector<const Community *> &comms,
+                                                 const std::vector<std::vector<SiteState>> &plots,
+                                                 const Aggregation &aggregation) {
+    std::vector<TrajectoryResult> res(plots.size());
+    for (auto& states: plots)
+        check_states(comms, states);
+#pragma omp parallel for
+    for (int i = 0; i < (int)plots.size(); ++i) {
+        res[i] = trajectory(comms, plots[i], aggregation);
+    }
+    return res;
+}
@@ -0,0 +1,61 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Trajectory_h__
+#define Trajectory_h__
+
+#include "Site.h"
+#include "Community.h"
+#include <vector>
+
+namespace BERN {
+
+    ///@brief The community possibilities along a time series of site states
+    struct TrajectoryResult {
+        size_t steps = 0;
+        size_t communities = 0;
+        ///@brief The ID of the SiteState of each step
+        std::vector<int> ids;
+        ///@brief The possibilities, step major (like possibility_matrix), NaN for communities without species
+        std::vector<double> possibilities;
+        ///@brief The id of the community with the highest possibility (> 0) per step, -1 if none
+        std::vector<int> best;
+        ///@brief The steps where the best community differs from the step before
+        std::vector<size_t> transitions;
+        ///@brief Number of trapezoid function evaluations, compare with steps * species * dims
+        size_t trapez_evaluations = 0;
+    };
+
+    /// Calculates the possibilities of the communities for each state of a time series.
+    ///
+    /// The trapezoid values of each species and dimension are kept between the steps. Only the dimensions
+    /// that differ from the step before are recalculated, and only communities with a changed species
+    /// possibility are aggregated again. The results are identical to Community::possibility
+    /// \param comms The communities
+    /// \param states The site states in temporal order
+    /// \param aggregation The aggregation operator of the species possibilities
+    TrajectoryResult trajectory(const std::vector<const Community*>& comms, const std::vector<SiteState>& states,
+                                const Aggregation& aggregation=Aggregation());
+
+    /// Calculates the trajectories of many plots. Uses OpenMP parallelisation over the plots, if available
+    std::vector<TrajectoryResult> trajectories(const std::vector<const Community*>& comms,
+                                               const std::vector<std::vector<SiteState>>& plots,
+                                               const Aggregation& aggregation=Aggregation());
+}
+
+#endif // Trajectory_h__
@@ -0,0 +1,160 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+#include "Uncertainty.h"
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+using namespace BERN;
+
+BERN::SiteDistribution::SiteDistribution(const SiteVector &location_, const SiteVector &scale_, Distribution kind_)
+: location(location_), scale(scale_), kind(location_.size(), kind_)
+{
+    if (scale.size() != location.size())
+        throw SchemaError(scale.size(), location.size());
+}
+
+BERN::SiteDistribution::SiteDistribution()
+: kind(SiteVector::dims(), Distribution::fixed)
+{}
+
+void BERN::SiteDistribution::check(const SiteVector &result) const {
+    if (scale.size() != location.size())
+        throw SchemaError(scale.size(), location.size());
+    if (kind.size() != location.size())
+        throw SchemaError(kind.size(), location.size());
+    if (result.size() != location.size())
+        throw SchemaError(location.size(), result.size());
+}
+
+void BERN::SiteDistribution::sample(const CounterRNG &rng, uint64_t stream, uint64_t sample, SiteVector &result) const {
+    check(result);
+    const size_t dims = result.size();
+    // Maximum number of draws to get a normal value inside the range, clamped afterwards
+    const uint64_t max_tries = 64;
+    for (size_t d = 0; d < dims; ++d) {
+        // A missing value stays missing, it does not restrict the species (see kernels::trapez)
+        if (std::isnan(location[d])) {
+            result[d] = NaN;
+            continue;
+        }
+        const double lower = result.type()[d].min, upper = result.type()[d].max;
+        // The normal draws of the dimension use the uniform counters [2 * counter, 2 * (counter + max_tries))
+        const uint64_t counter = (sample * dims + d) * max_tries;
+        double x = location[d];
+        switch (kind[d]) {
+            case Distribution::fixed:
+                break;
+            case Distribution::uniform:
+                x = rng.uniform(stream, 2 * counter,
+                                std::max(lower, location[d] - scale[d]),
+                                std::min(upper, location[d] + scale[d]));
+                break;
+            case Distribution::normal:
+                for (uint64_t i=0; i < max_tries; ++i) {
+                    x = location[d] + scale[d] * rng.normal(stream, counter + i);
+                    if (x >= lower && x <= upper)
+                        break;
+                }
+                break;
+        }
+        result[d] = std::min(upper, std::max(lower, x));
+    }
+}
+
+namespace {
+    //Quantile with linear interpolation between the order statistics, values are partially reordered
+    double quantile(std::vector<double>& values, double level) {
+        if (values.empty())
+            return NaN;
+        double pos = level * (values.size() - 1);
+        size_t lower = std::min(size_t(pos), values.size() - 1);
+        std::nth_element(values.begin(), values.begin() + lower, values.end());
+        if (lower + 1 >= values.size())
+            return values[lower];
+        // After nth_element the next order statistic is the smallest value behind lower
+        const double next = *std::min_element(values.begin() + lower + 1, values.end());
+        double frac = pos - lower;
+        return values[lower] * (1 - frac) + next * frac;
+    }
+}
+
+MonteCarloResult BERN::monte_carlo(const std::vector<const Community *> &comms, const std::vector<SiteDistribution> &sites,
+                                   size_t samples, const std::vector<double> &levels, uint64_t seed) {
+    BERN_PHASE(evaluate_ns);
+    const size_t nc = comms.size(), ns = sites.size(), nl = levels.size();
+    MonteCarloResult res;
+    res.sites = ns;
+    res.communities = nc;
+    res.samples = samples;
+    res.levels = levels;
+    res.mean.assign(ns * nc, NaN);
+    res.quantiles.assign(ns * nc * nl, NaN);
+    res.best.assign(ns * nc, NaN);
+    if (!samples)
+        return res;
+    const CounterRNG rng(seed);
+    // The samples are drawn in the schema of the communities
+    const SiteType& type = nc ? comms[0]->type() : site_type;
+    std::vector<SiteVector> locations;
+    for (auto& site: sites) {
+        site.check(SiteVector(type));
+        locations.push_back(site.location);
+    }
+    check_schema(comms, locations);
+#pragma omp parallel
+    {
+        // Thread local buffers, the possibility of every sample for every community (communities * samples values)
+        std::vector<std::vector<double>> values(nc, std::vector<double>(samples));
+        std::vector<size_t> best_count(nc);
+        SiteVector site(type);
+#pragma omp for schedule(dynamic)
+        for (int s = 0; s < (int)ns; ++s) {
+            std::fill(best_count.begin(), best_count.end(), 0);
+            for (size_t i = 0; i < samples; ++i) {
+                sites[s].sample(rng, s, i, site);
+                double max = 0;
+                size_t best = nc;
+                for (size_t c = 0; c < nc; ++c) {
+                    double p = comms[c]->size() ? comms[c]->possibility(site) : NaN;
+                    values[c][i] = p;
+                    if (p > max) {
+                        max = p;
+                        best = c;
+                    }
+                }
+                if (best < nc)
+                    ++best_count[best];
+            }
+            for (size_t c = 0; c < nc; ++c) {
+                const size_t i = s * nc + c;
+                if (!comms[c]->size())
+                    continue;
+                std::vector<double>& v = values[c];
+                double sum = 0;
+                for (double p: v)
+                    sum += p;
+                res.mean[i] = sum / samples;
+                res.best[i] = double(best_count[c]) / samples;
+                for (size_t l = 0; l < nl; ++l)
+                    res.quantiles[i * nl + l] = quantile(v, levels[l]);
+            }
+        }
+    }
+    return res;
+}
@@ -0,0 +1,88 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef Uncertainty_h__
+#define Uncertainty_h__
+
+#include "SiteVector.h"
+#include "Community.h"
+#include "Random.h"
+#include <vector>
+
+namespace BERN {
+    ///@brief Type of the probability distribution of a site dimension
+    enum class Distribution {
+        ///The value is known exactly (location)
+        fixed,
+        ///Uniform distribution between location - scale and location + scale
+        uniform,
+        ///Normal distribution with mean = location and standard deviation = scale
+        normal
+    };
+
+    ///@brief The uncertain conditions of a site, given by a distribution per dimension
+    ///
+    ///All samples are truncated to the range (SiteValue::min, SiteValue::max) of the dimension in the schema of the result
+    struct SiteDistribution {
+        SiteVector location;
+        SiteVector scale;
+        std::vector<Distribution> kind;
+        ///@brief Throws a SchemaError, if location and scale have different dimensions
+        SiteDistribution(const SiteVector& location, const SiteVector& scale, Distribution kind=Distribution::normal);
+        SiteDistribution();
+        ///@brief Throws a SchemaError, if scale, kind or result do not have the dimensions of location
+        void check(const SiteVector& result) const;
+        ///@brief Draws the sample number `sample` for stream into result
+        ///
+        ///Each dimension of a sample uses its own range of counters, hence the dimensions are independent
+        void sample(const CounterRNG& rng, uint64_t stream, uint64_t sample, SiteVector& result) const;
+    };
+
+    ///@brief Summary statistics of a Monte Carlo run
+    ///
+    ///The arrays are ordered like possibility_matrix: site major, community minor.
+    ///The quantiles have an additional inner dimension for the quantile levels
+    struct MonteCarloResult {
+        size_t sites = 0;
+        size_t communities = 0;
+        size_t samples = 0;
+        std::vector<double> levels;
+        ///@brief Mean possibility, size sites * communities
+        std::vector<double> mean;
+        ///@brief Quantiles of the possibility, size sites * communities * levels
+        std::vector<double> quantiles;
+        ///@brief Fraction of samples where the community has the highest possibility (> 0), size sites * communities.
+        ///On ties the first community in the list counts as best
+        std::vector<double> best;
+    };
+
+    /// Propagates the uncertainty of site conditions to the community possibilities.
+    /// Uses OpenMP parallelisation over the sites, if available.
+    /// The results are reproducible for a seed, independent of the number of threads.
+    /// Each thread buffers comms.size() * samples possibilities, e.g. 120 MB for 1500 communities and 10000 samples.
+    /// Missing values (NaN) of a location are passed to the samples unchanged
+    /// \param comms Communities, communities without species get NaN values
+    /// \param sites The uncertain site conditions
+    /// \param samples Number of samples per site
+    /// \param levels Levels of the quantiles to calculate in [0..1]
+    /// \param seed Seed of the random number generator
+    MonteCarloResult monte_carlo(const std::vector<const Community*>& comms, const std::vector<SiteDistribution>& sites,
+                                 size_t samples, const std::vector<double>& levels={0.05, 0.5, 0.95}, uint64_t seed=0);
+}
+
+#endif // Uncertainty_h__
@@ -37,18 +37,37 @@
 #include "SiteVector.h"
 #include "Species.h"
 #include "Community.h"
- // #include "Site.h"
+#include "Bioindication.h"
+#include "Uncertainty.h"
+#include "Site.h"
+#include "Trajectory.h"
+#include "Scenario.h"
+#include "Grid.h"
+#include "Slice.h"
+#include "Overlap.h"
+#include "OptimumIndex.h"
+#include "Richness.h"
+#include "Indicators.h"
+#include "MappedMatrix.h"
 #include "DataAccess.h"
+#include "Calibration.h"
 
 %}
 namespace std {
     %template(IntVector) std::vector<int>;
+    %template(SizeVector) std::vector<size_t>;
+    %template(StringVector) std::vector<std::string>;
     %template(DoubleVector) std::vector<double>;
     %template(SiteValueVector) std::vector<BERN::SiteValue>;
     %template(SpeciesVector) std::vector<const BERN::Species*>;
     %template(CommunityVector) std::vector<const BERN::Community*>;
     %template(SiteVectorVector) std::vector<BERN::SiteVector>;
+    %template(IntVectorVector) std::vector<std::vector<int>>;
+    %template(SpeciesVectorVector) std::vector<std::vector<const BERN::Species*>>;
 };
+// The schema of a Database is loaded by its constructor, the vectors share it in C++
+%ignore BERN::SiteType::load;
+%ignore BERN::SiteType::share;
 // Add typemap(in) iterable to SiteVector
 %include "SiteVector.h"
 
@@ -108,6 +127,17 @@ namespace std {
     }
 };
 
+%extend BERN::PossibilityGradient {
+    std::string __repr__() const {
+        return $self->str();
+    }
+};
+
+// The niches are copies in Python, the niche of a database species is changed by Database.update_niche
+%naturalvar BERN::Species::pess;
+%naturalvar BERN::Species::opt;
+%immutable BERN::Species::pess;
+%immutable BERN::Species::opt;
 %include "Species.h"
 %extend BERN::Species {
     std::string __repr__() const {
@@ -115,7 +145,15 @@ namespace std {
     }
 }
 
+%include "Aggregation.h"
+%extend BERN::Aggregation {
+    std::string __repr__() const {
+        return "Aggregation(" + $self->str() + ")";
+    }
+};
+
 %rename (_possibility_matrix) BERN::possibility_matrix;
+%rename (_possibility_gradient_matrix) BERN::possibility_gradient_matrix;
 %include "Community.h"
 %extend BERN::Community {
     std::string __repr__() const {
@@ -123,6 +161,58 @@ namespace std {
     }
 }
 
+%include "Bioindication.h"
+%template(IndicationVector) std::vector<BERN::Indication>;
+%extend BERN::Indication {
+    std::string __repr__() const {
+        return $self->str();
+    }
+};
+
+%include "Random.h"
+%rename (_monte_carlo) BERN::monte_carlo;
+%include "Uncertainty.h"
+%template(SiteDistributionVector) std::vector<BERN::SiteDistribution>;
+
+%include "Stats.h"
+%extend BERN::Stats {
+    std::string __repr__() const {
+        return $self->json();
+    }
+};
+%include "Site.h"
+%template(SiteStateVector) std::vector<BERN::SiteState>;
+%template(SiteStateVectorVector) std::vector<std::vector<BERN::SiteState>>;
+%include "Trajectory.h"
+%template(TrajectoryResultVector) std::vector<BERN::TrajectoryResult>;
+%rename (_scenario_diff) BERN::scenario_diff;
+%include "Scenario.h"
+%rename (_adaptive_grid) BERN::adaptive_grid;
+%include "Grid.h"
+// The buffer versions are for C++, Python gets the results as vectors
+%ignore BERN::species_slice(const std::vector<const Species*>&, const SiteVector&, const SliceAxis&, const SliceAxis&, double*);
+%ignore BERN::community_slice(const std::vector<const Community*>&, const SiteVector&, const SliceAxis&, const SliceAxis&, double*, const Aggregation&);
+%ignore BERN::community_slice(const std::vector<const Community*>&, const SiteVector&, const SliceAxis&, const SliceAxis&, double*);
+%ignore BERN::best_community_slice(const std::vector<const Community*>&, const SiteVector&, const SliceAxis&, const SliceAxis&, int*, double*, const Aggregation&);
+%ignore BERN::best_community_slice(const std::vector<const Community*>&, const SiteVector&, const SliceAxis&, const SliceAxis&, int*, double*);
+%ignore BERN::best_community_slice(const std::vector<const Community*>&, const SiteVector&, const SliceAxis&, const SliceAxis&, int*);
+%include "Slice.h"
+%rename (_envelope_overlap) BERN::envelope_overlap;
+%include "Overlap.h"
+%include "OptimumIndex.h"
+%template(NeighborVector) std::vector<BERN::Neighbor>;
+%template(NeighborVectorVector) std::vector<std::vector<BERN::Neighbor>>;
+%extend BERN::Neighbor {
+    std::string __repr__() const {
+        return "Neighbor(" + std::to_string($self->id) + ", " + std::to_string($self->distance) + ")";
+    }
+};
+%rename (_species_richness) BERN::species_richness;
+%include "Richness.h"
+%include "Indicators.h"
+%include "MappedMatrix.h"
+
+%include "Names.h"
 %include "DataAccess.h"
 
 %extend BERN::Database {
@@ -130,12 +220,210 @@ namespace std {
         def communities(self):
             """Returns an iterator through all loaded communities"""
             return (self.community(c_id) for c_id in self.community_ids())
+
+        def site_vector(self, values):
+            """A SiteVector of the database schema, the vector shares the schema with the database"""
+            return SiteVector(DoubleVector(values), self.type())
+
+        def indicator_frame(self, sites, communities=False, threshold=0.0):
+            """The weighted means of the indicator values as dict of numpy arrays by indicator name.
+            Weighted by the possibility of the species, or of the communities if communities is True"""
+            import numpy as np
+            if communities:
+                res = self.community_indicator_means(sites)
+            else:
+                res = self.indicator_means(sites, threshold)
+            mean = np.array(res.mean).reshape(res.sites, res.columns)
+            return {name: mean[:, i] for i, name in enumerate(res.names)}
+    }
+};
+%include "Calibration.h"
+%template(ObservationVector) std::vector<BERN::Observation>;
+%template(CalibrationParameterVector) std::vector<BERN::CalibrationParameter>;
+%extend BERN::CalibrationParameter {
+    std::string __repr__() const {
+        return "CalibrationParameter(" + $self->str() + ")";
+    }
+};
+%extend BERN::CalibrationScore {
+    std::string __repr__() const {
+        return $self->str();
+    }
+};
+%extend BERN::CalibrationResult {
+    std::string __repr__() const {
+        return $self->str();
     }
 };
+
 %pythoncode {
-def possiblity_matrix(communities, sites):
+def _site_vectors(owners, sites):
+    """The sites as SiteVectorVector of the schema of the communities or species, rows of values are converted"""
+    schema = owners[0].type() if len(owners) else None
+    def site_vector(values):
+        if isinstance(values, SiteVector):
+            return values
+        return SiteVector(DoubleVector(values), schema) if schema is not None else SiteVector(DoubleVector(values))
+    return SiteVectorVector([site_vector(s) for s in sites])
+
+def monte_carlo(communities, sites, samples, levels=(0.05, 0.5, 0.95), seed=0):
+    """Propagates site uncertainty to community possibilities.
+
+    Returns mean, quantiles and probability of being best as numpy arrays of shape
+    (sites, communities), the quantiles with an extra last axis for the levels"""
+    import numpy as np
+    res = _monte_carlo(communities, sites, samples, DoubleVector(levels), seed)
+    shape = (res.sites, res.communities)
+    return (np.array(res.mean).reshape(shape),
+            np.array(res.quantiles).reshape(shape + (len(levels),)),
+            np.array(res.best).reshape(shape))
+
+def possibility_gradient_matrix(communities, sites):
+    """Returns the possibilities (sites, communities) and their gradients (sites, communities, dims) as numpy arrays"""
+    import numpy as np
+    res = _possibility_gradient_matrix(communities, _site_vectors(communities, sites))
+    values = np.array(res.values).reshape(len(sites), len(communities))
+    return values, np.array(res.gradients).reshape(values.shape + (-1,))
+
+def scenario_diff(communities, baseline, scenario, threshold=0.5):
+    """Compares paired baseline and scenario sites in one pass.
+
+    Returns a dict with numpy arrays per site (baseline_best, scenario_best, changed, baseline_max, delta_max)
+    and the lists of lost and gained community ids per site"""
+    import numpy as np
+    res = _scenario_diff(communities, _site_vectors(communities, baseline), _site_vectors(communities, scenario),
+                         threshold)
+    def rows(offsets, ids):
+        offsets, ids = np.array(offsets), np.array(ids, dtype=int)
+        return [ids[offsets[i]:offsets[i + 1]] for i in range(res.sites)]
+    return dict(baseline_best=np.array(res.baseline_best), scenario_best=np.array(res.scenario_best),
+                changed=np.array(res.changed, dtype=bool), baseline_max=np.array(res.baseline_max),
+                delta_max=np.array(res.delta_max),
+                lost=rows(res.lost_offsets, res.lost_ids), gained=rows(res.gained_offsets, res.gained_ids))
+
+def adaptive_grid(communities, cells, threshold=0.5, tolerance=0.05):
+    """Best community, highest possibility and present flag of each cell of a raster (rows, cols, dims) as numpy arrays"""
+    import numpy as np
+    cells = np.asarray(cells, dtype=float)
+    rows, cols = cells.shape[:2]
+    res = _adaptive_grid(communities, _site_vectors(communities, cells.reshape(rows * cols, -1)),
+                         rows, cols, threshold, tolerance)
+    shape = (rows, cols)
+    return (np.array(res.best).reshape(shape), np.array(res.value).reshape(shape),
+            np.array(res.present, dtype=bool).reshape(shape))
+
+def envelope_overlap(communities, joint=False):
+    """Pairs of communities with intersecting envelopes as numpy arrays (rows, cols, volume, joint).
+    Rows and columns are indices into communities, e.g. for scipy.sparse.coo_matrix((volume, (rows, cols)))"""
+    import numpy as np
+    res = _envelope_overlap(communities, joint)
+    return (np.array(res.rows, dtype=int), np.array(res.cols, dtype=int),
+            np.array(res.volume), np.array(res.joint))
+
+def species_richness(species, sites, threshold=0.0, top=0):
+    """Potential species richness of sites as numpy arrays: count and possibility sum per site,
+    ids and possibilities of the top species (sites, top), ids are -1 for missing species"""
+    import numpy as np
+    res = _species_richness(species, _site_vectors(species, sites), threshold, top)
+    shape = (res.sites, res.top)
+    return (np.array(res.count, dtype=int), np.array(res.sum),
+            np.array(res.top_ids, dtype=int).reshape(shape), np.array(res.top_possibility).reshape(shape))
+
+def possibility_matrix_file(communities, sites, filename, dtype='float32', chunk=65536):
+    """Writes the possibilities (sites, communities) chunk by chunk into a memory mapped .npy file
+    and returns the file opened by numpy.load(filename, mmap_mode='r').
+    dtype is one of float64, float32, float16 or uint8 (value * 254, 255 for NaN)"""
+    import numpy as np
+    out = MappedMatrix(filename, len(sites), len(communities), globals()['MatrixType_' + dtype])
+    for start in range(0, len(sites), chunk):
+        _possibility_matrix(communities, _site_vectors(communities, sites[start:start + chunk]), out, start)
+    out.close()
+    return np.load(filename, mmap_mode='r')
+
+class ServerClient:
+    """Client of a bern-serve process on a Unix domain socket, see apps/bern_serve.cpp for the protocol.
+
+    Sites are arrays (n, dims), the results are numpy arrays. The community ids of the possibility
+    columns are in community_ids"""
+    _magic = 0x4E524542
+
+    def __init__(self, path='/tmp/bern.sock'):
+        import socket
+        import numpy as np
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.connect(path)
+        self.dims = 0
+        rows, cols, payload = self._call(0, np.zeros((0, 0)))
+        info = np.frombuffer(payload, dtype=np.int32)
+        self.dims, self.species_count = int(info[0]), int(info[2])
+        self.community_ids = info[3:].copy()
+
+    def close(self):
+        self._socket.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def _receive(self, size):
+        buffer = bytearray(size)
+        view, received = memoryview(buffer), 0
+        while received < size:
+            n = self._socket.recv_into(view[received:])
+            if not n:
+                raise ConnectionError('bern-serve closed the connection')
+            received += n
+        return bytes(buffer)
+
+    def _call(self, query, sites, k=0, threshold=0.0, communities=None):
+        import struct
+        import numpy as np
+        sites = np.ascontiguousarray(sites, dtype=np.float64)
+        if query:
+            sites = sites.reshape(-1, self.dims)
+        ids = np.ascontiguousarray([] if communities is None else communities, dtype=np.int32)
+        header = struct.pack('=IHHIIIId', self._magic, 1, query, sites.shape[0], sites.shape[1] if sites.ndim == 2 else 0,
+                             k, len(ids), threshold)
+        self._socket.sendall(header + ids.tobytes() + sites.tobytes())
+        magic, status, rows, cols, size = struct.unpack('=IiIIQ', self._receive(24))
+        payload = self._receive(size)
+        if status < 0:
+            raise RuntimeError(payload.decode())
+        return rows, cols, payload
+
+    def possibility(self, sites, communities=None):
+        """The possibilities (sites, communities) of the given or all communities (community_ids)"""
+        import numpy as np
+        rows, cols, payload = self._call(1, sites, communities=communities)
+        return np.frombuffer(payload, dtype=np.float64).reshape(rows, cols)
+
+    def best(self, sites, k=1, communities=None):
+        """Ids (-1 for none) and possibilities (sites, k) of the k communities with the highest possibility"""
+        import numpy as np
+        rows, cols, payload = self._call(2, sites, k, communities=communities)
+        n = rows * cols
+        return (np.frombuffer(payload, dtype=np.int32, count=n).reshape(rows, cols),
+                np.frombuffer(payload, dtype=np.float64, offset=4 * n).reshape(rows, cols))
+
+    def species(self, sites, k=1, threshold=0.0):
+        """Number of species above the threshold per site, ids (-1 for none) and possibilities (sites, k) of the top k species"""
+        import numpy as np
+        rows, cols, payload = self._call(3, sites, k, threshold)
+        n = rows * cols
+        return (np.frombuffer(payload, dtype=np.int32, count=rows),
+                np.frombuffer(payload, dtype=np.int32, count=n, offset=4 * rows).reshape(rows, cols),
+                np.frombuffer(payload, dtype=np.float64, offset=4 * (rows + n)).reshape(rows, cols))
+
+def possiblity_matrix(communities, sites, aggregation=None):
+    """Returns the possibilities as numpy array (sites, communities), with the standard or the given Aggregation"""
     import numpy as np
-    dv = _possibility_matrix(communities, sites)
+    sites = _site_vectors(communities, sites)
+    if aggregation is None:
+        dv = _possibility_matrix(communities, sites)
+    else:
+        dv = _possibility_matrix(communities, sites, aggregation)
     return np.array(dv).reshape(len(sites), len(communities))
 
 __version__ = '0.1.5'
@@ -0,0 +1,310 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#include "bern_c.h"
+#include "DataAccess.h"
+#include "Slice.h"
+#include "Richness.h"
+#include <algorithm>
+#include <shared_mutex>
+#include <mutex>
+#include <omp.h>
+
+using namespace BERN;
+
+struct bern_database {
+    explicit bern_database(const char* site_type_file) : db(site_type_file) {}
+    Database db;
+    std::vector<const Community*> communities;
+    std::vector<const Species*> species;
+    // Queries share the database, calculating optima needs exclusive access
+    mutable std::shared_timed_mutex lock;
+};
+
+namespace {
+    thread_local std::string last_error;
+
+    //Runs a function and translates exceptions to the error code -1
+    template<typename Function>
+    int guarded(Function f) {
+        try {
+            return f();
+        } catch (const std::exception& e) {
+            last_error = e.what();
+            return -1;
+        }
+    }
+
+    void check_handle(const bern_database* db) {
+        if (!db)
+            throw std::invalid_argument("bern_database handle is NULL");
+    }
+
+    std::vector<const Community*> find_communities(const bern_database* db, const int* ids, int n) {
+        if (!ids)
+            return db->communities;
+        std::vector<const Community*> res(n);
+        for (int i = 0; i < n; ++i) {
+            res[i] = db->db.find_community(ids[i]);
+            if (!res[i])
+                throw std::out_of_range("Community " + std::to_string(ids[i]) + " does not exist");
+        }
+        return res;
+    }
+
+    //The axes of a slice, checked against the dimensions of the database
+    std::pair<SliceAxis, SliceAxis> slice_axes(const bern_database* db, int dim_x, double x_min, double x_max, int nx,
+                                               int dim_y, double y_min, double y_max, int ny) {
+        const int dims = int(db->db.type().size());
+        if (dim_x < 0 || dim_x >= dims || nx < 0 || ny < 0 || (ny && (dim_y < 0 || dim_y >= dims)))
+            throw std::invalid_argument("Invalid slice axes");
+        return {SliceAxis(dim_x, x_min, x_max, nx), SliceAxis(ny ? dim_y : 0, y_min, y_max, ny)};
+    }
+
+    //Copies a row of the caller's site array into a site vector of the database schema
+    void load_site(const double* sites, int s, SiteVector& site) {
+        const size_t dims = site.size();
+        std::copy(sites + s * dims, sites + (s + 1) * dims, site.begin());
+    }
+}
+
+int bern_api_version(void) {
+    return BERN_C_API_VERSION;
+}
+
+const char* bern_last_error(void) {
+    return last_error.c_str();
+}
+
+bern_database* bern_open(const char* site_type_file, const char* species_file,
+                         const char* communities_file, const char* links_file) {
+    try {
+        std::unique_ptr<bern_database> handle(new bern_database(site_type_file));
+        if (!handle->db.load_species(species_file))
+            throw std::runtime_error(std::string("No species loaded from ") + species_file);
+        if (!handle->db.load_communities(communities_file))
+            throw std::runtime_error(std::string("No communities loaded from ") + communities_file);
+        handle->db.link_communities(links_file);
+        for (int id: handle->db.community_ids())
+            handle->communities.push_back(handle->db.find_community(id));
+        for (int id: handle->db.species_ids())
+            handle->species.push_back(handle->db.find_species(id));
+        return handle.release();
+    } catch (const std::exception& e) {
+        last_error = e.what();
+        return nullptr;
+    }
+}
+
+void bern_close(bern_database* db) {
+    delete db;
+}
+
+int bern_dims(const bern_database* db) {
+    return guarded([&]{
+        check_handle(db);
+        return int(db->db.type().size());
+    });
+}
+
+int bern_species_count(const bern_database* db) {
+    return guarded([&]{
+        check_handle(db);
+        return int(db->species.size());
+    });
+}
+
+int bern_community_count(const bern_database* db) {
+    return guarded([&]{
+        check_handle(db);
+        return int(db->communities.size());
+    });
+}
+
+int bern_species_ids(const bern_database* db, int* ids, int n) {
+    return guarded([&]{
+        check_handle(db);
+        int count = std::min(n, int(db->species.size()));
+        for (int i = 0; i < count; ++i)
+            ids[i] = db->species[i]->id;
+        return count;
+    });
+}
+
+int bern_community_ids(const bern_database* db, int* ids, int n) {
+    return guarded([&]{
+        check_handle(db);
+        int count = std::min(n, int(db->communities.size()));
+        for (int i = 0; i < count; ++i)
+            ids[i] = db->communities[i]->id;
+        return count;
+    });
+}
+
+int bern_calculate_optima(bern_database* db) {
+    return guarded([&]{
+        check_handle(db);
+        std::unique_lock<std::shared_timed_mutex> write(db->lock);
+        db->db.calculate_optima();
+        return 0;
+    });
+}
+
+int bern_community_optimum(bern_database* db, int comm_id, double* site, double* value) {
+    return guarded([&]{
+        check_handle(db);
+        const Community* comm = find_communities(db, &comm_id, 1)[0];
+        // The optimum is calculated on demand, which changes the community
+        std::unique_lock<std::shared_timed_mutex> write(db->lock);
+        Possibility opt = comm->optimum();
+        std::copy(opt.site.begin(), opt.site.end(), site);
+        *value = opt.value;
+        return 0;
+    });
+}
+
+int bern_community_possibility(const bern_database* db, const int* comm_ids, int n_comms,
+                               const double* sites, int n_sites, double* result) {
+    return guarded([&]{
+        check_handle(db);
+        std::shared_lock<std::shared_timed_mutex> read(db->lock);
+        const std::vector<const Community*> comms = find_communities(db, comm_ids, n_comms);
+        const size_t nc = comms.size();
+#pragma omp parallel
+        {
+            SiteVector site(db->db.type());
+#pragma omp for
+            for (int s = 0; s < n_sites; ++s) {
+                load_site(sites, s, site);
+                for (size_t c = 0; c < nc; ++c) {
+                    result[s * nc + c] = comms[c]->size() ? comms[c]->possibility(site) : NaN;
+                }
+            }
+        }
+        return 0;
+    });
+}
+
+int bern_species_possibility(const bern_database* db, const int* spec_ids, int n_species,
+                             const double* sites, int n_sites, double* result) {
+    return guarded([&]{
+        check_handle(db);
+        std::vector<const Species*> species(n_species);
+        for (int i = 0; i < n_species; ++i) {
+            species[i] = db->db.find_species(spec_ids[i]);
+            if (!species[i])
+                throw std::out_of_range("Species " + std::to_string(spec_ids[i]) + " does not exist");
+        }
+#pragma omp parallel
+        {
+            SiteVector site(db->db.type());
+#pragma omp for
+            for (int s = 0; s < n_sites; ++s) {
+                load_site(sites, s, site);
+                for (int i = 0; i < n_species; ++i) {
+                    result[s * n_species + i] = species[i]->possibility(site);
+                }
+            }
+        }
+        return 0;
+    });
+}
+
+int bern_best_community(const bern_database* db, const int* comm_ids, int n_comms,
+                        const double* sites, int n_sites, int* best_ids, double* best_possibility) {
+    return guarded([&]{
+        check_handle(db);
+        std::shared_lock<std::shared_timed_mutex> read(db->lock);
+        const std::vector<const Community*> comms = find_communities(db, comm_ids, n_comms);
+#pragma omp parallel
+        {
+            SiteVector site(db->db.type());
+#pragma omp for
+            for (int s = 0; s < n_sites; ++s) {
+                load_site(sites, s, site);
+                double max = 0;
+                int best = 0;
+                for (auto comm: comms) {
+                    if (!comm->size())
+                        continue;
+                    double p = comm->possibility(site);
+                    if (p > max) {
+                        max = p;
+                        best = comm->id;
+                    }
+                }
+                best_ids[s] = best;
+                if (best_possibility)
+                    best_possibility[s] = max;
+            }
+        }
+        return 0;
+    });
+}
+
+int bern_feasible_species(const bern_database* db, const double* sites, int n_sites, double threshold,
+                          int max_species, int* ids, double* possibility, int* count) {
+    return guarded([&]{
+        check_handle(db);
+        std::vector<SiteVector> site_list(n_sites, db->db.site());
+        for (int s = 0; s < n_sites; ++s)
+            load_site(sites, s, site_list[s]);
+        const RichnessResult res = species_richness(db->species, site_list, threshold, size_t(std::max(max_species, 0)));
+        for (size_t i = 0; i < res.top_ids.size(); ++i) {
+            ids[i] = std::max(res.top_ids[i], 0);
+            possibility[i] = res.top_possibility[i];
+        }
+        if (count)
+            std::copy(res.count.begin(), res.count.end(), count);
+        return 0;
+    });
+}
+
+int bern_community_slice(const bern_database* db, const int* comm_ids, int n_comms, const double* base,
+                         int dim_x, double x_min, double x_max, int nx,
+                         int dim_y, double y_min, double y_max, int ny, double* result) {
+    return guarded([&]{
+        check_handle(db);
+        std::shared_lock<std::shared_timed_mutex> read(db->lock);
+        const std::vector<const Community*> comms = find_communities(db, comm_ids, n_comms);
+        auto axes = slice_axes(db, dim_x, x_min, x_max, nx, dim_y, y_min, y_max, ny);
+        SiteVector site(db->db.type());
+        load_site(base, 0, site);
+        community_slice(comms, site, axes.first, axes.second, result);
+        return 0;
+    });
+}
+
+int bern_best_community_slice(const bern_database* db, const int* comm_ids, int n_comms, const double* base,
+                              int dim_x, double x_min, double x_max, int nx,
+                              int dim_y, double y_min, double y_max, int ny,
+                              int* best_ids, double* best_possibility) {
+    return guarded([&]{
+        check_handle(db);
+        std::shared_lock<std::shared_timed_mutex> read(db->lock);
+        const std::vector<const Community*> comms = find_communities(db, comm_ids, n_comms);
+        auto axes = slice_axes(db, dim_x, x_min, x_max, nx, dim_y, y_min, y_max, ny);
+        SiteVector site(db->db.type());
+        load_site(base, 0, site);
+        best_community_slice(comms, site, axes.first, axes.second, best_ids, best_possibility);
+        // No community is 0 in the C interface, see bern_best_community
+        const size_t n = size_t(std::max(1, ny)) * nx;
+        std::replace(best_ids, best_ids + n, -1, 0);
+        return 0;
+    });
+}
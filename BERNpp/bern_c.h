@@ -0,0 +1,121 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+#ifndef bern_c_h__
+#define bern_c_h__
+
+/* C interface of the BERN model for foreign function interfaces (R, Julia, ...)
+ *
+ * All batch functions take the site conditions as a row major array of n_sites * bern_dims() doubles
+ * and write into buffers provided by the caller. The results of a function for many communities
+ * or species at many sites are ordered site major: result[site * n_comms + comm].
+ *
+ * A database handle can be used by many threads at the same time. Functions returning int
+ * return a negative value on failure, the error message is available from bern_last_error.
+ */
+
+#define BERN_C_API_VERSION 1
+
+#if defined(_WIN32)
+#  if defined(BERN_C_EXPORTS)
+#    define BERN_C_API __declspec(dllexport)
+#  else
+#    define BERN_C_API __declspec(dllimport)
+#  endif
+#else
+#  define BERN_C_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Opaque handle of a loaded database */
+typedef struct bern_database bern_database;
+
+/* Returns BERN_C_API_VERSION of the library, to check against the header version */
+BERN_C_API int bern_api_version(void);
+
+/* Returns the last error message of the calling thread */
+BERN_C_API const char* bern_last_error(void);
+
+/* Loads a database from the tab separated files of BERNdata, returns NULL on failure.
+   Each database has its own site schema, databases with different dimensions can be open at the same time */
+BERN_C_API bern_database* bern_open(const char* site_type_file, const char* species_file,
+                                    const char* communities_file, const char* links_file);
+
+/* Frees the database, no other thread may use the handle anymore */
+BERN_C_API void bern_close(bern_database* db);
+
+/* Number of site dimensions */
+BERN_C_API int bern_dims(const bern_database* db);
+
+/* Number of species and communities */
+BERN_C_API int bern_species_count(const bern_database* db);
+BERN_C_API int bern_community_count(const bern_database* db);
+
+/* Writes up to n ids into ids, returns the number of ids written */
+BERN_C_API int bern_species_ids(const bern_database* db, int* ids, int n);
+BERN_C_API int bern_community_ids(const bern_database* db, int* ids, int n);
+
+/* Calculates the optima of all communities in parallel */
+BERN_C_API int bern_calculate_optima(bern_database* db);
+
+/* Writes the optimal site (bern_dims() values) and the possibility at the optimum of a community */
+BERN_C_API int bern_community_optimum(bern_database* db, int comm_id, double* site, double* value);
+
+/* Possibility of n_comms communities at n_sites sites, result has n_sites * n_comms values.
+ * Communities without species result in NaN */
+BERN_C_API int bern_community_possibility(const bern_database* db, const int* comm_ids, int n_comms,
+                                          const double* sites, int n_sites, double* result);
+
+/* Possibility of n_species species at n_sites sites, result has n_sites * n_species values */
+BERN_C_API int bern_species_possibility(const bern_database* db, const int* spec_ids, int n_species,
+                                        const double* sites, int n_sites, double* result);
+
+/* The community with the highest possibility for each site. If comm_ids is NULL, all communities are used.
+ * best_ids gets 0, if no community has a possibility > 0 */
+BERN_C_API int bern_best_community(const bern_database* db, const int* comm_ids, int n_comms,
+                                   const double* sites, int n_sites, int* best_ids, double* best_possibility);
+
+/* The species with a possibility > threshold for each site, sorted by decreasing possibility.
+ * ids and possibility have n_sites * max_species entries, unused entries are set to 0.
+ * count gets the number of feasible species per site, which may exceed max_species */
+BERN_C_API int bern_feasible_species(const bern_database* db, const double* sites, int n_sites, double threshold,
+                                     int max_species, int* ids, double* possibility, int* count);
+
+/* Possibility of n_comms communities on a regular slice through the site base (bern_dims() values).
+ * Dimension dim_x runs from x_min to x_max in nx points, dim_y from y_min to y_max in ny points.
+ * With ny = 0 the slice is a curve along x. result has n_comms * max(1, ny) * nx values, ordered
+ * community, y, x. If comm_ids is NULL, all communities are used */
+BERN_C_API int bern_community_slice(const bern_database* db, const int* comm_ids, int n_comms, const double* base,
+                                    int dim_x, double x_min, double x_max, int nx,
+                                    int dim_y, double y_min, double y_max, int ny, double* result);
+
+/* The community with the highest possibility on a slice, see bern_community_slice. best_ids and
+ * best_possibility (may be NULL) have max(1, ny) * nx values, best_ids gets 0 where no community is possible */
+BERN_C_API int bern_best_community_slice(const bern_database* db, const int* comm_ids, int n_comms, const double* base,
+                                         int dim_x, double x_min, double x_max, int nx,
+                                         int dim_y, double y_min, double y_max, int ny,
+                                         int* best_ids, double* best_possibility);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* bern_c_h__ */
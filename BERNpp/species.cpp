@@ -18,30 +18,79 @@
 
 
 #include "Species.h"
+#include "Stats.h"
+#include "Kernels.h"
 
 double BERN::trapez(double x, double pMin, double oMin, double oMax, double pMax) {
     //Trapezoid function
+    return kernels::trapez(x, pMin, oMin, oMax, pMax);
+}
+
+double BERN::Species::possibility(const BERN::SiteVector &SiteConditions) const {
+    BERN_COUNT(species_evaluations);
+    //Get the minimum of the possibility for each parameter, the kernel has a fixed dimension count
+    const size_t n = pess.min.size();
+    if (SiteConditions.size() != n)
+        throw SchemaError(SiteConditions.size(), n);
+    return kernels::dispatch(n, [&](auto N) {
+        return kernels::species_possibility<decltype(N)::value>(
+                n, SiteConditions.data(), pess.min.data(), opt.min.data(), opt.max.data(), pess.max.data());
+    });
+}
+
+double BERN::trapez_slope(double x, double pMin, double oMin, double oMax, double pMax) {
     if (x < pMin || x > pMax) { // Outside pessimum
         return 0;
     } else if (x < oMin) {  // Left flank
-        return (x - pMin) / (oMin - pMin);
+        return 1 / (oMin - pMin);
     } else if (x > oMax) { // Right flank
-        return (pMax - x) / (pMax - oMax);
+        return -1 / (pMax - oMax);
     } else { //Optimum plateau
-        return 1;
+        return 0;
     }
 }
 
-double BERN::Species::possibility(const BERN::SiteVector &SiteConditions) const {
-    double minValue=1;
-    for (int i = 0; i < SiteVector::dims(); i++)
+double BERN::Species::possibility(const BERN::SiteVector &SiteConditions, size_t &limiting_dim, double &slope) const {
+    BERN_COUNT(species_evaluations);
+    const size_t n = pess.min.size();
+    if (SiteConditions.size() != n)
+        throw SchemaError(SiteConditions.size(), n);
+    double minValue = kernels::dispatch(n, [&](auto N) {
+        return kernels::species_possibility<decltype(N)::value>(
+                n, SiteConditions.data(), pess.min.data(), opt.min.data(), opt.max.data(), pess.max.data(),
+                limiting_dim);
+    });
+    const size_t i = limiting_dim;
+    // No gradient outside of the niche, where the possibility is flat
+    slope = minValue > 0 ? trapez_slope(SiteConditions[i], pess.min[i], opt.min[i], opt.max[i], pess.max[i]) : 0.0;
+    return minValue;
+}
+
+BERN::PossibilityGradient BERN::Species::possibility_with_gradient(const BERN::SiteVector &SiteConditions) const {
+    PossibilityGradient res;
+    res.gradient = SiteVector(std::vector<double>(pess.min.size(), 0.0), type());
+    size_t dim;
+    double slope;
+    res.value = possibility(SiteConditions, dim, slope);
+    res.gradient[dim] = slope;
+    return res;
+}
+
+BERN::PossibilityBounds BERN::Species::possibility_bounds(const BERN::SiteRange &box) const {
+    //The minimum is monotone in each dimension, so the bounds are the minima of the bounds
+    PossibilityBounds res(1, 1);
+    if (box.min.size() != pess.min.size())
+        throw SchemaError(box.min.size(), pess.min.size());
+    if (box.max.size() != pess.min.size())
+        throw SchemaError(box.max.size(), pess.min.size());
+    for (size_t i = 0; i < pess.min.size(); i++)
     {
-        //Calculate the possibility for each parameter
-        double poss=trapez(SiteConditions[i], pess.min[i], opt.min[i], opt.max[i], pess.max[i]);
-        //Get the minimum
-        minValue = std::min(poss, minValue);
+        double lower, upper;
+        kernels::trapez_bounds(box.min[i], box.max[i], pess.min[i], opt.min[i], opt.max[i], pess.max[i], lower, upper);
+        res.lower = std::min(lower, res.lower);
+        res.upper = std::min(upper, res.upper);
     }
-    return minValue;
+    return res;
 }
 
 BERN::Species::Species(int id_, const std::string &name_, const BERN::SiteVector &pessMin,
@@ -56,3 +105,9 @@ BERN::Species::Species()
 {
 
 }
+
+BERN::Species::Species(const BERN::SiteType &type)
+    : id(-1), name(), pess(type), opt(type)
+{
+
+}
@@ -0,0 +1,422 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// bern-eval: Streaming batch evaluation of site tables
+//
+// Reads site vectors in chunks from a tab separated table (columns named after site_type.tsv) or a
+// binary file (float64 rows in site_type order), evaluates each chunk in parallel and writes the results
+// as a tab separated table. A reader thread fills at most two chunks ahead, if the output blocks the
+// reader stops as well, hence the memory use is bounded by the chunk size.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <memory>
+
+#include "../BERNpp/DataAccess.h"
+
+namespace {
+
+    const char* usage =
+            "Usage: bern-eval [options] [input]\n"
+            "\n"
+            "Evaluates the sites of the input (default: stdin) and writes a tab separated table to stdout\n"
+            "\n"
+            "Options:\n"
+            "  --data DIR           Directory with the BERN database files (default: BERNdata)\n"
+            "  --format tsv|bin     Input format. tsv: header with site_type names, other columns are ignored\n"
+            "                       bin: float64 rows with all dimensions in site_type order (default: tsv)\n"
+            "  --query QUERY        possibility: possibility of the communities (default)\n"
+            "                       best: the k communities with the highest possibility (> 0)\n"
+            "                       species: the k species with the highest possibility above the threshold\n"
+            "  --communities IDS    Comma separated community ids (default: all)\n"
+            "  -k N                 Number of results for best and species (default: 1)\n"
+            "  --threshold X        Minimum possibility for species (default: 0)\n"
+            "  --chunk N            Number of sites per chunk (default: 65536)\n"
+            "  --output FILE        Output file (default: stdout)\n";
+
+    enum class Query {possibility, best, species};
+
+    struct Options {
+        std::string data = "BERNdata";
+        std::string input = "-";
+        std::string output = "-";
+        bool binary = false;
+        Query query = Query::possibility;
+        std::vector<int> communities;
+        size_t k = 1;
+        double threshold = 0;
+        size_t chunk = 65536;
+    };
+
+    Options parse_options(int argc, char* argv[]) {
+        Options opt;
+        auto value = [&](int& i) -> std::string {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(std::string(argv[i]) + " needs a value");
+            return argv[++i];
+        };
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--data") {
+                opt.data = value(i);
+            } else if (arg == "--format") {
+                std::string format = value(i);
+                if (format != "tsv" && format != "bin")
+                    throw std::invalid_argument("Unknown format " + format);
+                opt.binary = format == "bin";
+            } else if (arg == "--query") {
+                std::string query = value(i);
+                if (query == "possibility") opt.query = Query::possibility;
+                else if (query == "best") opt.query = Query::best;
+                else if (query == "species") opt.query = Query::species;
+                else throw std::invalid_argument("Unknown query " + query);
+            } else if (arg == "--communities") {
+                std::stringstream ids(value(i));
+                std::string id;
+                while (std::getline(ids, id, ','))
+                    opt.communities.push_back(std::stoi(id));
+            } else if (arg == "-k") {
+                opt.k = std::stoul(value(i));
+            } else if (arg == "--threshold") {
+                opt.threshold = std::stod(value(i));
+            } else if (arg == "--chunk") {
+                opt.chunk = std::max<size_t>(1, std::stoul(value(i)));
+            } else if (arg == "--output") {
+                opt.output = value(i);
+            } else if (arg == "-h" || arg == "--help") {
+                std::cout << usage;
+                std::exit(0);
+            } else if (arg.size() > 1 && arg[0] == '-') {
+                throw std::invalid_argument("Unknown option " + arg);
+            } else {
+                opt.input = arg;
+            }
+        }
+        return opt;
+    }
+
+    ///A chunk of sites, row major with dims values per site
+    struct Chunk {
+        size_t first_row = 0;
+        size_t dims = 1;
+        std::vector<double> sites;
+        size_t size() const {return sites.size() / dims;}
+    };
+
+    ///A queue with a maximum size, push blocks if the queue is full
+    template<typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(size_t capacity) : _capacity(capacity) {}
+        ///Returns false, if the queue is closed
+        bool push(T item) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _not_full.wait(lock, [this]{return _items.size() < _capacity || _closed;});
+            if (_closed)
+                return false;
+            _items.push_back(std::move(item));
+            _not_empty.notify_one();
+            return true;
+        }
+        ///Returns false, if the queue is closed and empty
+        bool pop(T& item) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _not_empty.wait(lock, [this]{return !_items.empty() || _closed;});
+            if (_items.empty())
+                return false;
+            item = std::move(_items.front());
+            _items.pop_front();
+            _not_full.notify_one();
+            return true;
+        }
+        void close() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+            _not_empty.notify_all();
+            _not_full.notify_all();
+        }
+    private:
+        size_t _capacity;
+        bool _closed = false;
+        std::deque<T> _items;
+        std::mutex _mutex;
+        std::condition_variable _not_full, _not_empty;
+    };
+
+    ///Reads chunks of sites of the schema type from a tab separated table
+    class TableReader {
+    public:
+        TableReader(std::istream& in, const BERN::SiteType& type) : _in(in), _type(type) {
+            std::string header;
+            while (std::getline(_in, header)) {
+                ++_line;
+                if (!header.empty())
+                    break;
+            }
+            if (!header.empty() && header[0] == '#')
+                header.erase(0, 1);
+            std::vector<std::string> names = split(header);
+            const size_t dims = _type.size();
+            _column_of_dim.assign(dims, -1);
+            for (size_t col = 0; col < names.size(); ++col) {
+                for (size_t d = 0; d < dims; ++d) {
+                    if (names[col] == _type[d].Name)
+                        _column_of_dim[d] = int(col);
+                }
+            }
+            for (size_t d = 0; d < dims; ++d) {
+                if (_column_of_dim[d] < 0)
+                    throw std::runtime_error("Input has no column " + _type[d].Name);
+            }
+        }
+        bool read(Chunk& chunk, size_t max_sites) {
+            const size_t dims = _type.size();
+            chunk.dims = dims;
+            chunk.sites.clear();
+            std::string line;
+            while (chunk.size() < max_sites && std::getline(_in, line)) {
+                ++_line;
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                if (line.empty() || line[0] == '#')
+                    continue;
+                std::vector<std::string> fields = split(line);
+                for (size_t d = 0; d < dims; ++d) {
+                    const size_t col = _column_of_dim[d];
+                    chunk.sites.push_back(col < fields.size() ? parse(fields[col], _type[d].Name) : BERN::NaN);
+                }
+            }
+            return !chunk.sites.empty();
+        }
+    private:
+        ///A site value, NaN for an empty cell. Throws with the line and the column for anything but a number
+        double parse(const std::string& field, const std::string& column) const {
+            if (field.empty())
+                return BERN::NaN;
+            char* end = nullptr;
+            const double value = std::strtod(field.c_str(), &end);
+            while (end != field.c_str() && std::isspace((unsigned char)*end))
+                ++end;
+            if (end == field.c_str() || *end)
+                throw std::runtime_error("Line " + std::to_string(_line) + ", column " + column + ": '" + field +
+                                         "' is not a number");
+            return value;
+        }
+        static std::vector<std::string> split(const std::string& line) {
+            std::vector<std::string> fields;
+            std::stringstream columns(line);
+            std::string field;
+            while (std::getline(columns, field, '\t'))
+                fields.push_back(field);
+            return fields;
+        }
+        std::istream& _in;
+        const BERN::SiteType& _type;
+        std::vector<int> _column_of_dim;
+        ///The number of the last line read, starting at 1 with the header
+        size_t _line = 0;
+    };
+
+    ///Reads chunks of sites from raw float64 rows with dims values
+    bool read_binary(std::istream& in, size_t dims, Chunk& chunk, size_t max_sites) {
+        chunk.dims = dims;
+        chunk.sites.resize(max_sites * dims);
+        in.read(reinterpret_cast<char*>(chunk.sites.data()), std::streamsize(chunk.sites.size() * sizeof(double)));
+        const size_t rows = size_t(in.gcount()) / (dims * sizeof(double));
+        chunk.sites.resize(rows * dims);
+        return rows > 0;
+    }
+
+    ///Evaluates the queries on a chunk and formats the output lines
+    class Evaluator {
+    public:
+        Evaluator(const BERN::Database& db, const Options& opt) : _opt(opt), _type(db.type()) {
+            const std::vector<int> ids = opt.communities.empty() ? db.community_ids() : opt.communities;
+            for (int id: ids) {
+                const BERN::Community* comm = db.find_community(id);
+                if (!comm)
+                    throw std::out_of_range("Community " + std::to_string(id) + " does not exist");
+                if (comm->size())
+                    _communities.push_back(comm);
+            }
+            for (int id: db.species_ids())
+                _species.push_back(db.find_species(id));
+        }
+
+        std::string header() const {
+            std::string res = "row";
+            if (_opt.query == Query::possibility) {
+                for (auto comm: _communities)
+                    res += "\t" + std::to_string(comm->id);
+            } else {
+                if (_opt.query == Query::species)
+                    res += "\tcount";
+                for (size_t i = 1; i <= _opt.k; ++i)
+                    res += "\tid" + std::to_string(i) + "\tp" + std::to_string(i);
+            }
+            return res + "\n";
+        }
+
+        void evaluate(const Chunk& chunk, std::vector<std::string>& lines) const {
+            const size_t n = chunk.size(), dims = chunk.dims;
+            if (dims != _type.size())
+                throw BERN::SchemaError(dims, _type.size());
+            lines.resize(n);
+#pragma omp parallel
+            {
+                BERN::SiteVector site(_type);
+                std::vector<std::pair<double, int>> ranking;
+#pragma omp for schedule(dynamic, 64)
+                for (int s = 0; s < (int)n; ++s) {
+                    std::copy(chunk.sites.begin() + s * dims, chunk.sites.begin() + (s + 1) * dims, site.begin());
+                    std::string& line = lines[s];
+                    line = std::to_string(chunk.first_row + s);
+                    if (_opt.query == Query::possibility) {
+                        for (auto comm: _communities)
+                            append(line, comm->possibility(site));
+                    } else {
+                        ranking.clear();
+                        if (_opt.query == Query::best) {
+                            for (auto comm: _communities) {
+                                double p = comm->possibility(site);
+                                if (p > 0)
+                                    ranking.emplace_back(p, comm->id);
+                            }
+                        } else {
+                            for (auto spec: _species) {
+                                double p = spec->possibility(site);
+                                if (p > _opt.threshold)
+                                    ranking.emplace_back(p, spec->id);
+                            }
+                            line += "\t" + std::to_string(ranking.size());
+                        }
+                        const size_t k = std::min(_opt.k, ranking.size());
+                        std::partial_sort(ranking.begin(), ranking.begin() + k, ranking.end(),
+                                          [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+                                              return a.first > b.first || (a.first == b.first && a.second < b.second);
+                                          });
+                        for (size_t i = 0; i < _opt.k; ++i) {
+                            if (i < k) {
+                                line += "\t" + std::to_string(ranking[i].second);
+                                append(line, ranking[i].first);
+                            } else {
+                                line += "\t\t";
+                            }
+                        }
+                    }
+                    line += '\n';
+                }
+            }
+        }
+    private:
+        static void append(std::string& line, double value) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "\t%.6g", value);
+            line += buffer;
+        }
+        const Options& _opt;
+        const BERN::SiteType& _type;
+        std::vector<const BERN::Community*> _communities;
+        std::vector<const BERN::Species*> _species;
+    };
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options opt = parse_options(argc, argv);
+        std::ios::sync_with_stdio(false);
+
+        BERN::Database db(opt.data + "/site_type.tsv");
+        db.load_species(opt.data + "/plant-species.tsv");
+        db.load_communities(opt.data + "/communities.tsv");
+        db.link_communities(opt.data + "/link_plantspecies_to_community.tsv");
+        const Evaluator evaluator(db, opt);
+
+        std::ifstream input_file;
+        if (opt.input != "-") {
+            input_file.open(opt.input, opt.binary ? std::ios::binary : std::ios::in);
+            if (!input_file)
+                throw std::runtime_error(opt.input + " does not exist");
+        }
+        std::istream& input = opt.input == "-" ? std::cin : input_file;
+        std::ofstream output_file;
+        if (opt.output != "-") {
+            output_file.open(opt.output);
+            if (!output_file)
+                throw std::runtime_error("Can not write to " + opt.output);
+        }
+        std::ostream& output = opt.output == "-" ? std::cout : output_file;
+
+        std::unique_ptr<TableReader> table;
+        if (!opt.binary)
+            table.reset(new TableReader(input, db.type()));
+
+        // The reader runs at most two chunks ahead of the evaluation
+        BoundedQueue<Chunk> queue(2);
+        std::string read_error;
+        std::thread reader([&]{
+            try {
+                size_t row = 0;
+                Chunk chunk;
+                while (opt.binary ? read_binary(input, db.type().size(), chunk, opt.chunk)
+                                  : table->read(chunk, opt.chunk)) {
+                    chunk.first_row = row;
+                    row += chunk.size();
+                    if (!queue.push(std::move(chunk)))
+                        break;
+                    chunk = Chunk();
+                }
+            } catch (const std::exception& e) {
+                read_error = e.what();
+            }
+            queue.close();
+        });
+
+        output << evaluator.header();
+        Chunk chunk;
+        std::vector<std::string> lines;
+        while (queue.pop(chunk)) {
+            evaluator.evaluate(chunk, lines);
+            for (const auto& line: lines)
+                output << line;
+            if (!output)
+                break;
+        }
+        output.flush();
+        // Stops the reader, if the output failed before the input was consumed
+        queue.close();
+        reader.join();
+        if (!read_error.empty())
+            throw std::runtime_error(read_error);
+        return output ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "bern-eval: " << e.what() << "\n";
+        return 1;
+    }
+}
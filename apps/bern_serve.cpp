@@ -0,0 +1,525 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// bern-serve: Evaluation daemon on a Unix domain socket
+//
+// Loads the database once and answers batches of sites from many client processes. Requests of all
+// connections are collected in one queue, the engine thread takes all waiting requests (after a short
+// coalescing window) and evaluates their sites together in one parallel loop, hence many small requests
+// use all cores like one large batch.
+//
+// Protocol (native byte order, one request and one response at a time per connection):
+//   Request:  uint32 magic "BERN", uint16 version (1), uint16 query, uint32 n_sites, uint32 dims,
+//             uint32 k, uint32 n_ids, float64 threshold,
+//             int32 ids[n_ids] (community ids, none for all), float64 sites[n_sites * dims]
+//   Response: uint32 magic "BERN", int32 status (0 or -1 for errors), uint32 rows, uint32 cols,
+//             uint64 payload size, payload (the error message, if status is -1)
+//   Queries and their payload:
+//   0 info:        rows=1, cols=n_comms, int32 dims, int32 n_comms, int32 n_species, int32 community ids[n_comms]
+//   1 possibility: rows=n_sites, cols=n_comms, float64 possibility[rows * cols]
+//   2 best:        rows=n_sites, cols=k, int32 ids[rows * k] (-1 for none), float64 possibility[rows * k]
+//   3 species:     rows=n_sites, cols=k, int32 count[rows] of species > threshold, int32 ids[rows * k] (-1 for none),
+//                  float64 possibility[rows * k]
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../BERNpp/DataAccess.h"
+#include "../BERNpp/Richness.h"
+
+namespace {
+
+    const char* usage =
+            "Usage: bern-serve [options]\n"
+            "\n"
+            "Loads the BERN database and evaluates sites for clients on a Unix domain socket\n"
+            "\n"
+            "Options:\n"
+            "  --data DIR           Directory with the BERN database files (default: BERNdata)\n"
+            "  --socket PATH        Path of the socket (default: /tmp/bern.sock)\n"
+            "  --coalesce US        Microseconds to wait for more requests before a batch is evaluated (default: 200)\n"
+            "  --max-sites N        Maximum number of sites per request (default: 16777216)\n"
+            "  --max-values N       Maximum number of result values per request, sites times communities or k\n"
+            "                       (default: 268435456)\n";
+
+    const uint32_t magic = 0x4E524542; // "BERN"
+    const uint16_t version = 1;
+
+    enum class Query : uint16_t {info = 0, possibility = 1, best = 2, species = 3};
+
+    struct Options {
+        std::string data = "BERNdata";
+        std::string socket = "/tmp/bern.sock";
+        long coalesce_us = 200;
+        size_t max_sites = size_t(1) << 24;
+        size_t max_values = size_t(1) << 28;
+    };
+
+    Options parse_options(int argc, char* argv[]) {
+        Options opt;
+        auto value = [&](int& i) -> std::string {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(std::string(argv[i]) + " needs a value");
+            return argv[++i];
+        };
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--data") {
+                opt.data = value(i);
+            } else if (arg == "--socket") {
+                opt.socket = value(i);
+            } else if (arg == "--coalesce") {
+                opt.coalesce_us = std::max(0L, std::stol(value(i)));
+            } else if (arg == "--max-sites") {
+                opt.max_sites = std::max<size_t>(1, std::stoul(value(i)));
+            } else if (arg == "--max-values") {
+                opt.max_values = std::max<size_t>(1, std::stoul(value(i)));
+            } else if (arg == "-h" || arg == "--help") {
+                std::cout << usage;
+                std::exit(0);
+            } else {
+                throw std::invalid_argument("Unknown option " + arg);
+            }
+        }
+        return opt;
+    }
+
+#pragma pack(push, 1)
+    struct RequestHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t query;
+        uint32_t n_sites;
+        uint32_t dims;
+        uint32_t k;
+        uint32_t n_ids;
+        double threshold;
+    };
+    struct ResponseHeader {
+        uint32_t magic;
+        int32_t status;
+        uint32_t rows;
+        uint32_t cols;
+        uint64_t size;
+    };
+#pragma pack(pop)
+
+    ///A request waiting for the engine, the connection thread waits for done
+    struct Job {
+        Query query = Query::info;
+        size_t k = 0;
+        double threshold = 0;
+        std::vector<const BERN::Community*> communities;
+        std::vector<BERN::SiteVector> sites;
+        ResponseHeader header{};
+        std::vector<char> payload;
+        std::promise<void> done;
+    };
+
+    ///A malformed request, the connection can not be used any more
+    struct ProtocolError : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    ///Reads exactly size bytes, returns false on end of file
+    bool read_exact(int fd, void* buffer, size_t size) {
+        char* p = static_cast<char*>(buffer);
+        while (size) {
+            ssize_t n = ::read(fd, p, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p += n;
+            size -= size_t(n);
+        }
+        return true;
+    }
+
+    bool write_exact(int fd, const void* buffer, size_t size) {
+        const char* p = static_cast<const char*>(buffer);
+        while (size) {
+            ssize_t n = ::write(fd, p, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p += n;
+            size -= size_t(n);
+        }
+        return true;
+    }
+
+    template<typename T>
+    void append(std::vector<char>& payload, const T* values, size_t n) {
+        const char* p = reinterpret_cast<const char*>(values);
+        payload.insert(payload.end(), p, p + n * sizeof(T));
+    }
+
+    ///Evaluates the coalesced jobs
+    class Engine {
+    public:
+        Engine(const BERN::Database& db, const Options& opt) : _opt(opt) {
+            for (int id: db.community_ids()) {
+                const BERN::Community* comm = db.find_community(id);
+                if (comm->size())
+                    _communities.push_back(comm);
+            }
+            for (int id: db.species_ids())
+                _species.push_back(db.find_species(id));
+            _species_table.reset(new BERN::SpeciesTable(_species));
+            _db = &db;
+        }
+        const std::vector<const BERN::Community*>& communities() const {return _communities;}
+        const BERN::Database& database() const {return *_db;}
+
+        ///Queues a job and waits for the result
+        void submit(Job& job) {
+            std::future<void> done = job.done.get_future();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _queue.push_back(&job);
+            }
+            _not_empty.notify_one();
+            done.wait();
+        }
+
+        ///The engine loop, runs until stop is called
+        void run() {
+            std::vector<Job*> batch;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _not_empty.wait(lock, [this]{return !_queue.empty() || _stopped;});
+                    if (_stopped && _queue.empty())
+                        return;
+                    // Waits a moment for concurrent requests, unless the batch is already large
+                    if (_opt.coalesce_us > 0 && waiting_sites() < _opt.max_sites) {
+                        _not_empty.wait_for(lock, std::chrono::microseconds(_opt.coalesce_us),
+                                            [this]{return _stopped || waiting_sites() >= _opt.max_sites;});
+                    }
+                    batch.assign(_queue.begin(), _queue.end());
+                    _queue.clear();
+                }
+                try {
+                    evaluate(batch);
+                } catch (const std::exception& e) {
+                    // The batch fails as a whole, its clients get the error and the engine keeps running
+                    const std::string error = e.what();
+                    for (Job* job: batch) {
+                        job->header = ResponseHeader{};
+                        job->header.status = -1;
+                        job->payload.assign(error.begin(), error.end());
+                    }
+                }
+                for (Job* job: batch)
+                    job->done.set_value();
+            }
+        }
+
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopped = true;
+            }
+            _not_empty.notify_all();
+        }
+
+    private:
+        ///Communities without species result in NaN
+        static double possibility(const BERN::Community* comm, const BERN::SiteVector& site) {
+            return comm->size() ? comm->possibility(site) : BERN::NaN;
+        }
+
+        size_t waiting_sites() const {
+            size_t n = 0;
+            for (const Job* job: _queue)
+                n += job->sites.size();
+            return n;
+        }
+
+        ///Evaluates the sites of all jobs in one parallel loop
+        void evaluate(const std::vector<Job*>& batch) const {
+            // offsets[j] is the first site of job j in the combined batch
+            std::vector<size_t> offsets(1, 0);
+            for (const Job* job: batch)
+                offsets.push_back(offsets.back() + job->sites.size());
+            std::vector<std::vector<double>> values(batch.size());
+            std::vector<std::vector<int>> ids(batch.size()), counts(batch.size());
+            for (size_t j = 0; j < batch.size(); ++j) {
+                const Job& job = *batch[j];
+                const size_t n = job.sites.size();
+                if (job.query == Query::possibility) {
+                    values[j].resize(n * job.communities.size());
+                } else if (job.query != Query::info) {
+                    values[j].assign(n * job.k, 0.0);
+                    ids[j].assign(n * job.k, -1);
+                    counts[j].resize(n);
+                }
+            }
+            const size_t total = offsets.back();
+#pragma omp parallel
+            {
+                std::vector<std::pair<double, int>> ranking;
+                std::vector<double> poss(_species_table->size());
+#pragma omp for schedule(dynamic, 16)
+                for (int i = 0; i < (int)total; ++i) {
+                    const size_t j = std::upper_bound(offsets.begin(), offsets.end(), size_t(i)) - offsets.begin() - 1;
+                    const Job& job = *batch[j];
+                    const size_t s = i - offsets[j];
+                    const BERN::SiteVector& site = job.sites[s];
+                    if (job.query == Query::possibility) {
+                        const size_t nc = job.communities.size();
+                        for (size_t c = 0; c < nc; ++c)
+                            values[j][s * nc + c] = possibility(job.communities[c], site);
+                        continue;
+                    }
+                    ranking.clear();
+                    if (job.query == Query::best) {
+                        for (auto comm: job.communities) {
+                            double p = possibility(comm, site);
+                            if (p > 0)
+                                ranking.emplace_back(p, comm->id);
+                        }
+                    } else {
+                        _species_table->possibility(site, poss.data(), job.threshold);
+                        for (size_t k = 0; k < poss.size(); ++k) {
+                            if (poss[k] > job.threshold)
+                                ranking.emplace_back(poss[k], _species_table->ids()[k]);
+                        }
+                    }
+                    counts[j][s] = int(ranking.size());
+                    const size_t n = std::min(job.k, ranking.size());
+                    // Highest possibility first, lower id first on ties
+                    std::partial_sort(ranking.begin(), ranking.begin() + n, ranking.end(),
+                                      [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+                                          return a.first > b.first || (a.first == b.first && a.second < b.second);
+                                      });
+                    for (size_t r = 0; r < n; ++r) {
+                        ids[j][s * job.k + r] = ranking[r].second;
+                        values[j][s * job.k + r] = ranking[r].first;
+                    }
+                }
+            }
+            for (size_t j = 0; j < batch.size(); ++j) {
+                Job& job = *batch[j];
+                job.header.rows = uint32_t(job.sites.size());
+                job.payload.clear();
+                switch (job.query) {
+                    case Query::info: {
+                        const int32_t info[3] = {int32_t(_db->type().size()), int32_t(_communities.size()),
+                                                 int32_t(_species.size())};
+                        job.header.rows = 1;
+                        job.header.cols = uint32_t(_communities.size());
+                        append(job.payload, info, 3);
+                        for (auto comm: _communities) {
+                            const int32_t id = comm->id;
+                            append(job.payload, &id, 1);
+                        }
+                        break;
+                    }
+                    case Query::possibility:
+                        job.header.cols = uint32_t(job.communities.size());
+                        append(job.payload, values[j].data(), values[j].size());
+                        break;
+                    case Query::species:
+                        append(job.payload, counts[j].data(), counts[j].size());
+                        // fall through
+                    case Query::best:
+                        job.header.cols = uint32_t(job.k);
+                        append(job.payload, ids[j].data(), ids[j].size());
+                        append(job.payload, values[j].data(), values[j].size());
+                        break;
+                }
+            }
+        }
+
+        const Options& _opt;
+        const BERN::Database* _db = nullptr;
+        std::vector<const BERN::Community*> _communities;
+        std::vector<const BERN::Species*> _species;
+        std::unique_ptr<BERN::SpeciesTable> _species_table;
+        std::deque<Job*> _queue;
+        bool _stopped = false;
+        std::mutex _mutex;
+        std::condition_variable _not_empty;
+    };
+
+    ///Reads a request, returns false if the client closed the connection
+    bool read_request(int fd, const Engine& engine, const Options& opt, Job& job) {
+        RequestHeader header;
+        if (!read_exact(fd, &header, sizeof(header)))
+            return false;
+        if (header.magic != magic || header.version != version)
+            throw ProtocolError("Unknown protocol");
+        if (header.query > uint16_t(Query::species))
+            throw std::invalid_argument("Unknown query " + std::to_string(header.query));
+        // The ids and sites of a request that is too large or has another dims are not read, which breaks
+        // the framing. The checks come before anything is allocated
+        if (header.n_sites > opt.max_sites)
+            throw ProtocolError("More than " + std::to_string(opt.max_sites) + " sites");
+        if (header.n_ids > engine.communities().size() + 1024)
+            throw ProtocolError("Too many community ids");
+        const size_t dims = engine.database().type().size();
+        if (header.n_sites && header.dims != dims)
+            throw ProtocolError("Sites need " + std::to_string(dims) + " dimensions");
+        job.query = Query(header.query);
+        job.k = header.k;
+        job.threshold = header.threshold;
+        std::vector<int32_t> ids(header.n_ids);
+        std::vector<double> sites(size_t(header.n_sites) * header.dims);
+        if (!read_exact(fd, ids.data(), ids.size() * sizeof(int32_t)) ||
+            !read_exact(fd, sites.data(), sites.size() * sizeof(double)))
+            return false;
+        // The request is complete, now it can be checked without losing the framing
+        if ((job.query == Query::best || job.query == Query::species) && (job.k == 0 || job.k > 65536))
+            throw std::invalid_argument("k must be 1 ... 65536");
+        job.communities.clear();
+        if (ids.empty()) {
+            job.communities = engine.communities();
+        } else {
+            for (int32_t id: ids) {
+                const BERN::Community* comm = engine.database().find_community(id);
+                if (!comm)
+                    throw std::out_of_range("Community " + std::to_string(id) + " does not exist");
+                job.communities.push_back(comm);
+            }
+        }
+        // The result is allocated by the engine for the whole batch
+        const size_t cols = job.query == Query::possibility ? job.communities.size()
+                            : job.query == Query::info ? 0 : job.k;
+        if (size_t(header.n_sites) * cols > opt.max_values)
+            throw std::invalid_argument("More than " + std::to_string(opt.max_values) + " result values");
+        job.sites.assign(header.n_sites, engine.database().site());
+        for (size_t s = 0; s < job.sites.size(); ++s)
+            std::copy(sites.begin() + s * dims, sites.begin() + (s + 1) * dims, job.sites[s].begin());
+        return true;
+    }
+
+    bool write_response(int fd, ResponseHeader header, const std::vector<char>& payload) {
+        header.magic = magic;
+        header.size = payload.size();
+        return write_exact(fd, &header, sizeof(header)) && write_exact(fd, payload.data(), payload.size());
+    }
+
+    ///Answers the requests of a connection until the client closes it
+    void serve(int fd, Engine& engine, const Options& opt) {
+        while (true) {
+            Job job;
+            std::string error;
+            bool lost = false;
+            try {
+                if (!read_request(fd, engine, opt, job))
+                    break;
+            } catch (const ProtocolError& e) {
+                error = e.what();
+                lost = true;
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            if (!error.empty()) {
+                ResponseHeader header{};
+                header.status = -1;
+                if (!write_response(fd, header, std::vector<char>(error.begin(), error.end())) || lost)
+                    break;
+                continue;
+            }
+            engine.submit(job);
+            if (!write_response(fd, job.header, job.payload))
+                break;
+        }
+        ::close(fd);
+    }
+
+    std::atomic<bool> stop_requested(false);
+
+    extern "C" void on_signal(int) {
+        stop_requested = true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options opt = parse_options(argc, argv);
+
+        BERN::Database db(opt.data + "/site_type.tsv");
+        db.load_species(opt.data + "/plant-species.tsv");
+        db.load_communities(opt.data + "/communities.tsv");
+        db.link_communities(opt.data + "/link_plantspecies_to_community.tsv");
+        Engine engine(db, opt);
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (opt.socket.size() >= sizeof(address.sun_path))
+            throw std::invalid_argument("Socket path " + opt.socket + " is too long");
+        std::strncpy(address.sun_path, opt.socket.c_str(), sizeof(address.sun_path) - 1);
+        const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0)
+            throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+        ::unlink(opt.socket.c_str());
+        if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listener, 64) < 0)
+            throw std::runtime_error(opt.socket + ": " + std::strerror(errno));
+
+        // A client closing its connection early must not end the server
+        std::signal(SIGPIPE, SIG_IGN);
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        std::thread engine_thread([&]{engine.run();});
+        std::cerr << "bern-serve: " << engine.communities().size() << " communities on " << opt.socket << "\n";
+
+        // Connections are detached, they end with the process
+        while (!stop_requested) {
+            pollfd p{listener, POLLIN, 0};
+            if (::poll(&p, 1, 250) <= 0)
+                continue;
+            const int fd = ::accept(listener, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            std::thread(serve, fd, std::ref(engine), std::cref(opt)).detach();
+        }
+        ::close(listener);
+        ::unlink(opt.socket.c_str());
+        engine.stop();
+        engine_thread.join();
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "bern-serve: " << e.what() << "\n";
+        return 1;
+    }
+}
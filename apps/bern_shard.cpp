@@ -0,0 +1,457 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// bern-shard: Sharded batch evaluation with one worker process per shard
+//
+// The parent loads the database and maps the input (float64 rows in site_type order) and the output
+// before the workers are forked, hence all workers share the database pages copy-on-write and write
+// disjoint rows of the output file. Each worker is pinned to the CPUs of a NUMA node and uses the
+// threads of that node. A shard of a crashed or killed worker is restarted. Reductions are written per
+// shard and merged by the parent in shard order, hence the result does not depend on the schedule.
+//
+// The parent must not start OpenMP threads before forking, the workers use their own thread pools.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "../BERNpp/DataAccess.h"
+#include "../BERNpp/MappedMatrix.h"
+#include "../BERNpp/Richness.h"
+
+namespace {
+
+    const char* usage =
+            "Usage: bern-shard [options] input output.npy\n"
+            "\n"
+            "Evaluates the sites of input (float64 rows with all dimensions in site_type order) in shards\n"
+            "by forked worker processes and writes the result as .npy file\n"
+            "\n"
+            "Options:\n"
+            "  --data DIR           Directory with the BERN database files (default: BERNdata)\n"
+            "  --query QUERY        possibility: possibility of the communities (sites, communities) (default)\n"
+            "                       best: id (-1 for none) and possibility of the best community (sites, 2)\n"
+            "                       richness: number and possibility sum of the species above the threshold (sites, 2)\n"
+            "                       mean: id and mean possibility of each community over all sites (communities, 2)\n"
+            "  --dtype TYPE         float64, float32, float16 or uint8 for possibility (default: float32)\n"
+            "  --threshold X        Minimum possibility for richness (default: 0)\n"
+            "  --shard N            Number of sites per shard (default: 262144)\n"
+            "  --workers N          Number of concurrent workers (default: number of NUMA nodes)\n"
+            "  --retries N          Restarts of a failed shard before the run fails (default: 2)\n";
+
+    enum class Query {possibility, best, richness, mean};
+
+    struct Options {
+        std::string data = "BERNdata";
+        std::string input;
+        std::string output;
+        Query query = Query::possibility;
+        BERN::MatrixType dtype = BERN::MatrixType::float32;
+        double threshold = 0;
+        size_t shard = 262144;
+        size_t workers = 0;
+        int retries = 2;
+    };
+
+    Options parse_options(int argc, char* argv[]) {
+        Options opt;
+        auto value = [&](int& i) -> std::string {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(std::string(argv[i]) + " needs a value");
+            return argv[++i];
+        };
+        std::vector<std::string> files;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--data") {
+                opt.data = value(i);
+            } else if (arg == "--query") {
+                std::string query = value(i);
+                if (query == "possibility") opt.query = Query::possibility;
+                else if (query == "best") opt.query = Query::best;
+                else if (query == "richness") opt.query = Query::richness;
+                else if (query == "mean") opt.query = Query::mean;
+                else throw std::invalid_argument("Unknown query " + query);
+            } else if (arg == "--dtype") {
+                std::string dtype = value(i);
+                if (dtype == "float64") opt.dtype = BERN::MatrixType::float64;
+                else if (dtype == "float32") opt.dtype = BERN::MatrixType::float32;
+                else if (dtype == "float16") opt.dtype = BERN::MatrixType::float16;
+                else if (dtype == "uint8") opt.dtype = BERN::MatrixType::uint8;
+                else throw std::invalid_argument("Unknown dtype " + dtype);
+            } else if (arg == "--threshold") {
+                opt.threshold = std::stod(value(i));
+            } else if (arg == "--shard") {
+                opt.shard = std::max<size_t>(1, std::stoul(value(i)));
+            } else if (arg == "--workers") {
+                opt.workers = std::stoul(value(i));
+            } else if (arg == "--retries") {
+                opt.retries = std::max(0, std::stoi(value(i)));
+            } else if (arg == "-h" || arg == "--help") {
+                std::cout << usage;
+                std::exit(0);
+            } else if (arg.size() > 1 && arg[0] == '-') {
+                throw std::invalid_argument("Unknown option " + arg);
+            } else {
+                files.push_back(arg);
+            }
+        }
+        if (files.size() != 2)
+            throw std::invalid_argument("Needs an input and an output file, see --help");
+        opt.input = files[0];
+        opt.output = files[1];
+        return opt;
+    }
+
+    ///Parses a CPU list of the Linux sysfs, e.g. "0-3,8-11"
+    std::vector<int> parse_cpulist(const std::string& text) {
+        std::vector<int> cpus;
+        std::stringstream ranges(text);
+        std::string range;
+        while (std::getline(ranges, range, ',')) {
+            if (range.empty() || !std::isdigit((unsigned char)range[0]))
+                continue;
+            const size_t dash = range.find('-');
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    ///The CPUs of each NUMA node. Without NUMA information all allowed CPUs are one node
+    std::vector<std::vector<int>> numa_nodes() {
+        std::vector<std::vector<int>> nodes;
+        for (int node = 0; ; ++node) {
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string text;
+            if (!cpulist || !std::getline(cpulist, text))
+                break;
+            std::vector<int> cpus = parse_cpulist(text);
+            if (!cpus.empty())
+                nodes.push_back(cpus);
+        }
+        if (nodes.empty()) {
+            std::vector<int> cpus;
+#ifdef __linux__
+            cpu_set_t set;
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                    if (CPU_ISSET(cpu, &set))
+                        cpus.push_back(cpu);
+            }
+#endif
+            if (cpus.empty())
+                cpus.push_back(-1);
+            nodes.push_back(cpus);
+        }
+        return nodes;
+    }
+
+    ///Restricts the calling process to the CPUs and uses a thread for each
+    void pin(const std::vector<int>& cpus) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu: cpus)
+            if (cpu >= 0)
+                CPU_SET(cpu, &set);
+        if (CPU_COUNT(&set))
+            sched_setaffinity(0, sizeof(set), &set);
+#endif
+        if (cpus.size() > 1 || cpus[0] >= 0)
+            omp_set_num_threads(int(cpus.size()));
+    }
+
+    ///A read only mapping of the input file with the sites of the schema type
+    class InputFile {
+    public:
+        InputFile(const std::string& filename, const BERN::SiteType& type) : _type(type) {
+            const int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error(filename + ": " + std::strerror(errno));
+            struct stat info;
+            if (::fstat(fd, &info) < 0) {
+                ::close(fd);
+                throw std::runtime_error(filename + ": " + std::strerror(errno));
+            }
+            _size = size_t(info.st_size);
+            // A partial row means another number of dimensions than the schema
+            if (_size % (_type.size() * sizeof(double))) {
+                ::close(fd);
+                throw std::runtime_error(filename + " has no whole rows of " + std::to_string(_type.size()) +
+                                         " float64 values");
+            }
+            if (_size) {
+                void* data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+                if (data == MAP_FAILED) {
+                    ::close(fd);
+                    throw std::runtime_error(filename + ": " + std::strerror(errno));
+                }
+                _data = static_cast<const double*>(data);
+            }
+            ::close(fd);
+        }
+        ~InputFile() {
+            if (_data)
+                ::munmap(const_cast<double*>(_data), _size);
+        }
+        size_t rows() const {return _size / (_type.size() * sizeof(double));}
+        std::vector<BERN::SiteVector> sites(size_t first, size_t count) const {
+            const size_t dims = _type.size();
+            std::vector<BERN::SiteVector> res(count, BERN::SiteVector(_type));
+            for (size_t s = 0; s < count; ++s)
+                std::copy(_data + (first + s) * dims, _data + (first + s + 1) * dims, res[s].begin());
+            return res;
+        }
+    private:
+        const BERN::SiteType& _type;
+        const double* _data = nullptr;
+        size_t _size = 0;
+    };
+
+    ///Shared memory for the per shard reductions, written by the workers and read by the parent
+    class SharedBuffer {
+    public:
+        explicit SharedBuffer(size_t count) : _count(count) {
+            if (!count)
+                return;
+            void* data = ::mmap(nullptr, count * sizeof(double), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if (data == MAP_FAILED)
+                throw std::runtime_error(std::string("Shared memory: ") + std::strerror(errno));
+            _data = static_cast<double*>(data);
+        }
+        ~SharedBuffer() {
+            if (_data)
+                ::munmap(_data, _count * sizeof(double));
+        }
+        double* data() const {return _data;}
+    private:
+        double* _data = nullptr;
+        size_t _count;
+    };
+
+    ///Evaluates a shard in a worker process
+    void run_shard(const Options& opt, const std::vector<const BERN::Community*>& comms,
+                   const std::vector<const BERN::Species*>& species,
+                   const InputFile& input, size_t first, size_t count, BERN::MappedMatrix* out, double* sums) {
+        const std::vector<BERN::SiteVector> sites = input.sites(first, count);
+        switch (opt.query) {
+            case Query::possibility:
+                BERN::possibility_matrix(comms, sites, *out, first);
+                break;
+            case Query::best:
+#pragma omp parallel for
+                for (int s = 0; s < (int)count; ++s) {
+                    double best[2] = {-1, 0};
+                    for (auto comm: comms) {
+                        const double p = comm->possibility(sites[s]);
+                        if (p > best[1]) {
+                            best[0] = comm->id;
+                            best[1] = p;
+                        }
+                    }
+                    out->write(first + s, 0, best, 2);
+                }
+                break;
+            case Query::richness: {
+                const BERN::RichnessResult res = BERN::species_richness(species, sites, opt.threshold);
+                for (size_t s = 0; s < count; ++s) {
+                    const double row[2] = {double(res.count[s]), res.sum[s]};
+                    out->write(first + s, 0, row, 2);
+                }
+                break;
+            }
+            case Query::mean: {
+                // The sums of the shard, the parent adds the shards in order
+                std::fill(sums, sums + comms.size(), 0.0);
+#pragma omp parallel for
+                for (int c = 0; c < (int)comms.size(); ++c) {
+                    double sum = 0;
+                    for (const auto& site: sites)
+                        sum += comms[c]->possibility(site);
+                    sums[c] = sum;
+                }
+                break;
+            }
+        }
+    }
+
+    struct Running {
+        size_t shard;
+        int attempt;
+    };
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options opt = parse_options(argc, argv);
+
+        BERN::Database db(opt.data + "/site_type.tsv");
+        db.load_species(opt.data + "/plant-species.tsv");
+        db.load_communities(opt.data + "/communities.tsv");
+        db.link_communities(opt.data + "/link_plantspecies_to_community.tsv");
+        std::vector<const BERN::Community*> comms;
+        for (int id: db.community_ids()) {
+            const BERN::Community* comm = db.find_community(id);
+            if (comm->size())
+                comms.push_back(comm);
+        }
+        std::vector<const BERN::Species*> species;
+        for (int id: db.species_ids())
+            species.push_back(db.find_species(id));
+
+        const InputFile input(opt.input, db.type());
+        const size_t rows = input.rows();
+        const size_t shards = (rows + opt.shard - 1) / opt.shard;
+        std::unique_ptr<BERN::MappedMatrix> out;
+        switch (opt.query) {
+            case Query::possibility:
+                out.reset(new BERN::MappedMatrix(opt.output, rows, comms.size(), opt.dtype));
+                break;
+            case Query::best:
+            case Query::richness:
+                out.reset(new BERN::MappedMatrix(opt.output, rows, 2, BERN::MatrixType::float64));
+                break;
+            case Query::mean:
+                break;
+        }
+        const SharedBuffer sums(opt.query == Query::mean ? shards * comms.size() : 0);
+
+        const std::vector<std::vector<int>> nodes = numa_nodes();
+        const size_t workers = std::max<size_t>(1, opt.workers ? opt.workers : nodes.size());
+        // The CPUs of a node are divided between the worker slots on that node
+        std::vector<std::vector<int>> slot_cpus(workers);
+        for (size_t w = 0; w < workers; ++w) {
+            const std::vector<int>& cpus = nodes[w % nodes.size()];
+            const size_t on_node = (workers - w % nodes.size() + nodes.size() - 1) / nodes.size();
+            const size_t index = w / nodes.size();
+            for (size_t i = index; i < cpus.size(); i += on_node)
+                slot_cpus[w].push_back(cpus[i]);
+            if (slot_cpus[w].empty())
+                slot_cpus[w] = cpus;
+        }
+        std::cerr << "bern-shard: " << rows << " sites in " << shards << " shards, " << workers << " workers on "
+                  << nodes.size() << " NUMA nodes\n";
+
+        std::deque<Running> pending;
+        for (size_t s = 0; s < shards; ++s)
+            pending.push_back(Running{s, 0});
+        std::map<pid_t, std::pair<Running, size_t>> running;
+        std::vector<bool> busy(workers, false);
+        std::cout.flush();
+        std::cerr.flush();
+        bool failed = false;
+        while (!failed && (!pending.empty() || !running.empty())) {
+            // Starts workers on the free slots
+            for (size_t w = 0; w < workers && !pending.empty(); ++w) {
+                if (busy[w])
+                    continue;
+                const Running job = pending.front();
+                pending.pop_front();
+                const size_t first = job.shard * opt.shard;
+                const size_t count = std::min(opt.shard, rows - first);
+                const pid_t pid = ::fork();
+                if (pid < 0)
+                    throw std::runtime_error(std::string("fork: ") + std::strerror(errno));
+                if (pid == 0) {
+                    int status = 0;
+                    try {
+                        pin(slot_cpus[w]);
+                        run_shard(opt, comms, species, input, first, count, out.get(),
+                                  sums.data() ? sums.data() + job.shard * comms.size() : nullptr);
+                    } catch (const std::exception& e) {
+                        std::cerr << "bern-shard: shard " << job.shard << ": " << e.what() << "\n";
+                        status = 2;
+                    }
+                    // No destructors and no atexit handlers of the parent in the worker
+                    ::_exit(status);
+                }
+                busy[w] = true;
+                running[pid] = std::make_pair(job, w);
+            }
+            int status = 0;
+            const pid_t pid = ::waitpid(-1, &status, 0);
+            if (pid < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error(std::string("waitpid: ") + std::strerror(errno));
+            }
+            auto it = running.find(pid);
+            if (it == running.end())
+                continue;
+            Running job = it->second.first;
+            busy[it->second.second] = false;
+            running.erase(it);
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+                continue;
+            std::cerr << "bern-shard: shard " << job.shard << " failed ("
+                      << (WIFSIGNALED(status) ? "signal " + std::to_string(WTERMSIG(status))
+                                              : "exit code " + std::to_string(WEXITSTATUS(status))) << ")";
+            if (++job.attempt > opt.retries) {
+                std::cerr << ", giving up\n";
+                failed = true;
+            } else {
+                std::cerr << ", restarting\n";
+                pending.push_back(job);
+            }
+        }
+        if (failed) {
+            for (auto& item: running)
+                ::kill(item.first, SIGTERM);
+            while (::wait(nullptr) > 0) {}
+            return 1;
+        }
+
+        if (opt.query == Query::mean) {
+            // Merged in shard order, the result is independent of the schedule
+            BERN::MappedMatrix mean(opt.output, comms.size(), 2, BERN::MatrixType::float64);
+            for (size_t c = 0; c < comms.size(); ++c) {
+                double sum = 0;
+                for (size_t s = 0; s < shards; ++s)
+                    sum += sums.data()[s * comms.size() + c];
+                const double row[2] = {double(comms[c]->id), rows ? sum / double(rows) : BERN::NaN};
+                mean.write(c, 0, row, 2);
+            }
+        }
+        if (out)
+            out->flush();
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "bern-shard: " << e.what() << "\n";
+        return 1;
+    }
+}
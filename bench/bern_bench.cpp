@@ -0,0 +1,330 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// bern-bench: Micro and macro benchmarks of the BERN library
+//
+// All synthetic sites are drawn from a seeded counter based random generator, uniform within the
+// range of each SiteValue, hence runs with the same seed and database use the same inputs.
+// The results are written as JSON to track regressions between releases.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <cstdlib>
+#include <omp.h>
+
+#include "../BERNpp/DataAccess.h"
+#include "../BERNpp/Random.h"
+
+namespace {
+
+    const char* usage =
+            "Usage: bern-bench [options]\n"
+            "\n"
+            "Options:\n"
+            "  --data DIR        Directory with the BERN database files (default: BERNdata)\n"
+            "  --seed N          Seed of the site generator (default: 42)\n"
+            "  --repeat N        Repetitions of each benchmark, the minimum and median are reported (default: 5)\n"
+            "  --max-sites N     Largest number of sites for the macro benchmarks, 1e3 .. 1e7 (default: 1e5)\n"
+            "  --quick           Skips the full calculation of all community optima\n"
+            "  --output FILE     JSON output (default: stdout)\n";
+
+    struct Options {
+        std::string data = "BERNdata";
+        uint64_t seed = 42;
+        int repeat = 5;
+        size_t max_sites = 100000;
+        bool quick = false;
+        std::string output = "-";
+    };
+
+    Options parse_options(int argc, char* argv[]) {
+        Options opt;
+        auto value = [&](int& i) -> std::string {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(std::string(argv[i]) + " needs a value");
+            return argv[++i];
+        };
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--data") opt.data = value(i);
+            else if (arg == "--seed") opt.seed = std::stoull(value(i));
+            else if (arg == "--repeat") opt.repeat = std::max(1, std::stoi(value(i)));
+            else if (arg == "--max-sites") opt.max_sites = size_t(std::stod(value(i)));
+            else if (arg == "--quick") opt.quick = true;
+            else if (arg == "--output") opt.output = value(i);
+            else if (arg == "-h" || arg == "--help") {
+                std::cout << usage;
+                std::exit(0);
+            } else throw std::invalid_argument("Unknown option " + arg);
+        }
+        return opt;
+    }
+
+    ///Seeded generator of synthetic sites of a schema, uniform in the range of each site dimension
+    class SiteGenerator {
+    public:
+        SiteGenerator(uint64_t seed, const BERN::SiteType& type) : _rng(seed), _type(type) {}
+        BERN::SiteVector site(uint64_t index) const {
+            BERN::SiteVector res(_type);
+            for (size_t d = 0; d < _type.size(); ++d)
+                res[d] = _rng.uniform(index, d, _type[d].min, _type[d].max);
+            return res;
+        }
+        ///A site scattered around center with a standard deviation of 10% of each range
+        BERN::SiteVector near(const BERN::SiteVector& center, uint64_t index) const {
+            BERN::SiteVector res(_type);
+            for (size_t d = 0; d < _type.size(); ++d) {
+                const BERN::SiteValue& sv = _type[d];
+                double x = center[d] + 0.1 * (sv.max - sv.min) * _rng.normal(index, d);
+                res[d] = std::min(sv.max, std::max(sv.min, x));
+            }
+            return res;
+        }
+        std::vector<BERN::SiteVector> sites(size_t n, uint64_t first=0) const {
+            std::vector<BERN::SiteVector> res(n);
+            for (size_t i = 0; i < n; ++i)
+                res[i] = site(first + i);
+            return res;
+        }
+    private:
+        BERN::CounterRNG _rng;
+        const BERN::SiteType& _type;
+    };
+
+    struct Result {
+        std::string name;
+        size_t n;
+        int repeats;
+        double min;
+        double median;
+    };
+
+    ///Runs the benchmarks and collects the timings
+    class Runner {
+    public:
+        explicit Runner(int repeat) : _repeat(repeat) {}
+
+        ///Times function repeat times, n is the number of operations per call for the ns/op value
+        void run(const std::string& name, size_t n, const std::function<void()>& function, int repeat=0) {
+            const int count = repeat ? repeat : _repeat;
+            std::vector<double> times;
+            for (int i = 0; i < count; ++i) {
+                auto start = std::chrono::steady_clock::now();
+                function();
+                std::chrono::duration<double> dt = std::chrono::steady_clock::now() - start;
+                times.push_back(dt.count());
+            }
+            std::sort(times.begin(), times.end());
+            Result res{name, n, count, times.front(), times[times.size() / 2]};
+            std::cerr << name << " n=" << n << ": " << res.min << "s (" << res.min / n * 1e9 << " ns/op)\n";
+            _results.push_back(res);
+        }
+
+        void write_json(std::ostream& out, const Options& opt, size_t dims) const {
+            out << "{\n";
+            out << "  \"seed\": " << opt.seed << ",\n";
+            out << "  \"threads\": " << omp_get_max_threads() << ",\n";
+            out << "  \"dims\": " << dims << ",\n";
+#ifdef __VERSION__
+            out << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#endif
+            out << "  \"results\": [\n";
+            for (size_t i = 0; i < _results.size(); ++i) {
+                const Result& r = _results[i];
+                out << "    {\"name\": \"" << r.name << "\", \"n\": " << r.n << ", \"repeats\": " << r.repeats
+                    << ", \"min_s\": " << r.min << ", \"median_s\": " << r.median
+                    << ", \"ns_per_op\": " << r.min / r.n * 1e9 << "}" << (i + 1 < _results.size() ? "," : "") << "\n";
+            }
+            out << "  ]\n}\n";
+        }
+    private:
+        int _repeat;
+        std::vector<Result> _results;
+    };
+
+    //Keeps the compiler from removing the benchmarked calculations
+    volatile double sink;
+
+    void load(BERN::Database& db, const std::string& data) {
+        db.load_species(data + "/plant-species.tsv");
+        db.load_communities(data + "/communities.tsv");
+        db.link_communities(data + "/link_plantspecies_to_community.tsv");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options opt = parse_options(argc, argv);
+        Runner runner(opt.repeat);
+
+        // Macro: database load
+        runner.run("load_database", 1, [&]{
+            BERN::Database db(opt.data + "/site_type.tsv");
+            load(db, opt.data);
+        });
+        BERN::Database db(opt.data + "/site_type.tsv");
+        load(db, opt.data);
+        const SiteGenerator generator(opt.seed, db.type());
+
+        std::vector<const BERN::Community*> comms;
+        for (int id: db.community_ids()) {
+            if (db.community(id).size())
+                comms.push_back(&db.community(id));
+        }
+        std::vector<const BERN::Species*> species;
+        for (int id: db.species_ids())
+            species.push_back(&db.species(id));
+
+        // Micro benchmarks
+        const size_t n_micro = 100000;
+        const std::vector<BERN::SiteVector> sites = generator.sites(n_micro);
+        runner.run("trapez", n_micro, [&]{
+            double sum = 0;
+            for (size_t i = 0; i < n_micro; ++i)
+                sum += BERN::trapez(sites[i][0], 4, 5, 6, 7);
+            sink = sum;
+        });
+        runner.run("species_possibility", n_micro, [&]{
+            double sum = 0;
+            for (size_t i = 0; i < n_micro; ++i)
+                sum += species[i % species.size()]->possibility(sites[i]);
+            sink = sum;
+        });
+        runner.run("community_possibility", n_micro, [&]{
+            double sum = 0;
+            for (size_t i = 0; i < n_micro; ++i)
+                sum += comms[i % comms.size()]->possibility(sites[i]);
+            sink = sum;
+        });
+        runner.run("site_range_ops", n_micro, [&]{
+            size_t inside = 0;
+            for (size_t i = 0; i < n_micro; ++i) {
+                const BERN::SiteRange& a = species[i % species.size()]->pess;
+                const BERN::SiteRange& b = species[(i * 7 + 1) % species.size()]->pess;
+                BERN::SiteRange c = (a & b) | a;
+                inside += c.contains(sites[i]);
+            }
+            sink = double(inside);
+        });
+        {
+            // Realistic sites are close to the center of some community, where most envelope tests pass and
+            // the order of the species evaluation matters. The naive loop evaluates all species in insertion order
+            std::vector<BERN::SiteVector> near_sites(n_micro);
+            for (size_t i = 0; i < n_micro; ++i)
+                near_sites[i] = generator.near(comms[i % comms.size()]->center(), i);
+            runner.run("community_possibility_realistic_naive", n_micro, [&]{
+                double sum = 0;
+                for (size_t i = 0; i < n_micro; ++i) {
+                    double A = 1, B = 1;
+                    for (auto spec: comms[i % comms.size()]->species()) {
+                        double poss = spec->possibility(near_sites[i]);
+                        A *= poss;
+                        B *= 1 - poss;
+                    }
+                    sum += pow(A, 0.2) * pow(1 - B, 0.8);
+                }
+                sink = sum;
+            });
+            runner.run("community_possibility_realistic", n_micro, [&]{
+                double sum = 0;
+                for (size_t i = 0; i < n_micro; ++i)
+                    sum += comms[i % comms.size()]->possibility(near_sites[i]);
+                sink = sum;
+            });
+            db.adapt_evaluation_order(std::vector<BERN::SiteVector>(near_sites.begin(), near_sites.begin() + 1000));
+            runner.run("community_possibility_realistic_adapted", n_micro, [&]{
+                double sum = 0;
+                for (size_t i = 0; i < n_micro; ++i)
+                    sum += comms[i % comms.size()]->possibility(near_sites[i]);
+                sink = sum;
+            });
+        }
+        {
+            // The optimizer of the first communities, invalidate() forces the recalculation
+            const size_t n_opt = std::min<size_t>(50, comms.size());
+            runner.run("calculate_optimum", n_opt, [&]{
+                for (size_t i = 0; i < n_opt; ++i) {
+                    auto comm = const_cast<BERN::Community*>(comms[i]);
+                    comm->invalidate();
+                    sink = comm->optimum().value;
+                }
+            });
+        }
+
+        // Macro benchmarks
+        if (!opt.quick) {
+            runner.run("calculate_optima", comms.size(), [&]{
+                for (auto comm: comms)
+                    const_cast<BERN::Community*>(comm)->invalidate();
+                db.calculate_optima();
+            }, 1);
+        }
+        // The matrix is evaluated in chunks to keep the memory bounded for large site numbers
+        const size_t chunk = std::max<size_t>(1, (size_t(1) << 24) / comms.size());
+        for (size_t n = 1000; n <= opt.max_sites; n *= 10) {
+            const int repeat = n >= 1000000 ? 1 : opt.repeat;
+            const std::vector<BERN::SiteVector> batch = generator.sites(std::min(n, chunk), n_micro);
+            runner.run("possibility_matrix", n * comms.size(), [&]{
+                for (size_t done = 0; done < n; done += batch.size()) {
+                    std::vector<double> res = BERN::possibility_matrix(comms, batch);
+                    sink = res[0];
+                }
+            }, repeat);
+            runner.run("top5_communities", n, [&]{
+                const size_t k = 5;
+                for (size_t done = 0; done < n; done += batch.size()) {
+                    std::vector<int> best(batch.size() * k);
+#pragma omp parallel
+                    {
+                        std::vector<std::pair<double, int>> ranking(comms.size());
+#pragma omp for
+                        for (int s = 0; s < (int)batch.size(); ++s) {
+                            for (size_t c = 0; c < comms.size(); ++c)
+                                ranking[c] = {comms[c]->possibility(batch[s]), comms[c]->id};
+                            std::partial_sort(ranking.begin(), ranking.begin() + k, ranking.end(),
+                                              [](const std::pair<double, int>& a, const std::pair<double, int>& b) {
+                                                  return a.first > b.first;
+                                              });
+                            for (size_t i = 0; i < k; ++i)
+                                best[s * k + i] = ranking[i].second;
+                        }
+                    }
+                    sink = best[0];
+                }
+            }, repeat);
+        }
+
+        if (opt.output == "-") {
+            runner.write_json(std::cout, opt, db.type().size());
+        } else {
+            std::ofstream out(opt.output);
+            runner.write_json(out, opt, db.type().size());
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "bern-bench: " << e.what() << "\n";
+        return 1;
+    }
+}
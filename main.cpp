@@ -35,9 +35,9 @@ void print_communities(BERN::Database& db) {
     }
 
 }
-void print_community_details(BERN::Community& com) {
+void print_community_details(const BERN::Community& com) {
     std::cout << com.id << " " << com.name << "\n";
-    for (auto& spec: com.species) {
+    for (auto& spec: com.species()) {
         std::cout << "\t" << spec->id << " " << spec->name << "\n";
         std::cout << "\t\tmin:" << spec->pess.min << "\n";
         std::cout << "\t\tmax:" << spec->pess.max << "\n";
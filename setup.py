@@ -1,8 +1,9 @@
 import sys
+import os
 from setuptools import setup, Extension
 import glob
 
-sources = [f'BERNpp/{s}.cpp' for s in 'SiteVector,Community,species,DataAccess'.split(',')] + ['BERNpp/bern.i']
+sources = [f'BERNpp/{s}.cpp' for s in 'SiteVector,Community,species,DataAccess,Bioindication,Names,Uncertainty,Stats,Calibration,Trajectory,Scenario,Grid,Slice,Overlap,OptimumIndex,Richness,Indicators,MappedMatrix'.split(',')] + ['BERNpp/bern.i']
 print('\n'.join(sources))
 
 def version():
@@ -15,7 +16,9 @@ def version():
 bern = Extension(
     '_bern',
     sources=sources,
-    swig_opts=['-c++', '-doxygen', '-py3']
+    swig_opts=['-c++', '-doxygen', '-py3'],
+    # Set the environment variable BERN_STATS=1 to build with the hot path counters (bern.Stats)
+    define_macros=[('BERN_STATS', '1')] if os.environ.get('BERN_STATS') else []
 )
 
 setup(
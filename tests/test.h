@@ -0,0 +1,99 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Minimal assertions for the regression tests. Each test is a program, registered with ctest and run in the
+// repository root, hence the test databases are loaded from BERNdata.
+
+#ifndef BERN_test_h__
+#define BERN_test_h__
+
+#include <iostream>
+#include <string>
+#include <cmath>
+
+#include "../BERNpp/DataAccess.h"
+
+namespace test {
+    int failures = 0;
+
+    void check(bool ok, const char* text, const char* file, int line) {
+        if (!ok) {
+            ++failures;
+            std::cerr << file << ":" << line << ": check failed: " << text << "\n";
+        }
+    }
+
+    ///@brief 0 if all checks passed, the exit code of the test program
+    int report() {
+        if (failures)
+            std::cerr << failures << " checks failed\n";
+        return failures ? 1 : 0;
+    }
+
+    ///@brief Loads the database of BERNdata with its own site schema
+    void load(BERN::Database& db) {
+        db.load_species("BERNdata/plant-species.tsv");
+        db.load_communities("BERNdata/communities.tsv");
+        db.link_communities("BERNdata/link_plantspecies_to_community.tsv");
+    }
+
+    ///@brief All communities with species of the database
+    std::vector<const BERN::Community*> communities(const BERN::Database& db) {
+        std::vector<const BERN::Community*> res;
+        for (int id: db.community_ids())
+            if (db.find_community(id)->size())
+                res.push_back(db.find_community(id));
+        return res;
+    }
+
+    ///@brief The first community with a possibility > min at the center of its envelope
+    const BERN::Community* possible(const std::vector<const BERN::Community*>& comms, double min=0) {
+        for (auto comm: comms)
+            if (comm->possibility(comm->center()) > min)
+                return comm;
+        return nullptr;
+    }
+
+    ///@brief 2 n + 1 sites on a line through center, site k is center + (k - n) * step in the first step.size() dimensions
+    std::vector<BERN::SiteVector> line(const BERN::SiteVector& center, int n, const std::vector<double>& step) {
+        std::vector<BERN::SiteVector> res;
+        for (int k = -n; k <= n; ++k) {
+            BERN::SiteVector site = center;
+            for (size_t d = 0; d < step.size(); ++d)
+                site[d] += k * step[d];
+            res.push_back(site);
+        }
+        return res;
+    }
+
+    ///@brief A copy of sites with the last site one dimension short, to test the schema checks
+    std::vector<BERN::SiteVector> truncated(std::vector<BERN::SiteVector> sites) {
+        sites.back().pop_back();
+        return sites;
+    }
+}
+
+#define CHECK(cond) test::check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_CLOSE(a, b, tolerance) test::check(std::abs((a) - (b)) <= (tolerance), #a " == " #b, __FILE__, __LINE__)
+#define CHECK_THROWS(expr, error) do { \
+        bool thrown = false; \
+        try { expr; } catch (const error&) { thrown = true; } \
+        test::check(thrown, #expr " throws " #error, __FILE__, __LINE__); \
+    } while (false)
+
+#endif // BERN_test_h__
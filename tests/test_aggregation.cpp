@@ -0,0 +1,104 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the aggregation operators against plain loops over the species possibilities, the
+// standard operator against the gamma loop of the former Community::possibility
+
+#include "test.h"
+#include <functional>
+
+using namespace BERN;
+
+///The loop of the former Community::possibility: envelope test and algebraic gamma operator
+double gamma_loop(const Community& comm, const SiteVector& site, double gamma) {
+    if (!comm.envelope().contains(site))
+        return 0;
+    double A = 1, B = 1;
+    for (auto spec: comm.species()) {
+        const double poss = spec->possibility(site);
+        A *= poss;
+        B *= 1 - poss;
+    }
+    return pow(A, gamma) * pow(1 - B, 1 - gamma);
+}
+
+///Aggregates the species possibilities without envelope test and early exit
+double species_loop(const Community& comm, const SiteVector& site, double init,
+                    const std::function<double(double, double)>& combine) {
+    double res = init;
+    for (auto spec: comm.species())
+        res = combine(res, spec->possibility(site));
+    return res;
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const std::vector<const Community*> comms = test::communities(db);
+    const Community* comm = test::possible(comms, 0.5);
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+
+    CHECK(Aggregation() == Aggregation::gamma_operator(0.2));
+    CHECK(Aggregation(AggregationKind::minimum, 0.7) == Aggregation::minimum());
+    CHECK(Aggregation().zero_absorbing() && Aggregation::minimum().zero_absorbing() && Aggregation::product().zero_absorbing());
+    CHECK(!Aggregation::gamma_operator(0).zero_absorbing() && !Aggregation::mean().zero_absorbing());
+
+    // From the optimum of the community out of its envelope
+    const std::vector<SiteVector> sites = test::line(comm->center(), 15, {0.2, 0.6});
+    size_t outside = 0;
+    for (const SiteVector& site: sites) {
+        for (auto c: {comm, comms[1], comms.back()}) {
+            const double standard = c->possibility(site);
+            CHECK_CLOSE(standard, gamma_loop(*c, site, 0.2), 1e-12);
+            CHECK(c->possibility(site, Aggregation()) == standard);
+            for (double gamma: {0.5, 1.0})
+                CHECK_CLOSE(c->possibility(site, Aggregation::gamma_operator(gamma)), gamma_loop(*c, site, gamma), 1e-12);
+            // The algebraic sum and the mean are not 0 outside of the envelope
+            const double sum = 1 - species_loop(*c, site, 1, [](double B, double p) {return B * (1 - p);});
+            CHECK_CLOSE(c->possibility(site, Aggregation::gamma_operator(0)), sum, 1e-12);
+            const double mean = species_loop(*c, site, 0, [](double s, double p) {return s + p;}) / c->size();
+            CHECK_CLOSE(c->possibility(site, Aggregation::mean()), mean, 1e-12);
+            CHECK(c->possibility(site, Aggregation::minimum()) ==
+                  species_loop(*c, site, 1, [](double m, double p) {return std::min(m, p);}));
+            CHECK_CLOSE(c->possibility(site, Aggregation::product()),
+                        species_loop(*c, site, 1, [](double m, double p) {return m * p;}), 1e-12);
+            outside += !c->envelope().contains(site) && mean > 0;
+        }
+    }
+    CHECK(outside > 0);
+
+    // The batch evaluation uses the operator of the query
+    const std::vector<const Community*> some = {comm, comms[1]};
+    for (const Aggregation& aggregation: {Aggregation(), Aggregation::mean(), Aggregation::gamma_operator(0)}) {
+        const std::vector<double> matrix = possibility_matrix(some, sites, aggregation);
+        for (size_t s = 0; s < sites.size(); ++s)
+            for (size_t c = 0; c < some.size(); ++c)
+                CHECK(matrix[s * some.size() + c] == some[c]->possibility(sites[s], aggregation));
+    }
+
+    // The optima of other operators are cached apart from the standard optimum
+    const Possibility standard = comm->optimum();
+    const Possibility minimum = comm->optimum(Aggregation::minimum());
+    CHECK(minimum.value == comm->possibility(minimum.site, Aggregation::minimum()));
+    CHECK(minimum.value >= comm->possibility(comm->center(), Aggregation::minimum()));
+    CHECK(comm->optimum().value == standard.value && comm->optimum().site == standard.site);
+    CHECK(comm->optimum(Aggregation()).value == standard.value);
+    return test::report();
+}
@@ -0,0 +1,74 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the bioindication with relevés listing species more than once
+
+#include "test.h"
+#include "../BERNpp/Bioindication.h"
+#include <set>
+
+using namespace BERN;
+
+///@brief Checks that two indications are identical
+void check_same(const Indication& a, const Indication& b) {
+    CHECK(a.species_count == b.species_count);
+    CHECK(a.estimate.value == b.estimate.value);
+    CHECK(a.estimate.site == b.estimate.site);
+    CHECK(a.feasible.min == b.feasible.min && a.feasible.max == b.feasible.max);
+    CHECK(a.uncertainty.min == b.uncertainty.min && a.uncertainty.max == b.uncertainty.max);
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const Community* comm = nullptr;
+    for (auto c: test::communities(db))
+        if (c->size() > 1 && c->possibility(c->center()) > 0.5)
+            comm = c;
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+
+    // The species of a community, the links of the database may repeat a species
+    const Community::SpeciesVector releve = comm->species();
+    const std::set<const Species*> distinct(releve.begin(), releve.end());
+    const Indication single = indicate(releve);
+    CHECK(single.species_count == distinct.size());
+    CHECK(single.estimate.value > 0);
+    CHECK(single.feasible.contains(single.estimate.site));
+    CHECK(single.uncertainty.contains(single.estimate.site));
+
+    // Species observed twice do not sharpen the joint possibility
+    Community::SpeciesVector twice = releve;
+    twice.push_back(releve.front());
+    twice.insert(twice.begin(), releve.back());
+    check_same(indicate(twice), single);
+    std::vector<int> ids;
+    for (auto spec: twice)
+        ids.push_back(spec->id);
+    check_same(db.indicate(ids), single);
+
+    // The batch gives the same indications, an empty relevé has no estimate
+    const std::vector<Indication> batch = indicate(std::vector<Community::SpeciesVector>{releve, twice, {}});
+    CHECK(batch.size() == 3);
+    check_same(batch[0], single);
+    check_same(batch[1], single);
+    CHECK(std::isnan(batch[2].estimate.value));
+    CHECK_THROWS(indicate(Community::SpeciesVector()), std::runtime_error);
+    return test::report();
+}
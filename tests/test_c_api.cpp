@@ -0,0 +1,130 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Round trip of the C interface (bern5 library) against the C++ library: the same database opened through
+// bern_open gives the same values, failures return -1 with a message
+
+#include "test.h"
+#include "../BERNpp/bern_c.h"
+#include "../BERNpp/Slice.h"
+#include "../BERNpp/Richness.h"
+#include <cstring>
+
+using namespace BERN;
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    CHECK(bern_api_version() == BERN_C_API_VERSION);
+    CHECK(bern_open("BERNdata/missing.tsv", "", "", "") == nullptr);
+    CHECK(std::strstr(bern_last_error(), "missing.tsv") != nullptr);
+    bern_database* handle = bern_open("BERNdata/site_type.tsv", "BERNdata/plant-species.tsv",
+                                      "BERNdata/communities.tsv", "BERNdata/link_plantspecies_to_community.tsv");
+    CHECK(handle != nullptr);
+    if (!handle)
+        return test::report();
+
+    const int dims = bern_dims(handle);
+    CHECK(dims == int(db.type().size()));
+    CHECK(bern_species_count(handle) == int(db.species_ids().size()));
+    CHECK(bern_community_count(handle) == int(db.community_ids().size()));
+    std::vector<int> comm_ids(bern_community_count(handle)), spec_ids(bern_species_count(handle));
+    CHECK(bern_community_ids(handle, comm_ids.data(), int(comm_ids.size())) == int(comm_ids.size()));
+    CHECK(bern_species_ids(handle, spec_ids.data(), int(spec_ids.size())) == int(spec_ids.size()));
+    CHECK(comm_ids == db.community_ids() && spec_ids == db.species_ids());
+
+    // The sites as the row major array of the caller
+    const std::vector<const Community*> comms = test::communities(db);
+    const Community* comm = test::possible(comms, 0.5);
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+    std::vector<SiteVector> sites = test::line(comm->center(), 6, {0.2, 0.5});
+    sites[2][0] = NaN;
+    std::vector<double> flat;
+    for (auto& site: sites)
+        flat.insert(flat.end(), site.begin(), site.end());
+    const int ns = int(sites.size());
+
+    const std::vector<int> some = {comm->id, comms[1]->id, comms.back()->id};
+    std::vector<double> values(ns * some.size());
+    CHECK(bern_community_possibility(handle, some.data(), int(some.size()), flat.data(), ns, values.data()) == 0);
+    const std::vector<int> spec = {comm->species()[0]->id};
+    std::vector<double> spec_values(ns);
+    CHECK(bern_species_possibility(handle, spec.data(), 1, flat.data(), ns, spec_values.data()) == 0);
+    std::vector<int> best(ns);
+    std::vector<double> best_values(ns);
+    CHECK(bern_best_community(handle, nullptr, 0, flat.data(), ns, best.data(), best_values.data()) == 0);
+    for (int s = 0; s < ns; ++s) {
+        for (size_t c = 0; c < some.size(); ++c)
+            CHECK(values[s * some.size() + c] == db.find_community(some[c])->possibility(sites[s]));
+        CHECK(spec_values[s] == comm->species()[0]->possibility(sites[s]));
+        double max = 0;
+        int max_id = 0;
+        for (auto c: comms) {
+            const double p = c->possibility(sites[s]);
+            if (p > max) {
+                max = p;
+                max_id = c->id;
+            }
+        }
+        CHECK(best[s] == max_id && best_values[s] == max);
+    }
+
+    // Feasible species are the richness top lists, with 0 for unused entries
+    const int top = 4;
+    std::vector<int> ids(ns * top), count(ns);
+    std::vector<double> poss(ns * top);
+    CHECK(bern_feasible_species(handle, flat.data(), ns, 0.2, top, ids.data(), poss.data(), count.data()) == 0);
+    const RichnessResult richness = species_richness(db.species_list(db.species_ids()), sites, 0.2, top);
+    for (int i = 0; i < ns * top; ++i)
+        CHECK(ids[i] == std::max(richness.top_ids[i], 0) && poss[i] == richness.top_possibility[i]);
+    CHECK(count == richness.count);
+
+    // Slices, with 0 where no community is possible
+    const SliceAxis x(1, sites.front()[1], sites.back()[1], 9), y(2, sites[0][2] - 2, sites[0][2] + 2, 5);
+    std::vector<double> slice(some.size() * y.steps * x.steps);
+    CHECK(bern_community_slice(handle, some.data(), int(some.size()), flat.data(), int(x.dim), x.min, x.max,
+                               int(x.steps), int(y.dim), y.min, y.max, int(y.steps), slice.data()) == 0);
+    std::vector<const Community*> some_comms;
+    for (int id: some)
+        some_comms.push_back(db.find_community(id));
+    CHECK(slice == community_slice(some_comms, sites[0], x, y));
+    std::vector<int> labels(y.steps * x.steps);
+    CHECK(bern_best_community_slice(handle, nullptr, 0, flat.data(), int(x.dim), x.min, x.max, int(x.steps),
+                                    0, 0, 0, 0, labels.data(), nullptr) == 0);
+    std::vector<int> expected = best_community_slice(comms, sites[0], x);
+    std::replace(expected.begin(), expected.end(), -1, 0);
+    CHECK(std::equal(expected.begin(), expected.end(), labels.begin()));
+
+    // The optimum of a community
+    std::vector<double> optimum(dims);
+    double optimum_value = 0;
+    CHECK(bern_community_optimum(handle, comm->id, optimum.data(), &optimum_value) == 0);
+    CHECK(optimum_value == comm->optimum().value);
+
+    // Failures
+    const int unknown = -12345;
+    CHECK(bern_community_possibility(handle, &unknown, 1, flat.data(), ns, values.data()) == -1);
+    CHECK(std::strstr(bern_last_error(), "-12345") != nullptr);
+    CHECK(bern_species_possibility(handle, &unknown, 1, flat.data(), ns, values.data()) == -1);
+    CHECK(bern_community_slice(handle, nullptr, 0, flat.data(), dims, 0, 1, 3, 0, 0, 0, 0, slice.data()) == -1);
+    CHECK(bern_dims(nullptr) == -1);
+    bern_close(handle);
+    return test::report();
+}
@@ -0,0 +1,89 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the niche calibration against observed relevés
+
+#include "test.h"
+#include "../BERNpp/Calibration.h"
+
+using namespace BERN;
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    // The centers of a few communities as observations of these communities
+    std::vector<Observation> observations;
+    for (auto comm: test::communities(db)) {
+        SiteVector site = comm->center();
+        if (comm->possibility(site) > 0)
+            observations.emplace_back(site, comm->id);
+        if (observations.size() == 5)
+            break;
+    }
+    CHECK(observations.size() == 5);
+    Calibration calibration(db, observations);
+    const Community& observed = db.community(observations[0].community);
+    const int spec_id = observed.species()[0]->id;
+
+    // A change of less than one unit reaches the database and the cached possibilities
+    const auto pess_min = CalibrationParameter::niche(spec_id, 0, NichePoint::pess_min, -1e9, 1e9);
+    const double before = calibration.get(pess_min);
+    const double after = std::min(before + 0.3, db.species(spec_id).opt.min[0]);
+    CHECK(calibration.set({pess_min}, {after}));
+    CHECK(calibration.get(pess_min) == after);
+    CHECK(db.species(spec_id).pess.min[0] == after);
+    for (size_t o = 0; o < calibration.observations(); ++o) {
+        size_t column = 0;
+        for (auto comm: test::communities(db)) {
+            if (comm->id == observed.id)
+                CHECK(calibration.possibility(o, column) == comm->possibility(observations[o].site));
+            ++column;
+        }
+    }
+    CHECK(calibration.set({pess_min}, {before}));
+    CHECK(db.species(spec_id).pess.min[0] == before);
+
+    // The log likelihood is summed up in the order of the observations, independent of the threads
+    const std::vector<const Community*> columns = test::communities(db);
+    double log_likelihood = 0;
+    for (size_t o = 0; o < calibration.observations(); ++o) {
+        double sum = 0, observed_possibility = 0;
+        for (size_t c = 0; c < columns.size(); ++c) {
+            sum += calibration.possibility(o, c) + 1e-6;
+            if (columns[c]->id == observations[o].community)
+                observed_possibility = calibration.possibility(o, c);
+        }
+        log_likelihood += std::log((observed_possibility + 1e-6) / sum);
+    }
+    CHECK(calibration.score().log_likelihood == log_likelihood);
+    CHECK(calibration.score().accuracy > 0);
+
+    // Unknown species and dimensions are rejected without a change
+    const auto unknown = CalibrationParameter::niche(999999, 0, NichePoint::pess_min, 0, 1);
+    const auto beyond = CalibrationParameter::niche(spec_id, db.type().size(), NichePoint::pess_min, 0, 1);
+    CHECK_THROWS(calibration.get(unknown), std::out_of_range);
+    CHECK_THROWS(calibration.set({pess_min, unknown}, {after, 0.5}), std::out_of_range);
+    CHECK_THROWS(calibration.set({beyond}, {0.5}), std::out_of_range);
+    CHECK(db.species(spec_id).pess.min[0] == before);
+
+    // Sites of another schema are rejected by the constructor, not in the parallel update
+    std::vector<Observation> wrong = observations;
+    wrong[0].site.pop_back();
+    CHECK_THROWS(Calibration(db, wrong), SchemaError);
+    return test::report();
+}
@@ -0,0 +1,111 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the cached envelope and evaluation order of communities
+
+#include "test.h"
+#include <algorithm>
+#include <type_traits>
+
+using namespace BERN;
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    CHECK_THROWS(db.species(-42), std::out_of_range);
+    CHECK_THROWS(db.community(-42), std::out_of_range);
+
+    // A community with a site of possibility > 0
+    const Community* comm = nullptr;
+    SiteVector site;
+    for (auto c: test::communities(db)) {
+        site = c->center();
+        if (c->possibility(site) > 0) {
+            comm = c;
+            break;
+        }
+    }
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+    const double before = comm->possibility(site);
+
+    // Moves the pessimum of one species just above the site (less than one unit), the cached envelope must follow
+    const Species& spec = *comm->species()[0];
+    const Species old = spec;
+    SiteVector pessMin = old.pess.min, optMin = old.opt.min, optMax = old.opt.max, pessMax = old.pess.max;
+    pessMin[0] = site[0] + 0.5;
+    optMin[0] = std::max(optMin[0], pessMin[0]);
+    optMax[0] = std::max(optMax[0], optMin[0]);
+    pessMax[0] = std::max(pessMax[0], optMax[0]);
+    db.update_niche(spec.id, pessMin, optMin, optMax, pessMax);
+    CHECK(comm->possibility(site) == 0);
+    CHECK(!comm->envelope().contains(site));
+    CHECK(comm->evaluation_order().size() == comm->size());
+
+    // The same result as a community without cache history
+    Community fresh(-1, "fresh", db.type());
+    for (auto s: comm->species())
+        fresh.add_species(s);
+    const SiteVector shifted = comm->center();
+    CHECK(comm->possibility(shifted) == fresh.possibility(shifted));
+
+    db.update_niche(spec.id, old.pess.min, old.opt.min, old.opt.max, old.pess.max);
+    CHECK(comm->possibility(site) == before);
+
+    // A NaN is a missing value, it does not restrict the species: the site outside of the envelope in the
+    // first dimension has the possibility of a site inside, if the first dimension is missing
+    SiteVector outside = site, missing = site;
+    outside[0] = comm->envelope().max[0] + 0.5;
+    missing[0] = NaN;
+    CHECK(comm->possibility(outside) == 0);
+    CHECK(comm->possibility(missing) >= before);
+    CHECK(comm->envelope().contains(missing));
+
+    // Membership changes go through the database, which keeps the communities of a species up to date
+    static_assert(std::is_const<std::remove_reference<decltype(db.community(0))>::type>::value,
+                  "Communities of a database are changed by link and unlink");
+    const Community* stranger = nullptr;
+    for (auto c: test::communities(db))
+        if (std::find(c->species().begin(), c->species().end(), &spec) == c->species().end())
+            stranger = c;
+    CHECK(stranger != nullptr);
+    if (stranger) {
+        const SiteVector at = stranger->center();
+        db.link(stranger->id, spec.id);
+        const std::vector<int> ids = db.communities_of(spec.id);
+        CHECK(std::find(ids.begin(), ids.end(), stranger->id) != ids.end());
+        SiteVector narrow = old.pess.min;
+        narrow[0] = at[0] + 0.5;
+        db.update_niche(spec.id, narrow, narrow, narrow, narrow);
+        CHECK(stranger->possibility(at) == 0);
+        CHECK(db.unlink(stranger->id, spec.id));
+        Community unlinked(-1, "unlinked", db.type());
+        for (auto s: stranger->species())
+            unlinked.add_species(s);
+        CHECK(stranger->possibility(at) == unlinked.possibility(at));
+        db.update_niche(spec.id, old.pess.min, old.opt.min, old.opt.max, old.pess.max);
+    }
+
+    // A species of another schema is rejected
+    Database other("BERNdata/site_type.tsv");
+    test::load(other);
+    Community mixed(-1, "mixed", db.type());
+    CHECK_THROWS(mixed.add_species(&other.species(spec.id)), std::invalid_argument);
+    return test::report();
+}
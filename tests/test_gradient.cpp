@@ -0,0 +1,106 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the analytic possibility gradients against central finite differences
+
+#include "test.h"
+
+using namespace BERN;
+
+///The possibility of f at site with dimension d moved by delta
+template<typename Function>
+double moved(const Function& f, SiteVector site, size_t d, double delta) {
+    site[d] += delta;
+    return f(site);
+}
+
+///Compares the gradient with central differences in each dimension, where f is smooth. Returns the
+///number of compared non zero derivatives
+template<typename Function>
+size_t check_gradient(const Function& f, const SiteVector& site, const SiteVector& gradient) {
+    const SiteType& type = site.type();
+    size_t compared = 0;
+    for (size_t d = 0; d < type.size(); ++d) {
+        const double h = 1e-6 * (type[d].max - type[d].min), p = f(site);
+        const double forward = (moved(f, site, d, h) - p) / h, backward = (p - moved(f, site, d, -h)) / h;
+        // At the kinks of the niches the analytic gradient is one of the one sided derivatives
+        if (std::abs(forward - backward) > 1e-4 * std::max(1.0, std::abs(forward)))
+            continue;
+        CHECK_CLOSE(gradient[d], 0.5 * (forward + backward), 1e-5 * std::max(1.0, std::abs(forward)));
+        compared += gradient[d] != 0;
+    }
+    return compared;
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const std::vector<const Community*> comms = test::communities(db);
+    const Community* comm = test::possible(comms, 0.5);
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+
+    // From the optimum of the community through its slopes to sites where it is not possible
+    const std::vector<SiteVector> sites = test::line(comm->center(), 20, {0.13, 0.37, 0.29});
+    size_t compared = 0, outside = 0;
+    for (const SiteVector& site: sites) {
+        for (auto c: {comm, comms[1], comms.back()}) {
+            const PossibilityGradient pg = c->possibility_with_gradient(site);
+            CHECK(pg.value == c->possibility(site));
+            compared += check_gradient([c](const SiteVector& s) {return c->possibility(s);}, site, pg.gradient);
+            if (!(pg.value > 0)) {
+                ++outside;
+                CHECK(std::all_of(pg.gradient.begin(), pg.gradient.end(), [](double g) {return g == 0;}));
+            }
+        }
+        for (auto spec: comm->species()) {
+            const PossibilityGradient pg = spec->possibility_with_gradient(site);
+            CHECK(pg.value == spec->possibility(site));
+            compared += check_gradient([spec](const SiteVector& s) {return spec->possibility(s);}, site, pg.gradient);
+        }
+    }
+    CHECK(compared > 0 && outside > 0);
+
+    // A missing value has no gradient
+    SiteVector missing = comm->center();
+    missing[0] = NaN;
+    CHECK(comm->possibility_with_gradient(missing).gradient[0] == 0);
+
+    // The matrix holds the gradients of each community, NaN for communities without species
+    Community empty(-1, "empty", db.type());
+    const std::vector<const Community*> matrix_comms = {comm, &empty, comms[1]};
+    const GradientMatrix matrix = possibility_gradient_matrix(matrix_comms, sites);
+    const size_t dims = db.type().size();
+    CHECK(matrix.sites == sites.size() && matrix.communities == matrix_comms.size());
+    CHECK(matrix.gradients.size() == sites.size() * matrix_comms.size() * dims);
+    for (size_t s = 0; s < sites.size(); ++s) {
+        for (size_t c = 0; c < matrix_comms.size(); ++c) {
+            const size_t i = s * matrix_comms.size() + c;
+            if (!matrix_comms[c]->size()) {
+                CHECK(std::isnan(matrix.values[i]) && std::isnan(matrix.gradients[i * dims]));
+                continue;
+            }
+            const PossibilityGradient pg = matrix_comms[c]->possibility_with_gradient(sites[s]);
+            CHECK(matrix.values[i] == pg.value);
+            CHECK(std::equal(pg.gradient.begin(), pg.gradient.end(), matrix.gradients.begin() + i * dims));
+        }
+    }
+    CHECK_THROWS(possibility_gradient_matrix(matrix_comms, test::truncated(sites)), SchemaError);
+    return test::report();
+}
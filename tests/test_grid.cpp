@@ -0,0 +1,102 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the adaptive raster evaluation: the best community of each cell equals the first
+// community with the highest possibility, also where communities tie and no block can be pruned
+
+#include "test.h"
+#include "../BERNpp/Grid.h"
+
+using namespace BERN;
+
+///The id of the first community with the highest possibility > 0 at site, -1 if none
+static int first_best(const std::vector<const Community*>& comms, const SiteVector& site, double& max) {
+    int best = -1;
+    max = 0;
+    for (auto comm: comms) {
+        const double p = comm->possibility(site);
+        if (p > max) {
+            max = p;
+            best = comm->id;
+        }
+    }
+    return best;
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const double threshold = 0.5, tolerance = 0.05;
+    const Community* comm = test::possible(test::communities(db), threshold);
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+
+    // A twin with the same species ties with the community everywhere
+    Community twin(-7, "twin", db.type());
+    for (auto s: comm->species())
+        twin.add_species(s);
+
+    // A raster of rows of the same line across the optimum of the community
+    const int n = 12;
+    const size_t rows = 2 * n + 1, cols = 2 * n + 1;
+    std::vector<SiteVector> cells;
+    for (const SiteVector& start: test::line(comm->center(), n, {0, 0.5})) {
+        const std::vector<SiteVector> row = test::line(start, n, {0.05});
+        cells.insert(cells.end(), row.begin(), row.end());
+    }
+
+    for (const auto& comms: {std::vector<const Community*>{comm, &twin}, std::vector<const Community*>{&twin, comm}}) {
+        const GridResult res = adaptive_grid(comms, cells, rows, cols, threshold, tolerance);
+        // Tied communities bound each other, hence no possible block is filled and the first one wins
+        size_t possible = 0;
+        for (size_t i = 0; i < cells.size(); ++i) {
+            double max;
+            const int best = first_best(comms, cells[i], max);
+            possible += max > 0;
+            CHECK(res.best[i] == best);
+            CHECK(best < 0 || best == comms[0]->id);
+            CHECK(res.value[i] == max);
+            CHECK(res.present[i] == (max >= threshold));
+        }
+        CHECK(possible > 0);
+        CHECK(res.evaluations >= 2 * possible);
+    }
+
+    // Without the twin blocks are pruned and filled, the best community stays exact and the value within
+    // the tolerance. A cell with a missing value is evaluated on its own
+    std::vector<const Community*> comms = test::communities(db);
+    cells[cols + 1][0] = NaN;
+    const GridResult res = adaptive_grid(comms, cells, rows, cols, threshold, tolerance);
+    CHECK(res.filled_cells > 0);
+    for (size_t i = 0; i < cells.size(); ++i) {
+        double max;
+        const int best = first_best(comms, cells[i], max);
+        if (res.best[i] < 0) {
+            CHECK(best < 0);
+        } else {
+            CHECK(db.community(res.best[i]).possibility(cells[i]) == max);
+            CHECK_CLOSE(res.value[i], max, 0.5 * tolerance);
+        }
+        CHECK(res.present[i] == (max >= threshold));
+    }
+
+    CHECK_THROWS(adaptive_grid(comms, cells, rows, cols - 1), std::invalid_argument);
+    CHECK_THROWS(adaptive_grid(comms, test::truncated(cells), rows, cols), SchemaError);
+    return test::report();
+}
@@ -0,0 +1,159 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the indicator means against the weighted means of every species at every site, with
+// missing indicator values and sites without any weighted species
+
+#include "test.h"
+#include "../BERNpp/Indicators.h"
+#include <fstream>
+
+using namespace BERN;
+
+///@brief Checks a mean of indicator_means against the weighted sum and the weight of a naive loop
+void check_mean(const IndicatorMeans& res, size_t i, size_t c, double sum, double weight) {
+    const double mean = res.mean[i * res.columns + c];
+    CHECK_CLOSE(res.weight[i * res.columns + c], weight, 1e-9 * std::max(1.0, weight));
+    if (weight > 0)
+        CHECK_CLOSE(mean, sum / weight, 1e-9 * std::max(1.0, std::abs(mean)));
+    else
+        CHECK(std::isnan(mean));
+}
+
+int main(int argc, char* argv[]) {
+    const std::string dir = argc > 1 ? std::string(argv[1]) + "/" : std::string();
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const std::vector<const Community*> comms = test::communities(db);
+
+    // Two species possible at the center of a community
+    const Community* comm = nullptr;
+    std::vector<const Species*> pair;
+    for (auto c: comms) {
+        pair.clear();
+        for (auto spec: c->species())
+            if (spec->possibility(c->center()) > 0 && pair.size() < 2)
+                pair.push_back(spec);
+        if (pair.size() == 2) {
+            comm = c;
+            break;
+        }
+    }
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+    const Species& a = *pair[0];
+    const Species& b = *pair[1];
+    const std::vector<SiteVector> center = {comm->center()};
+    const double pa = a.possibility(center[0]), pb = b.possibility(center[0]);
+
+    // Indifferent (-1), empty, non numeric and trailing values are missing, repeated species and lines
+    // without a species id are skipped
+    const std::string filename = dir + "test_indicators.tsv";
+    {
+        std::ofstream out(filename);
+        out << "id\tname\tL\tT\tN\r\n";
+        out << a.id << "\ta\t5\t-1\tx\r\n";
+        out << b.id << "\tb\t3\t\t2\r\n";
+        out << a.id << "\ta again\t1\t1\t1\r\n";
+        out << "-\tno id\t1\t1\t1\r\n";
+        out << 0 << "\tshort\t4\r\n";
+    }
+    IndicatorTable table;
+    CHECK(table.load(filename) == 3);
+    CHECK(table.columns() == 3 && table.names()[2] == "N" && table.column("T") == 1);
+    CHECK_THROWS(table.column("R"), std::out_of_range);
+    CHECK_THROWS(table.value(a.id, 3), std::out_of_range);
+    CHECK(table.row(-1) == -1 && std::isnan(table.value(-1, 0)));
+    CHECK(table.value(a.id, 0) == 5 && std::isnan(table.value(a.id, 1)) && std::isnan(table.value(a.id, 2)));
+    CHECK(std::isnan(table.value(b.id, 1)) && table.value(b.id, 2) == 2);
+    CHECK(table.value(0, 0) == 4 && std::isnan(table.value(0, 1)) && std::isnan(table.value(0, 2)));
+
+    // Missing values drop out of the mean and its weight, a column without values has no mean
+    const IndicatorMeans means = indicator_means(table, pair, center);
+    check_mean(means, 0, 0, pa * 5 + pb * 3, pa + pb);
+    check_mean(means, 0, 1, 0, 0);
+    check_mean(means, 0, 2, pb * 2, pb);
+    // Species below the threshold and species without a row are not weighted
+    const Species unlisted(-5, "unlisted", a.pess.min, a.opt.min, a.opt.max, a.pess.max);
+    const double threshold = std::min(pa, pb);
+    const IndicatorMeans above = indicator_means(table, {&a, &b, &unlisted}, center, threshold);
+    for (size_t c = 0; c < 3; ++c) {
+        double sum = 0, weight = 0;
+        for (auto spec: pair) {
+            const double p = spec->possibility(center[0]), value = table.value(spec->id, c);
+            if (p > threshold && !std::isnan(value)) {
+                sum += p * value;
+                weight += p;
+            }
+        }
+        check_mean(above, 0, c, sum, weight);
+    }
+    const IndicatorMeans none = indicator_means(table, pair, center, 1);
+    for (size_t c = 0; c < 3; ++c)
+        check_mean(none, 0, c, 0, 0);
+
+    // A species of two possible communities counts for each
+    Community both(-1, "both", db.type()), only(-2, "only", db.type());
+    both.add_species(&a);
+    both.add_species(&b);
+    only.add_species(&a);
+    const double p_both = both.possibility(center[0]), p_only = only.possibility(center[0]);
+    CHECK(p_both > 0 && p_only > 0);
+    const IndicatorMeans comm_means = community_indicator_means(table, {&both, &only}, center);
+    check_mean(comm_means, 0, 0, p_both * 8 + p_only * 5, 2 * p_both + p_only);
+    check_mean(comm_means, 0, 1, 0, 0);
+    check_mean(comm_means, 0, 2, p_both * 2, p_both);
+
+    // The shipped table against the naive loop, on a line with a site missing pH
+    CHECK(table.load("BERNdata/species_ellenberg.tsv") > 0);
+    const std::vector<const Species*> species = db.species_list(db.species_ids());
+    std::vector<SiteVector> sites = test::line(center[0], 5, {0.2, 0.6});
+    sites[3][0] = NaN;
+    const IndicatorMeans res = indicator_means(table, species, sites, 0.1);
+    const IndicatorMeans comm_res = community_indicator_means(table, comms, sites);
+    for (size_t i = 0; i < sites.size(); ++i) {
+        for (size_t c = 0; c < table.columns(); ++c) {
+            double sum = 0, weight = 0;
+            for (const Species* spec: species) {
+                const double p = spec->possibility(sites[i]), value = table.value(spec->id, c);
+                if (p > 0.1 && !std::isnan(value)) {
+                    sum += p * value;
+                    weight += p;
+                }
+            }
+            check_mean(res, i, c, sum, weight);
+            sum = weight = 0;
+            for (const Community* other: comms) {
+                const double p = other->possibility(sites[i]);
+                for (const Species* spec: other->species()) {
+                    const double value = table.value(spec->id, c);
+                    if (p > 0 && !std::isnan(value)) {
+                        sum += p * value;
+                        weight += p;
+                    }
+                }
+            }
+            check_mean(comm_res, i, c, sum, weight);
+        }
+    }
+
+    CHECK_THROWS(indicator_means(table, species, test::truncated(sites), 0.1), SchemaError);
+    CHECK_THROWS(community_indicator_means(table, comms, test::truncated(sites)), SchemaError);
+    return test::report();
+}
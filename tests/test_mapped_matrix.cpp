@@ -0,0 +1,130 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the memory mapped possibility matrices against Community::possibility and of the
+// conversions at the boundaries of the element types
+
+#include "test.h"
+#include "../BERNpp/MappedMatrix.h"
+#include <algorithm>
+#include <fstream>
+
+using namespace BERN;
+
+///Checks the quantization and half precision conversion at their boundaries
+static void check_conversions() {
+    const double half_step = 0.5 / 254;
+    CHECK(MappedMatrix::quantize(0) == 0 && MappedMatrix::quantize(1) == 254);
+    CHECK(MappedMatrix::quantize(-0.2) == 0 && MappedMatrix::quantize(1.5) == 254);
+    CHECK(MappedMatrix::quantize(NaN) == 255 && MappedMatrix::quantize(INFINITY) == 254);
+    CHECK(MappedMatrix::quantize(0.999 * half_step) == 0 && MappedMatrix::quantize(1.001 * half_step) == 1);
+    CHECK(MappedMatrix::quantize(1 - 0.999 * half_step) == 254 && MappedMatrix::quantize(1 - 1.001 * half_step) == 253);
+
+    CHECK(MappedMatrix::to_float16(0.0) == 0 && MappedMatrix::to_float16(-0.0) == 0x8000);
+    CHECK(MappedMatrix::to_float16(1.0) == 0x3c00 && MappedMatrix::to_float16(-2.0) == 0xc000);
+    CHECK(MappedMatrix::to_float16(65504) == 0x7bff && MappedMatrix::to_float16(65520) == 0x7c00);
+    CHECK(MappedMatrix::to_float16(INFINITY) == 0x7c00 && MappedMatrix::to_float16(1e300) == 0x7c00);
+    CHECK(std::isnan(MappedMatrix::from_float16(MappedMatrix::to_float16(NaN))));
+    // Ties round to the even neighbour, in the normal and the subnormal range
+    CHECK(MappedMatrix::to_float16(1 + std::ldexp(1, -11)) == 0x3c00);
+    CHECK(MappedMatrix::to_float16(1 + 3 * std::ldexp(1, -11)) == 0x3c02);
+    CHECK(MappedMatrix::to_float16(std::ldexp(1, -24)) == 1 && MappedMatrix::to_float16(std::ldexp(1, -25)) == 0);
+    CHECK(MappedMatrix::to_float16(3 * std::ldexp(1, -25)) == 2);
+    // The largest subnormal rounds up into the smallest normal number
+    CHECK(MappedMatrix::to_float16(std::ldexp(1, -14) - std::ldexp(1, -26)) == 0x0400);
+    // Every half precision number converts back to itself
+    for (uint32_t bits = 0; bits < 0x10000; ++bits) {
+        const float value = MappedMatrix::from_float16(uint16_t(bits));
+        if (!std::isnan(value))
+            CHECK(MappedMatrix::to_float16(value) == bits);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const std::string dir = argc > 1 ? std::string(argv[1]) + "/" : std::string();
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    check_conversions();
+    std::vector<const Community*> comms = test::communities(db);
+    // A community possible at its center first, the matrix has 40 columns with the empty one
+    const Community* possible = test::possible(comms);
+    CHECK(possible != nullptr);
+    if (!possible)
+        return test::report();
+    std::swap(comms[0], *std::find(comms.begin(), comms.end(), possible));
+    comms.resize(std::min<size_t>(comms.size(), 39));
+    // A community without species results in NaN
+    Community empty(-1, "empty", db.type());
+    comms.push_back(&empty);
+
+    // Possibilities from 0 to 1 across the community, one site missing pH
+    std::vector<SiteVector> sites = test::line(possible->center(), 12, {0.1, 0.3});
+    sites[4][0] = NaN;
+    const std::vector<SiteVector> first(sites.begin(), sites.begin() + 10), second(sites.begin() + 10, sites.end());
+
+    const MatrixType types[] = {MatrixType::float64, MatrixType::float32, MatrixType::float16, MatrixType::uint8};
+    for (MatrixType type: types) {
+        const std::string filename = dir + "test_mapped_matrix.npy";
+        const MatrixLayout layout = type == MatrixType::float64 ? MatrixLayout::raw : MatrixLayout::npy;
+        MappedMatrix out(filename, sites.size(), comms.size(), type, layout);
+        CHECK(layout == MatrixLayout::raw ? out.header_size() == 0 : out.header_size() % 64 == 0);
+        // Written in two chunks
+        possibility_matrix(comms, first, out, 0);
+        possibility_matrix(comms, second, out, first.size());
+        size_t found = 0;
+        std::vector<double> expected;
+        for (size_t s = 0; s < sites.size(); ++s) {
+            for (size_t c = 0; c < comms.size(); ++c) {
+                const double p = comms[c]->size() ? comms[c]->possibility(sites[s]) : NaN;
+                const double value = out.get(s, c);
+                found += p > 0;
+                expected.push_back(p);
+                if (std::isnan(p)) {
+                    CHECK(std::isnan(value));
+                    continue;
+                }
+                switch (type) {
+                    case MatrixType::float64: CHECK(value == p); break;
+                    case MatrixType::float32: CHECK(value == float(p)); break;
+                    case MatrixType::float16: CHECK_CLOSE(value, p, 1.0 / 2048); break;
+                    case MatrixType::uint8: CHECK_CLOSE(value, p, 0.5 / 254); break;
+                }
+            }
+        }
+        CHECK(found > 0);
+        out.close();
+
+        // The file holds the header and the values
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        CHECK(size_t(file.tellg()) == out.header_size() + sites.size() * comms.size() * out.element_size());
+        if (type == MatrixType::float64) {
+            std::vector<double> values(expected.size());
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(double));
+            for (size_t i = 0; i < values.size(); ++i)
+                CHECK(values[i] == expected[i] || (std::isnan(values[i]) && std::isnan(expected[i])));
+        }
+    }
+
+    // Sites of another schema and a wrong shape are rejected before the parallel evaluation
+    MappedMatrix out(dir + "test_mapped_matrix.npy", sites.size(), comms.size());
+    CHECK_THROWS(possibility_matrix(comms, test::truncated(sites), out), SchemaError);
+    CHECK_THROWS(possibility_matrix(comms, sites, out, 1), std::out_of_range);
+    CHECK_THROWS(possibility_matrix({comms[0]}, sites, out), std::invalid_argument);
+    return test::report();
+}
@@ -0,0 +1,98 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the name resolution: normalization, priorities of names over synonyms and
+// ambiguous synonyms
+
+#include "test.h"
+#include "../BERNpp/Names.h"
+#include <fstream>
+
+using namespace BERN;
+
+int main(int argc, char* argv[]) {
+    const std::string dir = argc > 1 ? std::string(argv[1]) + "/" : std::string();
+
+    CHECK(NameIndex::normalize("  Lolium   PERENNE L. ") == "lolium perenne l.");
+    CHECK(NameIndex::normalize("Festuca perennis (L.) Columbus & J.P.Sm.", true) == "festuca perennis");
+    CHECK(NameIndex::normalize("Mentha \xC3\x97piperita L.", true) == "mentha x piperita");
+    CHECK(NameIndex::normalize("Festuca ovina ssp. guestfalica (Boenn. ex Rchb.) K.Richt.", true) ==
+          "festuca ovina subsp. guestfalica");
+    CHECK(NameIndex::normalize("Rubus fruticosus agg. L.", true) == "rubus fruticosus agg.");
+    CHECK(NameIndex::normalize("", true).empty());
+
+    // A higher priority replaces a name, the same priority with another id makes it ambiguous until a
+    // higher priority resolves it
+    NameIndex index;
+    index.insert("a", 1, 0);
+    index.insert("a", 2, 0);
+    CHECK(index.find("a") == -1);
+    index.insert("a", 3, 1);
+    CHECK(index.find("a") == 3);
+    index.insert("a", 4, 0);
+    index.insert("a", 3, 1);
+    CHECK(index.find("a") == 3);
+    index.insert("", 5, 1);
+    index.insert("b", 5, -1);
+    CHECK(index.size() == 1 && index.find("b") == -1 && index.find("") == -1);
+    CHECK(NameIndex().find("a") == -1);
+    // Growing the table keeps all names
+    for (int i = 0; i < 1000; ++i)
+        index.insert("name " + std::to_string(i), i, 0);
+    CHECK(index.size() == 1001);
+    bool all = index.find("a") == 3;
+    for (int i = 0; i < 1000; ++i)
+        all &= index.find("name " + std::to_string(i)) == i;
+    CHECK(all);
+
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const std::vector<int> ids = db.species_ids();
+    CHECK(ids.size() > 2);
+    if (ids.size() < 3)
+        return test::report();
+    const Species& a = db.species(ids[0]);
+    const Species& b = db.species(ids[1]);
+    const Species& c = db.species(ids[2]);
+    // The name of a is a synonym of b, a synonym is shared by b and c, and a synonym belongs to c alone
+    const std::string filename = dir + "test_names_synonyms.tsv";
+    {
+        std::ofstream out(filename);
+        out << "species_ID\tspecies_name\tspecies_ID_copy\tspecies_name_synonym\r\n";
+        out << b.id << "\t" << b.name << "\t" << b.id << "\t" << a.name << "\r\n";
+        out << b.id << "\t" << b.name << "\t" << b.id << "\tShared synonymus Auth.\r\n";
+        out << c.id << "\t" << c.name << "\t" << c.id << "\tShared synonymus Other\r\n";
+        out << c.id << "\t" << c.name << "\t" << c.id << "\tOnly synonymus\r\n";
+        out << "-1\tunknown species\t-1\tUnknown synonymus\r\n";
+    }
+    CHECK(db.load_synonyms(filename) == 4);
+
+    const NameResolution res = db.resolve_names({a.name, "Shared synonymus", "ONLY  synonymus", "only synonymus X.",
+                                                 "Unknown synonymus", "", b.name});
+    CHECK(res.ids.size() == 7);
+    CHECK(res.ids[0] == a.id);
+    CHECK(res.ids[1] == -1);
+    CHECK(res.ids[2] == c.id && res.ids[3] == c.id);
+    CHECK(res.ids[4] == -1 && res.ids[5] == -1);
+    CHECK(res.ids[6] == b.id);
+    CHECK((res.unresolved == std::vector<size_t>{1, 4, 5}));
+    // Without stripping the authors only exact names match
+    CHECK(db.resolve("only synonymus X.", false) == -1);
+    CHECK(db.resolve("Only synonymus", false) == c.id);
+    return test::report();
+}
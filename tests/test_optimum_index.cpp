@@ -0,0 +1,94 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the k-d tree of the community optima against a scan over all optima
+
+#include "test.h"
+#include "../BERNpp/OptimumIndex.h"
+#include <algorithm>
+
+using namespace BERN;
+
+///@brief All indexed communities sorted by the distance of their optimum to site, missing values ignored
+NeighborVector scan(const std::vector<const Community*>& comms, const SiteVector& site) {
+    const SiteVector query = OptimumIndex::normalize(site);
+    NeighborVector res;
+    for (auto comm: comms) {
+        if (!comm->size() || !(comm->optimum().value > 0))
+            continue;
+        const SiteVector p = OptimumIndex::normalize(comm->optimum().site);
+        double dist2 = 0;
+        for (size_t d = 0; d < p.size(); ++d)
+            if (!std::isnan(query[d]))
+                dist2 += (query[d] - p[d]) * (query[d] - p[d]);
+        res.emplace_back(comm->id, dist2);
+    }
+    std::sort(res.begin(), res.end());
+    for (auto& n: res)
+        n.distance = std::sqrt(n.distance);
+    return res;
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    std::vector<const Community*> comms = test::communities(db);
+    comms.resize(std::min<size_t>(comms.size(), 150));
+    const OptimumIndex index(comms);
+    CHECK(index.size() > 0);
+
+    // Queries at the optima (distance 0), steps of less than one unit beside them and with missing values
+    std::vector<SiteVector> queries;
+    for (size_t c = 0; c < comms.size(); c += 10) {
+        const SiteVector opt = comms[c]->optimum().site;
+        queries.push_back(opt);
+        for (const SiteVector& site: test::line(opt, 1, {0.3, 0.7}))
+            queries.push_back(site);
+        SiteVector missing = opt;
+        missing[0] = NaN;
+        missing[3] = NaN;
+        queries.push_back(missing);
+    }
+    const size_t k = 5;
+    const double radius = 0.1;
+    const std::vector<NeighborVector> nearest = index.nearest(queries, k), within = index.within(queries, radius);
+    for (size_t q = 0; q < queries.size(); ++q) {
+        const NeighborVector all = scan(comms, queries[q]);
+        CHECK(nearest[q].size() == std::min(k, all.size()));
+        for (size_t i = 0; i < nearest[q].size(); ++i) {
+            CHECK(nearest[q][i].id == all[i].id);
+            CHECK_CLOSE(nearest[q][i].distance, all[i].distance, 1e-12);
+        }
+        size_t inside = 0;
+        while (inside < all.size() && all[inside].distance <= radius)
+            ++inside;
+        CHECK(within[q].size() == inside);
+        for (size_t i = 0; i < std::min(inside, within[q].size()); ++i)
+            CHECK(within[q][i].id == all[i].id);
+    }
+
+    // An empty index finds nothing, sites of another schema are rejected
+    const OptimumIndex empty;
+    CHECK(empty.nearest(queries[0], k).empty());
+    CHECK(empty.within(queries[0], radius).empty());
+    SiteVector wrong = queries[0];
+    wrong.pop_back();
+    CHECK_THROWS(index.nearest(wrong, k), SchemaError);
+    CHECK_THROWS(index.within({queries[0], wrong}, radius), SchemaError);
+    return test::report();
+}
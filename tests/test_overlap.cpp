@@ -0,0 +1,124 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the envelope overlaps against the test of every pair, including touching envelopes
+// with an overlap volume of 0
+
+#include "test.h"
+#include "../BERNpp/Overlap.h"
+
+using namespace BERN;
+
+///@brief The overlap volume of two communities by the intersection of their envelopes, -1 if disjoint
+double pair_volume(const Community& a, const Community& b) {
+    if (!a.size() || !b.size())
+        return -1;
+    const SiteRange ea = a.envelope(), eb = b.envelope();
+    const SiteType& type = a.type();
+    double volume = 1;
+    for (size_t d = 0; d < type.size(); ++d) {
+        if (!(ea.min[d] <= ea.max[d]) || !(eb.min[d] <= eb.max[d]))
+            return -1;
+        const double width = std::min(ea.max[d], eb.max[d]) - std::max(ea.min[d], eb.min[d]);
+        if (width < 0)
+            return -1;
+        volume *= width / (type[d].max - type[d].min);
+    }
+    return volume;
+}
+
+///@brief Checks the overlaps of envelope_overlap against pair_volume of every pair
+void check_pairs(const std::vector<const Community*>& comms) {
+    const OverlapMatrix overlap = envelope_overlap(comms);
+    CHECK(overlap.communities == comms.size());
+    size_t k = 0;
+    for (size_t a = 0; a < comms.size(); ++a) {
+        for (size_t b = a + 1; b < comms.size(); ++b) {
+            const double volume = pair_volume(*comms[a], *comms[b]);
+            if (volume < 0)
+                continue;
+            CHECK(k < overlap.size() && overlap.rows[k] == a && overlap.cols[k] == b);
+            if (k < overlap.size())
+                CHECK_CLOSE(overlap.volume[k], volume, 1e-12 * std::max(1.0, volume));
+            ++k;
+        }
+    }
+    CHECK(k == overlap.size());
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const std::vector<const Community*> comms = test::communities(db);
+    check_pairs(comms);
+
+    // Single species communities with a bounded niche, shifted in the first dimension to end less than one
+    // unit before, exactly at (touching) or less than one unit behind the start of the niche of the first
+    const SiteType& type = db.type();
+    const Species* found = nullptr;
+    for (int id: db.species_ids()) {
+        const Species& s = db.species(id);
+        bool valid = s.pess.max[0] - s.pess.min[0] > 1;
+        for (size_t d = 0; d < type.size(); ++d)
+            valid &= s.pess.min[d] <= s.pess.max[d];
+        if (valid) {
+            found = &s;
+            break;
+        }
+    }
+    CHECK(found != nullptr);
+    if (!found)
+        return test::report();
+    const Species& spec = *found;
+    const double width = spec.pess.max[0] - spec.pess.min[0];
+    std::vector<Species> shifted;
+    for (double delta: {width + 0.5, width, width - 0.5}) {
+        SiteVector pessMin = spec.pess.min, optMin = spec.opt.min, optMax = spec.opt.max, pessMax = spec.pess.max;
+        for (SiteVector* v: {&pessMin, &optMin, &optMax, &pessMax})
+            (*v)[0] += delta;
+        if (delta == width)
+            pessMin[0] = spec.pess.max[0];
+        shifted.emplace_back(-1, "shifted", pessMin, optMin, optMax, pessMax);
+    }
+    Community a(-1, "a", type), apart(-2, "apart", type), touching(-3, "touching", type),
+              overlapping(-4, "overlapping", type), twin(-5, "twin", type);
+    a.add_species(&spec);
+    apart.add_species(&shifted[0]);
+    touching.add_species(&shifted[1]);
+    overlapping.add_species(&shifted[2]);
+    twin.add_species(&spec);
+    const std::vector<const Community*> pairs = {&a, &apart, &touching, &overlapping, &twin};
+    check_pairs(pairs);
+    const OverlapMatrix overlap = envelope_overlap(pairs);
+    // a is disjoint of apart, touches touching with a volume of 0, overlaps overlapping by 0.5 in the first
+    // dimension and its twin completely
+    std::vector<double> volume(pairs.size(), -1);
+    for (size_t k = 0; k < overlap.size(); ++k)
+        if (overlap.rows[k] == 0)
+            volume[overlap.cols[k]] = overlap.volume[k];
+    CHECK(volume[1] == -1);
+    CHECK(volume[2] == 0);
+    CHECK_CLOSE(volume[3] * width / 0.5, pair_volume(a, a), 1e-12);
+    CHECK(volume[4] == pair_volume(a, a));
+
+    SiteType short_type = type;
+    short_type.pop_back();
+    Community wrong(-6, "wrong", short_type);
+    CHECK_THROWS(envelope_overlap({&a, &wrong}), SchemaError);
+    return test::report();
+}
@@ -0,0 +1,119 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the species richness against the evaluation of every species at every site, with
+// ties of the top species, less feasible species than top places and possibilities equal to the threshold
+
+#include "test.h"
+#include "../BERNpp/Richness.h"
+#include <algorithm>
+
+using namespace BERN;
+
+///Checks species_richness against the possibility of every species at every site
+static void check_richness(const std::vector<const Species*>& species, const std::vector<SiteVector>& sites,
+                           double threshold, size_t top) {
+    const RichnessResult res = species_richness(species, sites, threshold, top);
+    CHECK(res.sites == sites.size() && res.top == top && res.threshold == threshold);
+    for (size_t i = 0; i < sites.size(); ++i) {
+        int count = 0;
+        double sum = 0;
+        // Sorted by decreasing possibility and increasing id
+        std::vector<std::pair<double, int>> feasible;
+        for (const Species* spec: species) {
+            const double poss = spec->possibility(sites[i]);
+            if (poss > threshold) {
+                ++count;
+                sum += poss;
+                feasible.emplace_back(-poss, spec->id);
+            }
+        }
+        std::sort(feasible.begin(), feasible.end());
+        CHECK(res.count[i] == count);
+        CHECK_CLOSE(res.sum[i], sum, 1e-9);
+        for (size_t k = 0; k < top; ++k) {
+            if (k < feasible.size()) {
+                CHECK(res.top_ids[i * top + k] == feasible[k].second);
+                CHECK(res.top_possibility[i * top + k] == -feasible[k].first);
+            } else {
+                CHECK(res.top_ids[i * top + k] == -1);
+                CHECK(res.top_possibility[i * top + k] == 0);
+            }
+        }
+    }
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const std::vector<const Species*> species = db.species_list(db.species_ids());
+
+    // A species with a bounded optimum and its twins with higher ids, listed before it
+    const Species* spec = nullptr;
+    for (auto s: species) {
+        bool bounded = true;
+        for (size_t d = 0; d < db.type().size(); ++d)
+            bounded &= std::isfinite(s->opt.min[d]) && std::isfinite(s->opt.max[d]) && s->pess.min[d] < s->opt.min[d];
+        if (bounded) {
+            spec = s;
+            break;
+        }
+    }
+    CHECK(spec != nullptr);
+    if (!spec)
+        return test::report();
+    const std::vector<int> ids = db.species_ids();
+    const int max_id = *std::max_element(ids.begin(), ids.end());
+    const Species later(max_id + 2, "later", spec->pess.min, spec->opt.min, spec->opt.max, spec->pess.max);
+    const Species twin(max_id + 1, "twin", spec->pess.min, spec->opt.min, spec->opt.max, spec->pess.max);
+    const std::vector<const Species*> tied = {&later, spec, &twin};
+
+    SiteVector optimum = spec->opt.min;
+    for (size_t d = 0; d < optimum.size(); ++d)
+        optimum[d] = 0.5 * (spec->opt.min[d] + spec->opt.max[d]);
+    // From the lower end of the pH optimum through its pessimum, the last sites are not feasible
+    optimum[0] = spec->opt.min[0];
+    const double step = (spec->opt.min[0] - spec->pess.min[0]) / 8;
+    std::vector<SiteVector> sites = test::line(optimum, 10, {step});
+    sites.erase(sites.begin() + 11, sites.end());
+    std::reverse(sites.begin(), sites.end());
+    CHECK(spec->possibility(sites.front()) == 1 && spec->possibility(sites.back()) == 0);
+
+    // Ties by lower id, more top places than feasible species and no top places
+    check_richness(tied, sites, 0, 2);
+    check_richness(tied, sites, 0, 5);
+    check_richness(tied, sites, 0, 0);
+    const RichnessResult res = species_richness(tied, sites, 0, 5);
+    CHECK(res.top_ids[0] == spec->id && res.top_ids[1] == twin.id && res.top_ids[2] == later.id);
+    CHECK(res.top_ids[3] == -1 && res.top_possibility[3] == 0);
+
+    // Possibilities equal to the threshold are not counted
+    const double threshold = spec->possibility(sites[4]);
+    CHECK(threshold > 0 && threshold < 1);
+    check_richness(tied, sites, threshold, 3);
+    const RichnessResult at = species_richness(tied, sites, threshold, 3);
+    CHECK(at.count[3] == 3 && at.count[4] == 0);
+    CHECK(species_richness(tied, sites, 1, 3).count[0] == 0);
+
+    // All species, a site with missing pH counts the species of the other dimensions
+    sites[2][0] = NaN;
+    check_richness(species, sites, 0.2, 5);
+
+    CHECK_THROWS(species_richness(species, test::truncated(sites), 0.2, 5), SchemaError);
+    return test::report();
+}
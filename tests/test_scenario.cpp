@@ -0,0 +1,100 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the paired baseline / scenario evaluation
+
+#include "test.h"
+#include "../BERNpp/Scenario.h"
+#include <algorithm>
+
+using namespace BERN;
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const std::vector<const Community*> comms = test::communities(db);
+    const double threshold = 1e-9;
+
+    // Each changed site crosses the upper envelope bound of a community in the first dimension by 0.4 units,
+    // each second site is unchanged
+    std::vector<SiteVector> baseline, scenario;
+    std::vector<int> crossed;
+    for (size_t c = 0; c < comms.size() && baseline.size() < 40; c += 17) {
+        SiteVector site = comms[c]->center();
+        const SiteRange envelope = comms[c]->envelope();
+        site[0] = std::max(envelope.min[0], envelope.max[0] - 0.2);
+        if (!(comms[c]->possibility(site) > 0))
+            continue;
+        baseline.push_back(site);
+        scenario.push_back(site);
+        crossed.push_back(comms[c]->id);
+        site[0] = envelope.max[0] + 0.2;
+        baseline.push_back(scenario.back());
+        scenario.push_back(site);
+        crossed.push_back(-1);
+    }
+    CHECK(baseline.size() >= 10);
+    const size_t crossings = baseline.size();
+
+    // Pairs only compared exactly: missing in both (unchanged), missing in one (changed) and a change far
+    // below the tolerance of SiteVector::operator== (changed)
+    SiteVector site = baseline[0];
+    site[1] = NaN;
+    baseline.push_back(site);
+    scenario.push_back(site);
+    baseline.push_back(site);
+    scenario.push_back(baseline[0]);
+    baseline.push_back(baseline[0]);
+    scenario.push_back(baseline[0]);
+    scenario.back()[2] += 1e-3 * scenario.back().type()[2].error_tolerance();
+    CHECK(scenario.back() == baseline.back());
+    const ScenarioDiff res = scenario_diff(comms, baseline, scenario, threshold);
+    CHECK(res.evaluated_scenarios == crossings / 2 + 2);
+
+    // The same values as the direct evaluation
+    for (size_t s = 0; s < baseline.size(); ++s) {
+        double base_max = 0, scen_max = 0;
+        for (auto comm: comms) {
+            base_max = std::max(base_max, comm->possibility(baseline[s]));
+            scen_max = std::max(scen_max, comm->possibility(scenario[s]));
+        }
+        CHECK(res.baseline_max[s] == base_max);
+        CHECK(res.delta_max[s] == scen_max - base_max);
+        if (s >= crossings)
+            continue;
+        const std::vector<int> lost(res.lost_ids.begin() + res.lost_offsets[s],
+                                    res.lost_ids.begin() + res.lost_offsets[s + 1]);
+        if (s % 2) {
+            // The community of the shifted site is lost, it has possibility 0 outside of its envelope
+            const int id = crossed[s - 1];
+            CHECK(db.community(id).possibility(scenario[s]) == 0);
+            CHECK(std::find(lost.begin(), lost.end(), id) != lost.end());
+        } else {
+            CHECK(lost.empty());
+            CHECK(res.delta_max[s] == 0);
+        }
+    }
+    // Unchanged sites have no changes, even if they miss a value
+    CHECK(res.changed[crossings] == 0 && res.delta_max[crossings] == 0);
+    CHECK(res.lost_offsets[crossings] == res.lost_offsets[crossings + 1]);
+
+    // A scenario of another schema is rejected before the parallel evaluation
+    CHECK_THROWS(scenario_diff(comms, baseline, test::truncated(scenario), threshold), SchemaError);
+    CHECK_THROWS(scenario_diff(comms, baseline, std::vector<SiteVector>(1, baseline[0]), threshold), std::invalid_argument);
+    return test::report();
+}
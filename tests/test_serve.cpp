@@ -0,0 +1,261 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// End to end test of bern-serve: starts the daemon on a socket in the build directory and compares its
+// answers with the library, also for concurrent clients, failed requests and a broken framing
+
+#include "test.h"
+#include "../BERNpp/Richness.h"
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <chrono>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace BERN;
+
+namespace {
+    // The protocol, see apps/bern_serve.cpp
+#pragma pack(push, 1)
+    struct RequestHeader {
+        uint32_t magic = 0x4E524542;
+        uint16_t version = 1;
+        uint16_t query = 0;
+        uint32_t n_sites = 0;
+        uint32_t dims = 0;
+        uint32_t k = 0;
+        uint32_t n_ids = 0;
+        double threshold = 0;
+    };
+    struct ResponseHeader {
+        uint32_t magic;
+        int32_t status;
+        uint32_t rows;
+        uint32_t cols;
+        uint64_t size;
+    };
+#pragma pack(pop)
+
+    struct Response {
+        int status = -2;
+        uint32_t rows = 0, cols = 0;
+        std::vector<char> payload;
+        ///The payload from offset as n values of type T
+        template<typename T>
+        std::vector<T> values(size_t offset, size_t n) const {
+            std::vector<T> res(n);
+            if (offset + n * sizeof(T) <= payload.size())
+                std::memcpy(res.data(), payload.data() + offset, n * sizeof(T));
+            return res;
+        }
+        std::string message() const {return std::string(payload.begin(), payload.end());}
+    };
+
+    int connect_to(const std::string& path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    bool transfer(int fd, void* buffer, size_t size, bool write) {
+        char* p = static_cast<char*>(buffer);
+        while (size) {
+            const ssize_t n = write ? ::write(fd, p, size) : ::read(fd, p, size);
+            if (n <= 0)
+                return false;
+            p += n;
+            size -= size_t(n);
+        }
+        return true;
+    }
+
+    ///Sends a request and reads the response, status -2 if the connection is closed
+    Response request(int fd, RequestHeader header, std::vector<int32_t> ids = {}, std::vector<double> sites = {}) {
+        header.n_ids = uint32_t(ids.size());
+        Response res;
+        ResponseHeader answer{};
+        if (!transfer(fd, &header, sizeof(header), true) ||
+            !transfer(fd, ids.data(), ids.size() * sizeof(int32_t), true) ||
+            !transfer(fd, sites.data(), sites.size() * sizeof(double), true) ||
+            !transfer(fd, &answer, sizeof(answer), false))
+            return res;
+        res.payload.resize(answer.size);
+        if (answer.magic != header.magic || !transfer(fd, res.payload.data(), res.payload.size(), false))
+            return res;
+        res.status = answer.status;
+        res.rows = answer.rows;
+        res.cols = answer.cols;
+        return res;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: test_serve BUILD_DIR BERN_SERVE\n";
+        return 1;
+    }
+    const std::string socket_path = std::string(argv[1]) + "/test_serve.sock";
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const std::vector<const Community*> comms = test::communities(db);
+    const Community* comm = test::possible(comms, 0.5);
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+
+    // Writes to a closed connection fail instead of ending the test
+    std::signal(SIGPIPE, SIG_IGN);
+    const pid_t server = ::fork();
+    if (server == 0) {
+        ::execl(argv[2], argv[2], "--socket", socket_path.c_str(), "--max-sites", "100", (char*)nullptr);
+        std::_Exit(127);
+    }
+    int fd = -1;
+    for (int i = 0; i < 200 && fd < 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        fd = connect_to(socket_path);
+    }
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        ::kill(server, SIGKILL);
+        return test::report();
+    }
+
+    const uint32_t dims = uint32_t(db.type().size());
+    std::vector<SiteVector> sites = test::line(comm->center(), 8, {0.2, 0.5});
+    sites[3][0] = NaN;
+    std::vector<double> flat;
+    for (auto& site: sites)
+        flat.insert(flat.end(), site.begin(), site.end());
+    const uint32_t ns = uint32_t(sites.size());
+    RequestHeader header;
+    header.n_sites = ns;
+    header.dims = dims;
+
+    // The communities with species
+    Response info = request(fd, RequestHeader());
+    CHECK(info.status == 0 && info.cols == comms.size());
+    const std::vector<int32_t> counts = info.values<int32_t>(0, 3);
+    CHECK(counts[0] == int32_t(dims) && counts[1] == int32_t(comms.size()));
+    CHECK(counts[2] == int32_t(db.species_ids().size()));
+    const std::vector<int32_t> ids = info.values<int32_t>(3 * sizeof(int32_t), comms.size());
+    for (size_t c = 0; c < comms.size(); ++c)
+        CHECK(ids[c] == comms[c]->id);
+
+    // Possibilities of selected communities
+    const std::vector<int32_t> some = {comm->id, comms[1]->id, comms.back()->id};
+    header.query = 1;
+    Response poss = request(fd, header, some, flat);
+    CHECK(poss.status == 0 && poss.rows == ns && poss.cols == some.size());
+    const std::vector<double> values = poss.values<double>(0, ns * some.size());
+    for (size_t s = 0; s < ns; ++s)
+        for (size_t c = 0; c < some.size(); ++c)
+            CHECK(values[s * some.size() + c] == db.find_community(some[c])->possibility(sites[s]));
+
+    // The best communities, ties by lower id
+    header.query = 2;
+    header.k = 3;
+    Response best = request(fd, header, {}, flat);
+    CHECK(best.status == 0 && best.rows == ns && best.cols == 3);
+    const std::vector<int32_t> best_ids = best.values<int32_t>(0, ns * 3);
+    const std::vector<double> best_values = best.values<double>(ns * 3 * sizeof(int32_t), ns * 3);
+    for (size_t s = 0; s < ns; ++s) {
+        std::vector<std::pair<double, int>> ranking;
+        for (auto c: comms)
+            if (c->possibility(sites[s]) > 0)
+                ranking.emplace_back(-c->possibility(sites[s]), c->id);
+        std::sort(ranking.begin(), ranking.end());
+        for (size_t r = 0; r < 3; ++r) {
+            CHECK(best_ids[s * 3 + r] == (r < ranking.size() ? ranking[r].second : -1));
+            CHECK(best_values[s * 3 + r] == (r < ranking.size() ? -ranking[r].first : 0));
+        }
+    }
+
+    // The species above the threshold are the richness top lists
+    header.query = 3;
+    header.k = 4;
+    header.threshold = 0.2;
+    Response species = request(fd, header, {}, flat);
+    CHECK(species.status == 0 && species.rows == ns && species.cols == 4);
+    const RichnessResult richness = species_richness(db.species_list(db.species_ids()), sites, 0.2, 4);
+    CHECK(species.values<int32_t>(0, ns) == richness.count);
+    CHECK(species.values<int32_t>(ns * sizeof(int32_t), ns * 4) == richness.top_ids);
+    CHECK(species.values<double>(ns * 5 * sizeof(int32_t), ns * 4) == richness.top_possibility);
+
+    // Concurrent clients are evaluated in one batch, each gets its own result
+    std::vector<std::thread> clients;
+    std::vector<int> correct(4, 0);
+    for (size_t i = 0; i < correct.size(); ++i) {
+        clients.emplace_back([&, i] {
+            const int client = connect_to(socket_path);
+            RequestHeader h;
+            h.query = 1;
+            h.n_sites = uint32_t(i + 1);
+            h.dims = dims;
+            const std::vector<double> part(flat.begin(), flat.begin() + (i + 1) * dims);
+            const Response r = request(client, h, {some[0]}, part);
+            bool same = r.status == 0 && r.rows == i + 1;
+            for (size_t s = 0; s <= i && same; ++s)
+                same = r.values<double>(0, i + 1)[s] == values[s * some.size()];
+            correct[i] = same;
+            ::close(client);
+        });
+    }
+    for (auto& client: clients)
+        client.join();
+    CHECK(std::count(correct.begin(), correct.end(), 1) == int(correct.size()));
+
+    // Failed requests are answered with a message, the connection stays usable
+    header.query = 1;
+    Response unknown = request(fd, header, {-12345}, flat);
+    CHECK(unknown.status == -1 && unknown.message().find("-12345") != std::string::npos);
+    header.query = 2;
+    header.k = 0;
+    CHECK(request(fd, header, {}, flat).status == -1);
+    CHECK(request(fd, RequestHeader()).status == 0);
+    // Requests too large to read and sites of another dimension break the framing, the server answers
+    // and closes the connection
+    RequestHeader large = header;
+    large.n_sites = 101;
+    CHECK(request(fd, large, {}, std::vector<double>(101 * dims)).status == -1);
+    CHECK(request(fd, RequestHeader()).status == -2);
+    ::close(fd);
+    fd = connect_to(socket_path);
+    RequestHeader wrong = header;
+    wrong.dims = dims - 1;
+    CHECK(request(fd, wrong, {}, std::vector<double>(ns * (dims - 1))).status == -1);
+    CHECK(request(fd, RequestHeader()).status == -2);
+    ::close(fd);
+
+    // SIGTERM ends the server and removes the socket
+    ::kill(server, SIGTERM);
+    int status = 0;
+    CHECK(::waitpid(server, &status, 0) == server && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(::access(socket_path.c_str(), F_OK) != 0);
+    return test::report();
+}
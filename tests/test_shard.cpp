@@ -0,0 +1,135 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// End to end test of bern-shard: the shards of the forked workers give the values of the library, and the
+// merged means do not depend on the number of workers
+
+#include "test.h"
+#include "../BERNpp/Richness.h"
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sys/wait.h>
+
+using namespace BERN;
+
+namespace {
+    ///The float64 values of a .npy file (version 1.0)
+    std::vector<double> read_npy(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        char preamble[10] = {};
+        file.read(preamble, sizeof(preamble));
+        const size_t header = size_t((unsigned char)preamble[8]) | size_t((unsigned char)preamble[9]) << 8;
+        file.seekg(std::streamoff(sizeof(preamble) + header));
+        std::vector<double> values;
+        double value;
+        while (file.read(reinterpret_cast<char*>(&value), sizeof(value)))
+            values.push_back(value);
+        return values;
+    }
+
+    ///Runs bern-shard, returns its exit code
+    int run(const std::string& shard, const std::string& args, const std::string& input, const std::string& output) {
+        const std::string command = "\"" + shard + "\" " + args + " \"" + input + "\" \"" + output + "\" 2>/dev/null";
+        const int status = std::system(command.c_str());
+        return status < 0 ? status : WEXITSTATUS(status);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: test_shard BUILD_DIR BERN_SHARD\n";
+        return 1;
+    }
+    const std::string dir = std::string(argv[1]) + "/", shard = argv[2];
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const std::vector<const Community*> comms = test::communities(db);
+    const Community* comm = test::possible(comms, 0.5);
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+
+    // 41 sites in shards of 6, the last shard is shorter
+    std::vector<SiteVector> sites = test::line(comm->center(), 20, {0.2, 0.5});
+    sites[3][0] = NaN;
+    const std::string input = dir + "test_shard_sites.bin", output = dir + "test_shard.npy";
+    {
+        std::ofstream out(input, std::ios::binary);
+        for (auto& site: sites)
+            out.write(reinterpret_cast<const char*>(site.data()), std::streamsize(site.size() * sizeof(double)));
+    }
+    const size_t ns = sites.size(), nc = comms.size(), shard_size = 6;
+
+    CHECK(run(shard, "--query possibility --dtype float64 --shard 6 --workers 3", input, output) == 0);
+    const std::vector<double> poss = read_npy(output);
+    CHECK(poss.size() == ns * nc);
+    if (poss.size() == ns * nc)
+        for (size_t s = 0; s < ns; ++s)
+            for (size_t c = 0; c < nc; ++c)
+                CHECK(poss[s * nc + c] == comms[c]->possibility(sites[s]));
+
+    CHECK(run(shard, "--query best --shard 6 --workers 3", input, output) == 0);
+    const std::vector<double> best = read_npy(output);
+    CHECK(best.size() == 2 * ns);
+    for (size_t s = 0; s < ns && best.size() == 2 * ns; ++s) {
+        double max = 0;
+        int id = -1;
+        for (auto c: comms) {
+            if (c->possibility(sites[s]) > max) {
+                max = c->possibility(sites[s]);
+                id = c->id;
+            }
+        }
+        CHECK(best[2 * s] == id && best[2 * s + 1] == max);
+    }
+
+    CHECK(run(shard, "--query richness --threshold 0.2 --shard 6 --workers 3", input, output) == 0);
+    const std::vector<double> richness = read_npy(output);
+    const RichnessResult expected = species_richness(db.species_list(db.species_ids()), sites, 0.2);
+    CHECK(richness.size() == 2 * ns);
+    for (size_t s = 0; s < ns && richness.size() == 2 * ns; ++s)
+        CHECK(richness[2 * s] == expected.count[s] && richness[2 * s + 1] == expected.sum[s]);
+
+    // The sums of each shard are added in shard order, with any number of workers
+    std::vector<double> sums(nc, 0.0);
+    for (size_t first = 0; first < ns; first += shard_size) {
+        for (size_t c = 0; c < nc; ++c) {
+            double sum = 0;
+            for (size_t s = first; s < std::min(ns, first + shard_size); ++s)
+                sum += comms[c]->possibility(sites[s]);
+            sums[c] += sum;
+        }
+    }
+    for (const char* workers: {"1", "2", "5"}) {
+        CHECK(run(shard, std::string("--query mean --shard 6 --workers ") + workers, input, output) == 0);
+        const std::vector<double> mean = read_npy(output);
+        CHECK(mean.size() == 2 * nc);
+        for (size_t c = 0; c < nc && mean.size() == 2 * nc; ++c)
+            CHECK(mean[2 * c] == comms[c]->id && mean[2 * c + 1] == sums[c] / double(ns));
+    }
+
+    // An input with a partial row is rejected
+    {
+        std::ofstream out(input, std::ios::binary | std::ios::app);
+        const double partial = 1;
+        out.write(reinterpret_cast<const char*>(&partial), sizeof(partial));
+    }
+    CHECK(run(shard, "--query mean", input, output) != 0);
+    return test::report();
+}
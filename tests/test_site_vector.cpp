@@ -0,0 +1,62 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the site schema: shared by its vectors and checked by the species
+
+#include "test.h"
+
+using namespace BERN;
+
+int main() {
+    // Vectors of a database keep its schema alive
+    SiteVector site, shifted;
+    Possibility optimum;
+    Species copy;
+    {
+        std::unique_ptr<Database> db(new Database("BERNdata/site_type.tsv"));
+        test::load(*db);
+        const Community* comm = test::communities(*db)[0];
+        optimum = comm->optimum();
+        site = db->site();
+        copy = *comm->species()[0];
+        // A copy of the schema is not owned by the database
+        SiteType other = db->type();
+        CHECK(&SiteVector(other).type() == &other);
+        CHECK(&site.type() == &db->type());
+    }
+    CHECK(site.type().size() == 7 && site.type()[0].Name == "pH");
+    CHECK(optimum.site.type().find("pH") == 0);
+    CHECK(copy.possibility(optimum.site) >= 0);
+
+    // Steps of less than one unit compare unequal, beyond the tolerance of the schema
+    shifted = optimum.site;
+    shifted[0] += 0.5;
+    CHECK(!(shifted == optimum.site));
+    shifted[0] = optimum.site[0] + 0.5 * site.type()[0].error_tolerance();
+    CHECK(shifted == optimum.site);
+
+    // Sites of another schema are rejected by the species
+    shifted.pop_back();
+    size_t dim;
+    double slope;
+    CHECK(!(shifted == optimum.site));
+    CHECK_THROWS(copy.possibility(shifted), SchemaError);
+    CHECK_THROWS(copy.possibility(shifted, dim, slope), SchemaError);
+    CHECK_THROWS(copy.possibility_bounds(SiteRange(shifted, shifted)), SchemaError);
+    return test::report();
+}
@@ -0,0 +1,106 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the slices against the evaluation of the communities and species at every point,
+// for degenerate axes with a single point and curves without a y axis
+
+#include "test.h"
+#include "../BERNpp/Slice.h"
+
+using namespace BERN;
+
+///Compares the slices through base with the evaluation at every point
+static void check_slice(const Database& db, const std::vector<const Community*>& comms, const SiteVector& base,
+                        const SliceAxis& x, const SliceAxis& y) {
+    const size_t nx = x.steps, ny = std::max<size_t>(1, y.steps);
+    const std::vector<double> values = community_slice(comms, base, x, y);
+    std::vector<int> labels(nx * ny);
+    std::vector<double> max_values(nx * ny);
+    best_community_slice(comms, base, x, y, labels.data(), max_values.data());
+    const std::vector<const Species*> species = comms[0]->species();
+    const std::vector<double> spec_values = species_slice(species, base, x, y);
+    CHECK(values.size() == comms.size() * nx * ny);
+    CHECK(spec_values.size() == species.size() * nx * ny);
+
+    for (size_t j = 0; j < ny; ++j) {
+        for (size_t i = 0; i < nx; ++i) {
+            SiteVector site = base;
+            site[x.dim] = x.value(i);
+            if (y.steps)
+                site[y.dim] = y.value(j);
+            double max = 0;
+            int best = -1;
+            for (size_t c = 0; c < comms.size(); ++c) {
+                const double poss = comms[c]->possibility(site);
+                CHECK_CLOSE(values[(c * ny + j) * nx + i], poss, 1e-12);
+                if (poss > max) {
+                    max = poss;
+                    best = comms[c]->id;
+                }
+            }
+            const int label = labels[j * nx + i];
+            CHECK_CLOSE(max_values[j * nx + i], max, 1e-12);
+            if (best < 0 || label < 0)
+                CHECK(label == best);
+            else
+                CHECK_CLOSE(db.community(label).possibility(site), max, 1e-12);
+            for (size_t s = 0; s < species.size(); ++s)
+                CHECK_CLOSE(spec_values[(s * ny + j) * nx + i], species[s]->possibility(site), 1e-12);
+        }
+    }
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const Community* comm = test::possible(test::communities(db));
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+    // The sliced community first, its species are sliced too
+    std::vector<const Community*> comms = {comm};
+    for (auto c: test::communities(db))
+        if (c != comm)
+            comms.push_back(c);
+
+    const SiteVector base = comm->center();
+    const SliceAxis x(1, base[1] - 1.5, base[1] + 1.5, 31), y(2, base[2] - 2, base[2] + 2, 17);
+    check_slice(db, comms, base, x, y);
+    // A single column, a single row and a single point
+    check_slice(db, comms, base, SliceAxis(1, base[1], base[1] + 1.5, 1), y);
+    check_slice(db, comms, base, x, SliceAxis(2, base[2], base[2] + 2, 1));
+    check_slice(db, comms, base, SliceAxis(1, base[1], base[1], 1), SliceAxis(2, base[2], base[2], 1));
+    // Curves along x without a y axis
+    check_slice(db, comms, base, x, SliceAxis());
+    check_slice(db, comms, base, SliceAxis(1, base[1], base[1], 1), SliceAxis());
+    // A missing value of the base in the fixed dimensions, and one replaced by the axis values
+    SiteVector missing = base;
+    missing[0] = NaN;
+    missing[x.dim] = NaN;
+    check_slice(db, comms, missing, x, y);
+
+    // An empty x axis renders nothing
+    CHECK(community_slice(comms, base, SliceAxis(1, 0, 1, 0), y).empty());
+
+    SiteVector other = base;
+    other.pop_back();
+    CHECK_THROWS(community_slice(comms, other, x, y), SchemaError);
+    CHECK_THROWS(best_community_slice(comms, other, x, y), SchemaError);
+    CHECK_THROWS(species_slice(comm->species(), other, x, y), SchemaError);
+    return test::report();
+}
@@ -0,0 +1,118 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the trajectories with cached trapezoid values: the possibilities are bit identical
+// to Community::possibility at every step, when single, several or no dimensions change
+
+#include "test.h"
+#include "../BERNpp/Trajectory.h"
+
+using namespace BERN;
+
+///Checks a trajectory against the evaluation of every community at every step
+void check_trajectory(const TrajectoryResult& res, const std::vector<const Community*>& comms,
+                      const std::vector<SiteState>& states, const Aggregation& aggregation) {
+    CHECK(res.steps == states.size() && res.communities == comms.size());
+    std::vector<size_t> transitions;
+    for (size_t t = 0; t < states.size(); ++t) {
+        CHECK(res.ids[t] == states[t].ID());
+        double max = 0;
+        int best = -1;
+        for (size_t c = 0; c < comms.size(); ++c) {
+            const double value = res.possibilities[t * comms.size() + c];
+            if (!comms[c]->size()) {
+                CHECK(std::isnan(value));
+                continue;
+            }
+            const double p = comms[c]->possibility(states[t].SiteConditions(), aggregation);
+            CHECK(value == p);
+            if (p > max) {
+                max = p;
+                best = comms[c]->id;
+            }
+        }
+        CHECK(res.best[t] == best);
+        if (t && best != res.best[t - 1])
+            transitions.push_back(t);
+    }
+    CHECK(res.transitions == transitions);
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    std::vector<const Community*> comms = test::communities(db);
+    const Community* comm = test::possible(comms, 0.5);
+    CHECK(comm != nullptr);
+    if (!comm)
+        return test::report();
+    Community empty(-1, "empty", db.type());
+    comms.push_back(&empty);
+
+    // A walk from the optimum of a community: one dimension per step, unchanged steps, several dimensions
+    // at once, a missing value, a return to an earlier state and a jump out of the envelope
+    std::vector<SiteState> states;
+    SiteVector site = comm->center();
+    auto add = [&](const SiteVector& s) {states.emplace_back(2000 + int(states.size()), s);};
+    add(site);
+    for (size_t d = 0; d < site.size(); ++d) {
+        site[d] += 0.3 * (d + 1);
+        add(site);
+        add(site);
+    }
+    for (const SiteVector& s: test::line(site, 4, {0.1, -0.2, 0.15}))
+        add(s);
+    SiteVector missing = site;
+    missing[1] = NaN;
+    add(missing);
+    add(site);
+    add(states[0].SiteConditions());
+    SiteVector far = site;
+    far[0] += 100;
+    add(far);
+    add(states[0].SiteConditions());
+
+    for (const Aggregation& aggregation: {Aggregation(), Aggregation::minimum(), Aggregation::mean(),
+                                          Aggregation::gamma_operator(0)}) {
+        const TrajectoryResult res = trajectory(comms, states, aggregation);
+        check_trajectory(res, comms, states, aggregation);
+    }
+
+    // Unchanged dimensions are not evaluated again
+    size_t species = 0;
+    for (auto c: comms)
+        species += c->size();
+    const TrajectoryResult res = trajectory(comms, states);
+    CHECK(res.trapez_evaluations < states.size() * species * site.size());
+    CHECK(res.trapez_evaluations >= species * site.size());
+
+    // Many plots give the trajectories of each plot, also for a plot without states
+    const std::vector<std::vector<SiteState>> plots = {states, std::vector<SiteState>(states.rbegin(), states.rend()), {}};
+    const std::vector<TrajectoryResult> all = trajectories(comms, plots);
+    CHECK(all.size() == plots.size());
+    for (size_t i = 0; i < plots.size() && i < all.size(); ++i)
+        check_trajectory(all[i], comms, plots[i], Aggregation());
+
+    std::vector<SiteState> wrong = states;
+    SiteVector short_site = site;
+    short_site.pop_back();
+    wrong.back() = SiteState(0, short_site);
+    CHECK_THROWS(trajectory(comms, wrong), SchemaError);
+    CHECK_THROWS(trajectories(comms, {states, wrong}), SchemaError);
+    return test::report();
+}
@@ -0,0 +1,142 @@
+// BERN-model
+//
+// A static model to calculate the potential biodiversity at given environmental factors
+// (c) 2023 by IBE – Ingenieurbüro Dr. Eckhof GmbH, https://www.eckhof.de/unternehmen.html
+// Written by Philipp Kraft, Justus-Liebig-Universität, 2007 - 2023
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; version 3 of the License.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// For the usage of this model a database of species and plant communities is needed.
+// The database is usually in the same repository as this code, but covered by another, less free licence
+
+// Regression tests of the site distributions and the Monte Carlo propagation
+
+#include "test.h"
+#include "../BERNpp/Uncertainty.h"
+#include <algorithm>
+
+using namespace BERN;
+
+namespace {
+    double correlation(const std::vector<double>& x, const std::vector<double>& y) {
+        const size_t n = x.size();
+        double mx = 0, my = 0, sxy = 0, sxx = 0, syy = 0;
+        for (size_t i = 0; i < n; ++i) {
+            mx += x[i] / n;
+            my += y[i] / n;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            sxy += (x[i] - mx) * (y[i] - my);
+            sxx += (x[i] - mx) * (x[i] - mx);
+            syy += (y[i] - my) * (y[i] - my);
+        }
+        return sxy / std::sqrt(sxx * syy);
+    }
+}
+
+int main() {
+    Database db("BERNdata/site_type.tsv");
+    test::load(db);
+    const SiteType& type = db.type();
+    const size_t dims = type.size();
+
+    // Alternating normal and uniform dimensions in the middle of the ranges, scale less than one unit
+    SiteVector location(type), scale(type);
+    for (size_t d = 0; d < dims; ++d) {
+        location[d] = 0.5 * (type[d].min + type[d].max);
+        scale[d] = 0.4;
+    }
+    SiteDistribution dist(location, scale);
+    for (size_t d = 1; d < dims; d += 2)
+        dist.kind[d] = Distribution::uniform;
+
+    const CounterRNG rng(7);
+    const size_t n = 20000;
+    std::vector<std::vector<double>> values(dims, std::vector<double>(n));
+    SiteVector sample(type);
+    bool in_range = true;
+    for (size_t i = 0; i < n; ++i) {
+        dist.sample(rng, 3, i, sample);
+        for (size_t d = 0; d < dims; ++d) {
+            values[d][i] = sample[d];
+            if (dist.kind[d] == Distribution::uniform)
+                in_range &= std::abs(sample[d] - location[d]) <= scale[d];
+        }
+    }
+    CHECK(in_range);
+    // The dimensions draw from disjoint counters, hence they are uncorrelated
+    double max_correlation = 0;
+    for (size_t a = 0; a < dims; ++a)
+        for (size_t b = a + 1; b < dims; ++b)
+            max_correlation = std::max(max_correlation, std::abs(correlation(values[a], values[b])));
+    CHECK(max_correlation < 0.05);
+
+    // Same seed, stream and sample give the same site
+    SiteVector again(type);
+    dist.sample(rng, 3, 17, again);
+    for (size_t d = 0; d < dims; ++d)
+        CHECK(again[d] == values[d][17]);
+
+    // Inconsistent sizes are rejected before any sampling
+    SiteVector short_scale = scale;
+    short_scale.pop_back();
+    CHECK_THROWS(SiteDistribution(location, short_scale), SchemaError);
+    SiteDistribution broken(location, scale);
+    broken.kind.pop_back();
+    CHECK_THROWS(broken.sample(rng, 0, 0, sample), SchemaError);
+    const std::vector<const Community*> comms = test::communities(db);
+    CHECK_THROWS(monte_carlo(comms, {broken}, 10), SchemaError);
+
+    // A fixed distribution gives the possibility at the location
+    SiteDistribution fixed(location, scale, Distribution::fixed);
+    MonteCarloResult res = monte_carlo(comms, {fixed}, 4);
+    for (size_t c = 0; c < comms.size(); ++c)
+        CHECK(res.mean[c] == comms[c]->possibility(location));
+
+    // A missing value stays missing for every distribution, the other dimensions do not change
+    SiteVector missing = location;
+    missing[0] = NaN;
+    for (Distribution kind: {Distribution::fixed, Distribution::uniform, Distribution::normal}) {
+        SiteDistribution with_nan(missing, scale, kind), without(location, scale, kind);
+        SiteVector a(type), b(type);
+        with_nan.sample(rng, 3, 5, a);
+        without.sample(rng, 3, 5, b);
+        CHECK(std::isnan(a[0]));
+        for (size_t d = 1; d < dims; ++d)
+            CHECK(a[d] == b[d]);
+    }
+    res = monte_carlo(comms, {SiteDistribution(missing, scale, Distribution::fixed)}, 4);
+    for (size_t c = 0; c < comms.size(); ++c)
+        CHECK(res.mean[c] == comms[c]->possibility(missing));
+
+    // The quantiles equal the interpolated order statistics of the sorted samples, around a possible community
+    const Community* comm = comms[0];
+    for (auto c: comms)
+        if (c->possibility(c->center()) > 0.5)
+            comm = c;
+    const SiteDistribution around(comm->center(), scale);
+    const std::vector<double> levels = {0, 0.05, 0.5, 0.95, 1};
+    const size_t samples = 101;
+    res = monte_carlo({comm}, {around}, samples, levels, 11);
+    std::vector<double> poss(samples);
+    for (size_t i = 0; i < samples; ++i) {
+        around.sample(CounterRNG(11), 0, i, sample);
+        poss[i] = comm->possibility(sample);
+    }
+    std::sort(poss.begin(), poss.end());
+    CHECK(poss.front() < poss.back());
+    for (size_t l = 0; l < levels.size(); ++l) {
+        const double pos = levels[l] * (samples - 1);
+        const size_t lower = std::min(size_t(pos), samples - 2);
+        const double expected = poss[lower] + (pos - lower) * (poss[lower + 1] - poss[lower]);
+        CHECK_CLOSE(res.quantiles[l], expected, 1e-12);
+    }
+    return test::report();
+}